@@ -0,0 +1,244 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <cmath>
+#include <fstream>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Results files and regression tracking against a baseline. A results file
+// has one tab-separated line per benchmarked phase: expression, name,
+// format, sparsity, threads, cold, mean, stdev, median and the time (ms) of
+// each repetition. Phases of two runs are matched on all the fields up to
+// threads, and on their occurrence when a run has several equal keys.
+
+// Repetitions a phase needs on both sides to be tested: with 3 against 3,
+// even the exact Mann-Whitney test cannot go below p=0.1
+const size_t minBaselineSamples=4;
+// Largest sample sizes for which the U distribution is computed exactly
+const int maxExactSamples=20;
+
+struct StoredResult {
+  string key;
+  bool cold;
+  double median;
+  vector<double> samples;
+};
+
+  int benchThreads() {
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+  }
+
+  string resultKey(const BenchContext& context, string name, int threads) {
+    return context.expr+"\t"+name+"\t"+context.format+"\t"+context.sparsity+"\t"+to_string(threads);
+  }
+
+  string resultKey(const BenchResult& result) {
+    int threads=(result.threads==allBenchThreads) ? benchThreads() : result.threads;
+    return resultKey(result.context,result.name,threads);
+  }
+
+  bool writeResults(string filename, const vector<BenchResult>& results) {
+    ofstream file(filename);
+    if (!file)
+      return false;
+    file << "expression\tname\tformat\tsparsity\tthreads\tcold\tmean\tstdev\tmedian\tsamples" << endl;
+    file << setprecision(17);
+    for (auto& result : results) {
+      file << resultKey(result) << "\t" << result.cold << "\t"
+           << result.time.mean << "\t" << result.time.stdev << "\t" << result.time.median << "\t";
+      for (size_t k=0; k<result.samples.size(); k++)
+        file << (k ? " " : "") << result.samples[k];
+      file << endl;
+    }
+    return true;
+  }
+
+  // Tag repeated keys with their occurrence, in the order the phases ran
+  void numberKeys(vector<StoredResult>& results) {
+    map<string,int> occurrences;
+    for (auto& result : results) {
+      int occurrence=occurrences[result.key]++;
+      if (occurrence > 0)
+        result.key+="\t#"+to_string(occurrence);
+    }
+  }
+
+  bool readResults(string filename, vector<StoredResult>& results) {
+    ifstream file(filename);
+    string line;
+    if (!file || !getline(file,line))
+      return false;
+    while (getline(file,line)) {
+      vector<string> fields;
+      size_t start=0;
+      size_t tab;
+      while ((tab=line.find('\t',start))!=string::npos) {
+        fields.push_back(line.substr(start,tab-start));
+        start=tab+1;
+      }
+      fields.push_back(line.substr(start));
+      if (fields.size()!=10)
+        return false;
+      StoredResult result;
+      result.key=fields[0]+"\t"+fields[1]+"\t"+fields[2]+"\t"+fields[3]+"\t"+fields[4];
+      result.cold=(fields[5]=="1");
+      result.median=stod(fields[8]);
+      std::istringstream samples(fields[9]);
+      double sample;
+      while (samples >> sample)
+        result.samples.push_back(sample);
+      results.push_back(result);
+    }
+    numberKeys(results);
+    return true;
+  }
+
+  // Probability that U <= u when n1 and n2 samples come from the same
+  // distribution, by counting the orderings of the samples with each U.
+  // count[j][k][v] is the number of orderings of j samples of a and k of b
+  // where v pairs have the sample of a above; the largest sample is either
+  // one of a, above the k of b, or one of b.
+  double exactUCdf(int n1, int n2, double u) {
+    vector<vector<vector<double>>> count(n1+1,vector<vector<double>>(n2+1));
+    for (int j=0; j<=n1; j++) {
+      for (int k=0; k<=n2; k++) {
+        count[j][k].assign(j*k+1,0.0);
+        if (j==0 || k==0) {
+          count[j][k][0]=1.0;
+          continue;
+        }
+        for (int v=0; v<=j*k; v++) {
+          if (v>=k && v-k<=(j-1)*k)
+            count[j][k][v]+=count[j-1][k][v-k];
+          if (v<=j*(k-1))
+            count[j][k][v]+=count[j][k-1][v];
+        }
+      }
+    }
+    double below=0.0;
+    double total=0.0;
+    for (int v=0; v<=n1*n2; v++) {
+      total+=count[n1][n2][v];
+      if (v<=u)
+        below+=count[n1][n2][v];
+    }
+    return below/total;
+  }
+
+  // Two-sided p-value of the Mann-Whitney U test that a and b come from the
+  // same distribution: exact for small samples without ties, otherwise with
+  // the normal approximation corrected for ties
+  double mannWhitney(const vector<double>& a, const vector<double>& b) {
+    vector<pair<double,int>> all;
+    for (double v : a)
+      all.push_back({v,0});
+    for (double v : b)
+      all.push_back({v,1});
+    sort(all.begin(),all.end());
+    double n1=a.size();
+    double n2=b.size();
+    double n=n1+n2;
+    double rankSum=0.0;
+    double ties=0.0;
+    for (size_t k=0; k<all.size();) {
+      size_t end=k;
+      while (end < all.size() && all[end].first==all[k].first)
+        end++;
+      double rank=(k+1+end)/2.0;
+      double t=end-k;
+      ties+=t*t*t-t;
+      for (size_t l=k; l<end; l++)
+        if (all[l].second==0)
+          rankSum+=rank;
+      k=end;
+    }
+    double U=rankSum-n1*(n1+1)/2.0;
+    if (ties==0 && n1<=maxExactSamples && n2<=maxExactSamples) {
+      double lower=exactUCdf((int)n1,(int)n2,U);
+      double upper=exactUCdf((int)n1,(int)n2,n1*n2-U);
+      return std::min(1.0,2.0*std::min(lower,upper));
+    }
+    double mean=n1*n2/2.0;
+    double variance=n1*n2/12.0*((n+1)-ties/(n*(n-1)));
+    if (variance <= 0)
+      return 1.0;
+    double z=(std::abs(U-mean)-0.5)/sqrt(variance);
+    return std::erfc(std::max(z,0.0)/sqrt(2.0));
+  }
+
+  // Compare the phases of this run to a baseline results file. A phase whose
+  // median changed by more than <threshold> percent is a regression or an
+  // improvement when the change is significant at level <alpha>; phases with
+  // fewer than minBaselineSamples repetitions on either side are not tested.
+  // Returns the number of regressions, -1 if the baseline cannot be read, or
+  // -2 if no phase could be tested.
+  int compareToBaseline(string filename, const vector<BenchResult>& results,
+                        double threshold, double alpha) {
+    const size_t minSamples=minBaselineSamples;
+    vector<StoredResult> baseline;
+    if (!readResults(filename,baseline))
+      return -1;
+    map<string,const StoredResult*> baselineByKey;
+    for (auto& result : baseline)
+      baselineByKey[result.key]=&result;
+
+    vector<StoredResult> current;
+    for (auto& result : results)
+      current.push_back({resultKey(result),result.cold,
+                         result.time.median,result.samples});
+    numberKeys(current);
+
+    int regressions=0;
+    int improvements=0;
+    int untested=0;
+    int tested=0;
+    cout << endl << "Comparison to baseline " << filename << " (median ms)" << endl;
+    cout << left << setw(60) << "phase" << setw(14) << "baseline" << setw(14) << "current"
+         << setw(10) << "change" << setw(12) << "p-value" << "verdict" << endl;
+    for (auto& result : current) {
+      if (!baselineByKey.count(result.key))
+        continue;
+      const StoredResult& base=*baselineByKey.at(result.key);
+      double change=(result.median-base.median)/base.median*100.0;
+      string verdict="same";
+      string pValue="-";
+      if (result.samples.size() < minSamples || base.samples.size() < minSamples) {
+        verdict="untested";
+        untested++;
+      }
+      else {
+        tested++;
+        double p=mannWhitney(base.samples,result.samples);
+        std::ostringstream label;
+        label << setprecision(3) << p;
+        pValue=label.str();
+        if (p < alpha && change > threshold) {
+          verdict="REGRESSION";
+          regressions++;
+        }
+        else if (p < alpha && change < -threshold) {
+          verdict="improvement";
+          improvements++;
+        }
+      }
+      string phase=result.key;
+      replace(phase.begin(),phase.end(),'\t',' ');
+      cout << setw(60) << phase << setw(14) << base.median << setw(14) << result.median
+           << setw(10) << setprecision(3) << change << setprecision(6) << setw(12) << pValue
+           << verdict << endl;
+    }
+    cout << right;
+    cout << regressions << " regressions, " << improvements << " improvements, "
+         << untested << " phases with fewer than " << minSamples << " repetitions not tested" << endl;
+    if (tested==0)
+      return -2;
+    return regressions;
+  }
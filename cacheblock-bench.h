@@ -0,0 +1,250 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <unistd.h>
+
+// Cache-blocked CSR SpMV for matrices with more columns than the cache holds
+// entries of x. Each thread owns a panel of rows balanced by nonzeros and
+// splits it in tiles of blockCols columns, so that the segment of x a tile
+// reads stays in cache while the tile runs. A tile keeps only its nonempty
+// row segments, in the order of the rows, as doubly compressed CSR, and the
+// tiles of a panel run in column order. The tile width is autotuned over
+// fractions of the L2 and of the last-level cache, unless -xtile=<KB> gives
+// the bytes of x a tile reads.
+
+const int64_t defaultL2Bytes=256*1024;
+const int64_t defaultLLCBytes=8*1024*1024;
+
+struct TiledPanel {
+  int rowStart;
+  int rowEnd;
+  vector<int> tileStart;  // first segment of each tile, tiles()+1
+  vector<int> segmentRow; // row of each segment
+  vector<int> segmentPos; // first nonzero of each segment, segments+1
+  vector<int> crd;
+  vector<double> vals;
+
+  int tiles() const { return (int)tileStart.size()-1; }
+};
+
+struct TiledCSR {
+  int rows;
+  int cols;
+  int blockCols;
+  vector<TiledPanel> panels;
+
+  int threads() const { return (int)panels.size(); }
+
+  long tiles() const {
+    long tiles=0;
+    for (auto& panel : panels)
+      tiles+=panel.tiles();
+    return tiles;
+  }
+};
+
+  // Size of a cache level from the C library, or a default when unknown
+  int64_t cacheBytes(int level) {
+    long bytes=0;
+#if defined(_SC_LEVEL2_CACHE_SIZE) && defined(_SC_LEVEL3_CACHE_SIZE)
+    bytes=sysconf(level==2 ? _SC_LEVEL2_CACHE_SIZE : _SC_LEVEL3_CACHE_SIZE);
+#endif
+    if (bytes > 0)
+      return bytes;
+    return (level==2) ? defaultL2Bytes : defaultLLCBytes;
+  }
+
+  // Tiles of a panel, by counting sort of its row segments on their column
+  // block: the first pass counts the segments and nonzeros of each block, the
+  // second copies them in place
+  void buildTiledPanel(const int* pos, const int* crd, const double* vals, int blockCols,
+                       int blocks, TiledPanel& panel) {
+    vector<int> segments(blocks+1,0), nnz(blocks+1,0);
+    for (int i=panel.rowStart; i<panel.rowEnd; i++) {
+      int last=-1;
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        int b=crd[p]/blockCols;
+        if (b!=last)
+          segments[b+1]++;
+        nnz[b+1]++;
+        last=b;
+      }
+    }
+    for (int b=0; b<blocks; b++) {
+      segments[b+1]+=segments[b];
+      nnz[b+1]+=nnz[b];
+    }
+    panel.tileStart.clear();
+    for (int b=0; b<blocks; b++) {
+      if (segments[b+1] > segments[b])
+        panel.tileStart.push_back(segments[b]);
+    }
+    panel.tileStart.push_back(segments[blocks]);
+    panel.segmentRow.resize(segments[blocks]);
+    panel.segmentPos.resize(segments[blocks]+1);
+    panel.segmentPos[segments[blocks]]=nnz[blocks];
+    panel.crd.resize(nnz[blocks]);
+    panel.vals.resize(nnz[blocks]);
+    for (int i=panel.rowStart; i<panel.rowEnd; i++) {
+      int last=-1;
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        int b=crd[p]/blockCols;
+        if (b!=last) {
+          panel.segmentRow[segments[b]]=i;
+          panel.segmentPos[segments[b]]=nnz[b];
+          segments[b]++;
+        }
+        panel.crd[nnz[b]]=crd[p];
+        panel.vals[nnz[b]]=vals[p];
+        nnz[b]++;
+        last=b;
+      }
+    }
+  }
+
+  // Each thread builds the tiles of its own panel
+  void buildTiledCSR(int rows, int cols, const int* pos, const int* crd, const double* vals,
+                     int blockCols, int threads, TiledCSR& dst) {
+    dst.rows=rows;
+    dst.cols=cols;
+    dst.blockCols=blockCols;
+    RowPartition partition=partitionCSR("nnz",rows,pos,threads);
+    dst.panels.assign(threads,TiledPanel());
+    int blocks=(cols+blockCols-1)/blockCols;
+    #pragma omp parallel for schedule(static,1) num_threads(threads)
+    for (int t=0; t<threads; t++) {
+      dst.panels[t].rowStart=partition.rowStart[t];
+      dst.panels[t].rowEnd=partition.rowStart[t+1];
+      buildTiledPanel(pos,crd,vals,blockCols,blocks,dst.panels[t]);
+    }
+  }
+
+  // y = alpha*A*x + beta*z, z is not read when beta is zero
+  void tiledSpMV(const TiledCSR& A, const double* x, double alpha, double beta,
+                 const double* z, double* y) {
+    #pragma omp parallel for schedule(static,1) num_threads(A.threads())
+    for (int t=0; t<A.threads(); t++) {
+      const TiledPanel& panel=A.panels[t];
+      for (int i=panel.rowStart; i<panel.rowEnd; i++)
+        y[i]=0.0;
+      for (int s=0; s<(int)panel.segmentRow.size(); s++) {
+        double sum=0.0;
+        for (int p=panel.segmentPos[s]; p<panel.segmentPos[s+1]; p++)
+          sum+=panel.vals[p]*x[panel.crd[p]];
+        y[panel.segmentRow[s]]+=sum;
+      }
+      for (int i=panel.rowStart; i<panel.rowEnd; i++)
+        y[i] = (beta == 0.0) ? alpha*y[i] : alpha*y[i]+beta*z[i];
+    }
+  }
+
+  // Tile widths, in columns, reading a quarter, half and all of the L2, or
+  // a thread share and half of the last-level cache of x
+  vector<int> tileCandidates(int cols, int threads) {
+    int64_t l2=cacheBytes(2);
+    int64_t llc=cacheBytes(3);
+    vector<int64_t> bytes={l2/4,l2/2,l2,llc/threads,llc/2};
+    vector<int> widths;
+    for (int64_t b : bytes)
+      widths.push_back((int)min((int64_t)cols,max((int64_t)1,b/(int64_t)sizeof(double))));
+    sort(widths.begin(),widths.end());
+    widths.erase(unique(widths.begin(),widths.end()),widths.end());
+    return widths;
+  }
+
+  void exprToCacheBlocked(BenchExpr Expr, const OperandStore& exprOperands,int repeat,
+                          taco::util::TimeResults timevalue, int tileKB) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        // A^T is computed as the CSR matrix given by the CSC arrays of A
+        bool transposed = (Expr==MATTRANSMUL);
+        const Tensor<double>& A=exprOperands.at("A");
+        int rows=A.getDimension(transposed ? 1 : 0);
+        int cols=A.getDimension(transposed ? 0 : 1);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        if (transposed)
+          getCSCArrays(exprOperands.csc("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        else
+          getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+
+        double alpha=1.0;
+        double beta=0.0;
+        vector<double> x, z, y(rows);
+        tacoToVector(exprOperands.at("x"),x);
+        if (hasAlphaBeta(Expr)) {
+          alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          tacoToVector(exprOperands.at("z"),z);
+        }
+        int threads=benchThreads();
+        double flops=2.0*ia_CSR[rows];
+        cout << "CACHEBLOCKED: x is " << (double)cols*sizeof(double)/1024 << " KB, L2 "
+             << cacheBytes(2)/1024 << " KB, last-level cache " << cacheBytes(3)/1024 << " KB" << endl;
+
+        RowPartition partition=partitionCSR("nnz",rows,ia_CSR,threads);
+        taco::util::TimeResults flatTime, tuningTime, tiledTime;
+        string flatName="CACHEBLOCKED flat CSR "+to_string(threads)+" threads";
+        TACO_BENCH(partitionedSpMV(partition,ia_CSR,ja_CSR,a_CSR,x.data(),alpha,beta,z.data(),y.data());,
+                   "\n"+flatName,repeat,flatTime,true);
+        reportGFLOPS(flatName,flops,flatTime);
+
+        // Build and run each candidate a few times, keeping the fastest
+        vector<int> candidates;
+        if (tileKB > 0)
+          candidates.push_back((int)min((int64_t)cols,max((int64_t)1,(int64_t)tileKB*1024/(int64_t)sizeof(double))));
+        else
+          candidates=tileCandidates(cols,threads);
+        int best=candidates.front();
+        double bestTime=0.0;
+        auto begin=std::chrono::steady_clock::now();
+        if (candidates.size() > 1) {
+          for (int width : candidates) {
+            TiledCSR ATiled;
+            buildTiledCSR(rows,cols,ia_CSR,ja_CSR,a_CSR,width,threads,ATiled);
+            string name="CACHEBLOCKED tuning "+to_string(width*sizeof(double)/1024)+" KB tiles";
+            TACO_BENCH(tiledSpMV(ATiled,x.data(),alpha,beta,z.data(),y.data());,
+                       name,min(repeat,3),timevalue,true);
+            if (width==candidates.front() || timevalue.mean < bestTime) {
+              best=width;
+              bestTime=timevalue.mean;
+            }
+          }
+        }
+        tuningTime.mean=std::chrono::duration<double,std::milli>(
+            std::chrono::steady_clock::now()-begin).count();
+        cout << "CACHEBLOCKED " << (tileKB > 0 ? "given" : "tuned") << " tile: " << best
+             << " columns (" << best*sizeof(double)/1024 << " KB of x)" << endl;
+
+        TiledCSR ATiled;
+        TACO_BENCH(buildTiledCSR(rows,cols,ia_CSR,ja_CSR,a_CSR,best,threads,ATiled);,
+                   "\nCACHEBLOCKED preprocessing",1,timevalue,false);
+        cout << "CACHEBLOCKED: " << ATiled.tiles() << " tiles on " << ATiled.threads() << " panels" << endl;
+        string name="CACHEBLOCKED "+to_string(threads)+" threads";
+        TACO_BENCH(tiledSpMV(ATiled,x.data(),alpha,beta,z.data(),y.data());,name,repeat,tiledTime,true);
+        reportGFLOPS(name,flops,tiledTime);
+        reportBreakEven(name,tuningTime.mean+timevalue.mean,flatTime,tiledTime);
+        Tensor<double> y_tiled({rows}, Dense);
+        VectorTotaco(y,y_tiled);
+        validate(name, y_tiled, exprOperands.at("yRef"), reassociationTolerance);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for CACHEBLOCKED" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration cacheBlockedRegistration("CACHEBLOCKED",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToCacheBlocked(run.expr,run.operands,run.repeat,timevalue,
+                           run.parameters.count("xtile") ? stoi(run.parameters.at("xtile")) : 0);
+      });
@@ -0,0 +1,104 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+// Native CSR kernels working directly on taco's index arrays. The values are
+// stored as V while vectors and accumulation use T, so that <float,float> is
+// single precision and <float,double> is mixed precision.
+
+  // y = alpha*A*x + beta*z, z is not read when beta is zero
+  template<typename V, typename T>
+  void csrSpMV(int rows, const int* pos, const int* crd, const V* vals,
+               const T* x, T alpha, T beta, const T* z, T* y) {
+    if (beta == T(0)) {
+      #pragma omp parallel for schedule(static)
+      for (int i=0; i<rows; i++) {
+        T sum=0;
+        for (int p=pos[i]; p<pos[i+1]; p++)
+          sum+=(T)vals[p]*x[crd[p]];
+        y[i]=alpha*sum;
+      }
+    }
+    else {
+      #pragma omp parallel for schedule(static)
+      for (int i=0; i<rows; i++) {
+        T sum=0;
+        for (int p=pos[i]; p<pos[i+1]; p++)
+          sum+=(T)vals[p]*x[crd[p]];
+        y[i]=alpha*sum+beta*z[i];
+      }
+    }
+  }
+
+  template<typename T>
+  void tacoToVector(const Tensor<double>& src, vector<T>& dst) {
+    double* vals=(double*)(src.getStorage().getValues().getData());
+    dst.assign(vals, vals+src.getDimension(0));
+  }
+
+  template<typename T>
+  void VectorTotaco(const vector<T>& src, Tensor<double>& dst) {
+    for (int i=0; i<dst.getDimension(0); ++i)
+      dst.insert({i}, (double)src[i]);
+    dst.pack();
+  }
+
+  template<typename V, typename T>
+  void exprToCSR(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                 string name, double tolerance) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        // A^T is computed as the CSR matrix given by the CSC arrays of A
+        bool transposed = (Expr==MATTRANSMUL);
+        const Tensor<double>& A=exprOperands.at("A");
+        int rows=A.getDimension(transposed ? 1 : 0);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        if (transposed)
+          getCSCArrays(exprOperands.csc("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        else
+          getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        vector<V> vals(a_CSR, a_CSR+ia_CSR[rows]);
+
+        T alpha=1;
+        T beta=0;
+        vector<T> x, z, y(rows);
+        tacoToVector(exprOperands.at("x"),x);
+        if (hasAlphaBeta(Expr)) {
+          alpha = (T)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = (T)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          tacoToVector(exprOperands.at("z"),z);
+        }
+
+        TACO_BENCH(csrSpMV(rows,ia_CSR,ja_CSR,vals.data(),x.data(),alpha,beta,z.data(),y.data());,
+                   "\nCSR "+name,repeat,timevalue,true);
+        reportGFLOPS("CSR "+name,2.0*ia_CSR[rows],timevalue);
+
+        Tensor<double> y_csr({rows}, Dense);
+        VectorTotaco(y,y_csr);
+
+        validate("CSR "+name, y_csr, exprOperands.at("yRef"), tolerance);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for native CSR" << endl;
+        break;
+    }
+  }
+
+  // Runs in double precision, then in the precision of -precision
+  static ProductRegistration csrRegistration("CSR",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV},
+      true, true, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToCSR<double,double>(run.expr,run.operands,run.repeat,timevalue,"f64",tolerance(F64));
+        if (run.precision==F32)
+          exprToCSR<float,float>(run.expr,run.operands,run.repeat,timevalue,"f32",tolerance(F32));
+        else if (run.precision==Mixed)
+          exprToCSR<float,double>(run.expr,run.operands,run.repeat,timevalue,"mixed",tolerance(Mixed));
+      });
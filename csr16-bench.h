@@ -0,0 +1,188 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <cstdint>
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// CSR with compressed column indices: each row stores the column of its first
+// nonzero as a base and its columns as 16-bit deltas from that base. The tail
+// of a row spanning more than 65536 columns is an escape block that keeps
+// 32-bit indices. Row pointers and values are shared with taco.
+// Kernel compiled in, printed with the results as the scalar one is much
+// slower than the SIMD ones
+#if defined(__AVX512F__)
+const char csr16Kernel[]="AVX-512";
+#elif defined(__AVX2__) && defined(__FMA__)
+const char csr16Kernel[]="AVX2";
+#else
+const char csr16Kernel[]="scalar (build with -DNATIVE_ARCH=ON for AVX2 or AVX-512)";
+#endif
+
+struct CSR16 {
+  int rows;
+  int nnz;
+  const int* pos;
+  const double* vals;
+  vector<int> base;
+  vector<uint16_t> delta;
+  // escape blocks, only allocated when at least one row needs one
+  vector<int> escPos;
+  vector<int> escCrd;
+
+  size_t indexBytes() const {
+    return (rows+1)*sizeof(int) + base.size()*sizeof(int) + delta.size()*sizeof(uint16_t)
+           + escPos.size()*sizeof(int) + escCrd.size()*sizeof(int);
+  }
+};
+
+  void buildCSR16(int rows, const int* pos, const int* crd, const double* vals, CSR16& dst) {
+    dst.rows=rows;
+    dst.nnz=pos[rows];
+    dst.pos=pos;
+    dst.vals=vals;
+    dst.base.assign(rows,0);
+    dst.delta.assign(dst.nnz,0);
+    dst.escPos.clear();
+    dst.escCrd.clear();
+
+    vector<int> escPos(rows+1,0);
+    for (int i=0; i<rows; i++) {
+      if (pos[i]<pos[i+1])
+        dst.base[i]=crd[pos[i]];
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        long delta=(long)crd[p]-dst.base[i];
+        if (delta>UINT16_MAX) {
+          // the rest of the row is sorted, so it is escaped as a whole
+          dst.escCrd.insert(dst.escCrd.end(),crd+p,crd+pos[i+1]);
+          break;
+        }
+        dst.delta[p]=(uint16_t)delta;
+      }
+      escPos[i+1]=dst.escCrd.size();
+    }
+    if (!dst.escCrd.empty())
+      dst.escPos.swap(escPos);
+  }
+
+  // Dot product of row i with x, decoding 16-bit deltas with SIMD gathers
+  inline double csr16Row(const CSR16& A, int i, const double* x) {
+    const int end=A.pos[i+1];
+    const int escapes=A.escPos.empty() ? 0 : A.escPos[i+1]-A.escPos[i];
+    const int split=end-escapes;
+    const int base=A.base[i];
+    const uint16_t* delta=A.delta.data();
+    const double* vals=A.vals;
+    double sum=0.0;
+    int p=A.pos[i];
+#if defined(__AVX512F__)
+    __m512d acc=_mm512_setzero_pd();
+    __m256i vbase=_mm256_set1_epi32(base);
+    for (; p+8<=split; p+=8) {
+      __m256i idx=_mm256_add_epi32(vbase,_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(delta+p))));
+      acc=_mm512_fmadd_pd(_mm512_loadu_pd(vals+p),_mm512_i32gather_pd(idx,x,8),acc);
+    }
+    sum=_mm512_reduce_add_pd(acc);
+#elif defined(__AVX2__) && defined(__FMA__)
+    __m256d acc=_mm256_setzero_pd();
+    __m128i vbase=_mm_set1_epi32(base);
+    for (; p+4<=split; p+=4) {
+      __m128i idx=_mm_add_epi32(vbase,_mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(delta+p))));
+      acc=_mm256_fmadd_pd(_mm256_loadu_pd(vals+p),_mm256_i32gather_pd(x,idx,8),acc);
+    }
+    __m128d half=_mm_add_pd(_mm256_castpd256_pd128(acc),_mm256_extractf128_pd(acc,1));
+    sum=_mm_cvtsd_f64(_mm_hadd_pd(half,half));
+#endif
+    for (; p<split; p++)
+      sum+=vals[p]*x[base+delta[p]];
+    if (escapes) {
+      const int* escCrd=A.escCrd.data()+A.escPos[i];
+      for (int e=0; p<end; p++, e++)
+        sum+=vals[p]*x[escCrd[e]];
+    }
+    return sum;
+  }
+
+  // y = alpha*A*x + beta*z, z is not read when beta is zero
+  void csr16SpMV(const CSR16& A, const double* x, double alpha, double beta,
+                 const double* z, double* y) {
+    if (beta == 0.0) {
+      #pragma omp parallel for schedule(static)
+      for (int i=0; i<A.rows; i++)
+        y[i]=alpha*csr16Row(A,i,x);
+    }
+    else {
+      #pragma omp parallel for schedule(static)
+      for (int i=0; i<A.rows; i++)
+        y[i]=alpha*csr16Row(A,i,x)+beta*z[i];
+    }
+  }
+
+  void exprToCSR16(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        // A^T is computed as the CSR matrix given by the CSC arrays of A
+        bool transposed = (Expr==MATTRANSMUL);
+        const Tensor<double>& A=exprOperands.at("A");
+        int rows=A.getDimension(transposed ? 1 : 0);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        if (transposed)
+          getCSCArrays(exprOperands.csc("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        else
+          getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        int nnz=ia_CSR[rows];
+
+        CSR16 A16;
+        TACO_BENCH(buildCSR16(rows,ia_CSR,ja_CSR,a_CSR,A16);,"\nCSR16 encode",1,timevalue,false);
+        size_t csrIndexBytes=(rows+1+nnz)*sizeof(int);
+        size_t valueBytes=nnz*sizeof(double);
+        cout << "CSR16 kernel: " << csr16Kernel << endl;
+        cout << "CSR16 escaped nonzeros: " << A16.escCrd.size() << endl;
+        cout << "CSR16 index compression ratio: "
+             << (double)csrIndexBytes/A16.indexBytes() << endl;
+        cout << "CSR16 matrix compression ratio: "
+             << (double)(csrIndexBytes+valueBytes)/(A16.indexBytes()+valueBytes) << endl;
+
+        double alpha=1.0;
+        double beta=0.0;
+        vector<double> x, z, y(rows);
+        tacoToVector(exprOperands.at("x"),x);
+        if (hasAlphaBeta(Expr)) {
+          alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          tacoToVector(exprOperands.at("z"),z);
+        }
+
+        taco::util::TimeResults csrTime, csr16Time;
+        TACO_BENCH(csrSpMV(rows,ia_CSR,ja_CSR,a_CSR,x.data(),alpha,beta,z.data(),y.data());,
+                   "CSR",repeat,csrTime,true);
+        TACO_BENCH(csr16SpMV(A16,x.data(),alpha,beta,z.data(),y.data());,
+                   "CSR16",repeat,csr16Time,true);
+        cout << "CSR16 speedup over CSR: " << csrTime.mean/csr16Time.mean << endl;
+
+        Tensor<double> y_csr16({rows}, Dense);
+        VectorTotaco(y,y_csr16);
+
+        validate("CSR16", y_csr16, exprOperands.at("yRef"), reassociationTolerance);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for CSR16" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration csr16Registration("CSR16",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToCSR16(run.expr,run.operands,run.repeat,timevalue);
+      });
@@ -0,0 +1,158 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+// Merge-based SpMV in the style of CSR5: the nonzeros of taco's CSR arrays
+// are cut into tiles of a fixed number of nonzeros whatever the row lengths.
+// A tile multiplies all its nonzeros with full SIMD lanes, then sums them by
+// row segment. Rows crossing a tile boundary are finished by the tile they
+// start in, and the heads computed by the following tiles are added after.
+// The tile descriptors only add the row of the first nonzero of each tile,
+// and the empty rows no tile visits, to the CSR arrays.
+const int csr5Sigma=16;
+#if defined(__AVX512F__)
+const int csr5TileSize=8*csr5Sigma;
+#else
+const int csr5TileSize=4*csr5Sigma;
+#endif
+
+struct CSR5 {
+  int rows;
+  int nnz;
+  const int* pos;
+  const int* crd;
+  const double* vals;
+  vector<int> tileRow;    // row of the first nonzero of each tile
+  vector<int> emptyRows;  // empty rows starting at a tile boundary
+  mutable vector<double> carry;  // head of the first row of each tile, set by csr5SpMV
+
+  int tiles() const { return (int)tileRow.size(); }
+};
+
+  void CSRToCSR5(int rows, const int* pos, const int* crd, const double* vals, CSR5& dst) {
+    dst.rows=rows;
+    dst.nnz=pos[rows];
+    dst.pos=pos;
+    dst.crd=crd;
+    dst.vals=vals;
+    int tiles=(dst.nnz+csr5TileSize-1)/csr5TileSize;
+    dst.tileRow.resize(tiles);
+    #pragma omp parallel for schedule(static)
+    for (int t=0; t<tiles; t++)
+      dst.tileRow[t]=(int)(std::upper_bound(pos,pos+rows+1,t*csr5TileSize)-pos)-1;
+    dst.emptyRows.clear();
+    for (int i=0; i<rows; i++) {
+      if (pos[i]==pos[i+1] && (pos[i]%csr5TileSize==0 || pos[i]==dst.nnz))
+        dst.emptyRows.push_back(i);
+    }
+    dst.carry.assign(tiles,0.0);
+  }
+
+  // y = alpha*A*x + beta*z on <threads> threads, z is not read when beta is zero
+  void csr5SpMV(const CSR5& A, const double* x, double alpha, double beta,
+                const double* z, double* y, int threads) {
+    int tiles=A.tiles();
+    double* carry=A.carry.data();
+    #pragma omp parallel for schedule(static) num_threads(threads)
+    for (int t=0; t<tiles; t++) {
+      double products[csr5TileSize];
+      carry[t]=0.0;
+      int first=t*csr5TileSize;
+      int last=min(first+csr5TileSize,A.nnz);
+      const int* crd=A.crd+first;
+      const double* vals=A.vals+first;
+      #pragma omp simd
+      for (int k=0; k<last-first; k++)
+        products[k]=vals[k]*x[crd[k]];
+
+      for (int i=A.tileRow[t]; i<A.rows && A.pos[i]<last; i++) {
+        int begin=max(A.pos[i],first);
+        int end=min(A.pos[i+1],last);
+        double sum=0.0;
+        #pragma omp simd reduction(+:sum)
+        for (int k=begin; k<end; k++)
+          sum+=products[k-first];
+        if (A.pos[i] < first)
+          carry[t]=sum;
+        else
+          y[i] = (beta == 0.0) ? alpha*sum : alpha*sum+beta*z[i];
+      }
+    }
+    for (int t=0; t<tiles; t++) {
+      if (carry[t] != 0.0)
+        y[A.tileRow[t]]+=alpha*carry[t];
+    }
+    for (int i : A.emptyRows)
+      y[i] = (beta == 0.0) ? 0.0 : beta*z[i];
+  }
+
+  // Build the tile descriptors, then benchmark and validate y = alpha*A*x + beta*z
+  // on one thread and on all of them
+  void benchCSR5(int rows, const int* pos, const int* crd, const double* vals,
+                 const vector<double>& x, double alpha, double beta, const vector<double>& z,
+                 const Tensor<double>& yRef, int repeat, taco::util::TimeResults timevalue) {
+    CSR5 ACSR5;
+    TACO_BENCH(CSRToCSR5(rows,pos,crd,vals,ACSR5);,"\nCSR5 preprocessing",1,timevalue,false);
+    cout << "CSR5: " << ACSR5.tiles() << " tiles of " << csr5TileSize << " nonzeros, "
+         << ACSR5.emptyRows.size() << " empty rows at tile boundaries" << endl;
+
+    vector<int> threadCounts={1};
+    if (benchThreads() > 1)
+      threadCounts.push_back(benchThreads());
+    for (int threads : threadCounts) {
+      string name=(threads==1) ? string("CSR5 serial") : "CSR5 "+to_string(threads)+" threads";
+      vector<double> y(rows);
+      benchNextPhaseOn(threads);
+      TACO_BENCH(csr5SpMV(ACSR5,x.data(),alpha,beta,z.data(),y.data(),threads);,name,repeat,timevalue,true);
+      reportGFLOPS(name,2.0*ACSR5.nnz,timevalue);
+
+      Tensor<double> y_csr5({rows}, Dense);
+      VectorTotaco(y,y_csr5);
+      validate(name, y_csr5, yRef, reassociationTolerance);
+    }
+  }
+
+  void exprToCSR5(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        // A^T is computed as the CSR matrix given by the CSC arrays of A
+        bool transposed = (Expr==MATTRANSMUL);
+        const Tensor<double>& A=exprOperands.at("A");
+        int rows=A.getDimension(transposed ? 1 : 0);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        if (transposed)
+          getCSCArrays(exprOperands.csc("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        else
+          getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+
+        double alpha=1.0;
+        double beta=0.0;
+        vector<double> x, z;
+        tacoToVector(exprOperands.at("x"),x);
+        if (hasAlphaBeta(Expr)) {
+          alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          tacoToVector(exprOperands.at("z"),z);
+        }
+
+        benchCSR5(rows,ia_CSR,ja_CSR,a_CSR,x,alpha,beta,z,exprOperands.at("yRef"),repeat,timevalue);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for CSR5" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration csr5Registration("CSR5",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToCSR5(run.expr,run.operands,run.repeat,timevalue);
+      });
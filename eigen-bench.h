@@ -5,167 +5,517 @@ using namespace std;
 
 #ifdef EIGEN
 #include <Eigen/Sparse>
-typedef Eigen::Matrix<double,Eigen::Dynamic,1> DenseVector;
-typedef Eigen::SparseMatrix<double> EigenCSC;
-typedef Eigen::SparseMatrix<double, Eigen::RowMajor> EigenCSR;
-typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic> EigenColMajor;
-typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic, Eigen::RowMajor> EigenRowMajor;
+template<typename T> using DenseVector = Eigen::Matrix<T,Eigen::Dynamic,1>;
+template<typename T> using EigenCSC = Eigen::SparseMatrix<T>;
+template<typename T> using EigenCSR = Eigen::SparseMatrix<T, Eigen::RowMajor>;
+template<typename T> using EigenColMajor = Eigen::Matrix<T,Eigen::Dynamic,Eigen::Dynamic>;
+template<typename T> using EigenRowMajor = Eigen::Matrix<T,Eigen::Dynamic,Eigen::Dynamic, Eigen::RowMajor>;
 
-  void EigenTotaco(const EigenCSC& src, Tensor<double>& dst)
+// Eigen only runs sparse products in parallel when the sparse operand is
+// row-major. CODE is timed on one thread, then on Eigen::nbThreads() threads.
+#define EIGEN_BENCH_THREADS(CODE, NAME, REPEAT, TIMER) {                       \
+    int threads=Eigen::nbThreads();                                           \
+    Eigen::setNbThreads(1);                                                   \
+    benchNextPhaseOn(1);                                                      \
+    TACO_BENCH(CODE, NAME, REPEAT, TIMER, true);                              \
+    Eigen::setNbThreads(threads);                                             \
+    benchNextPhaseOn(threads);                                                \
+    TACO_BENCH(CODE, string(NAME)+" "+to_string(threads)+" threads", REPEAT, TIMER, true); \
+}
+
+  template<typename T>
+  void EigenTotaco(const EigenCSC<T>& src, Tensor<double>& dst)
   {
     for (int j=0; j<src.cols(); ++j)
-      for (EigenCSC::InnerIterator it(src.derived(), j); it; ++it)
+      for (typename EigenCSC<T>::InnerIterator it(src.derived(), j); it; ++it)
         dst.insert({it.index(),j}, it.value());
     dst.pack();
   }
 
-  void tacoToEigen(const Tensor<double>& src, EigenCSC& dst){
+  template<typename T>
+  void tacoToEigen(const Tensor<double>& src, EigenCSC<T>& dst){
     taco_uassert(src.getFormat()==CSC)<<"Tensor have to be in CSC format to be converted to Eigen";
-    std::vector< Eigen::Triplet<double> > tripletList;
+    std::vector< Eigen::Triplet<T> > tripletList;
     tripletList.reserve(src.getStorage().getValues().getSize());
     for (auto& value : iterate<double>(src)) {
-      tripletList.push_back({value.first.at(0),value.first.at(1),value.second});
+      tripletList.push_back({value.first.at(0),value.first.at(1),(T)value.second});
     }
     dst.setFromTriplets(tripletList.begin(), tripletList.end());
   }
 
-  void tacoToEigen(const Tensor<double>& src, EigenCSR& dst){
+  template<typename T>
+  void tacoToEigen(const Tensor<double>& src, EigenCSR<T>& dst){
     taco_uassert(src.getFormat()==CSR)<<"Tensor have to be in CSR format to be converted to Eigen";
-    std::vector< Eigen::Triplet<double> > tripletList;
+    std::vector< Eigen::Triplet<T> > tripletList;
     tripletList.reserve(src.getStorage().getValues().getSize());
     for (auto& value : iterate<double>(src)) {
-      tripletList.push_back({value.first.at(0),value.first.at(1),value.second});
+      tripletList.push_back({value.first.at(0),value.first.at(1),(T)value.second});
     }
     dst.setFromTriplets(tripletList.begin(), tripletList.end());
   }
 
-  void tacoToEigen(const Tensor<double>& src, EigenColMajor& dst){
-    for (auto& value : iterate<double>(src)) {
-      dst(value.first.at(0),value.first.at(1)) = value.second;
+  // Dense taco matrices are converted with one assignment from a Map over
+  // their values, in whichever order taco stores them
+  template<typename M>
+  void tacoDenseToEigen(const Tensor<double>& src, M& dst){
+    typedef typename M::Scalar T;
+    const double* vals=(const double*)(src.getStorage().getValues().getData());
+    int rows=src.getDimension(0);
+    int cols=src.getDimension(1);
+    if (src.getFormat()==Format({Dense,Dense}))
+      dst = Eigen::Map<const EigenRowMajor<double>>(vals,rows,cols).template cast<T>();
+    else if (src.getFormat()==Format({Dense,Dense},{1,0}))
+      dst = Eigen::Map<const EigenColMajor<double>>(vals,rows,cols).template cast<T>();
+    else {
+      dst.setZero();
+      for (auto& value : iterate<double>(src))
+        dst(value.first.at(0),value.first.at(1)) = value.second;
     }
   }
 
-  void tacoToEigen(const Tensor<double>& src, EigenRowMajor& dst){
-    for (auto& value : iterate<double>(src)) {
-      dst(value.first.at(0),value.first.at(1)) = value.second;
-    }
+  template<typename T>
+  void tacoToEigen(const Tensor<double>& src, EigenColMajor<T>& dst){
+    tacoDenseToEigen(src,dst);
+  }
+
+  template<typename T>
+  void tacoToEigen(const Tensor<double>& src, EigenRowMajor<T>& dst){
+    tacoDenseToEigen(src,dst);
+  }
+
+  // Dense taco operand seen by Eigen as a rows x cols matrix M stored in the
+  // same order as taco. Double products map taco's values in place, other
+  // precisions get a converted copy.
+  template<typename M, typename T=typename M::Scalar>
+  struct EigenDenseView {
+    typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic,M::Options> DoubleMatrix;
+    M copy;
+    EigenDenseView(const Tensor<double>& src, int rows, int cols)
+        : copy(Eigen::Map<const DoubleMatrix>((const double*)(src.getStorage().getValues().getData()),rows,cols).template cast<T>()) {}
+    const M& get() const { return copy; }
+  };
+
+  template<typename M>
+  struct EigenDenseView<M,double> {
+    Eigen::Map<const M> map;
+    EigenDenseView(const Tensor<double>& src, int rows, int cols)
+        : map((const double*)(src.getStorage().getValues().getData()),rows,cols) {}
+    const Eigen::Map<const M>& get() const { return map; }
+  };
+
+  template<typename T>
+  void EigenTotaco(const EigenRowMajor<T>& src, Tensor<double>& dst)  {
+    for (int i=0; i<src.rows(); ++i)
+      for (int j=0; j<src.cols(); ++j)
+        dst.insert({i,j}, (double)src(i,j));
+    dst.pack();
   }
 
-  void EigenTotaco(const DenseVector& src, Tensor<double>& dst)  {
+  template<typename T>
+  void EigenTotaco(const DenseVector<T>& src, Tensor<double>& dst)  {
     for (int j=0; j<src.rows(); ++j)
       dst.insert({j}, src(j));
     dst.pack();
   }
 
-  void tacoToEigen(const Tensor<double>& src, DenseVector& dst)  {
+  template<typename T>
+  void tacoToEigen(const Tensor<double>& src, DenseVector<T>& dst)  {
     for (auto& value : iterate<double>(src))
       dst(value.first[0]) = value.second;
   }
 
-  void exprToEIGEN(BenchExpr Expr, map<string,Tensor<double>> exprOperands,int repeat, taco::util::TimeResults timevalue) {
+  // Dense operand of the store in the storage order of the Eigen matrix M
+  template<typename M>
+  const Tensor<double>& eigenLayoutOperand(const OperandStore& operands, string name) {
+    return M::IsRowMajor ? operands.rowMajor(name) : operands.colMajor(name);
+  }
+
+  template<typename M>
+  string eigenLayoutName() {
+    return denseLayoutNames[M::IsRowMajor ? RowMajorLayout : ColMajorLayout];
+  }
+
+  // SDDMM with C in the layout of MC and D in the layout of MD
+  template<typename T, typename MC, typename MD>
+  void benchEigenSDDMMLayout(const OperandStore& exprOperands, const EigenCSC<T>& BEigen,
+                             int repeat, taco::util::TimeResults timevalue) {
+    int rows=BEigen.rows();
+    int cols=BEigen.cols();
+    int Ksize=exprOperands.at("C").getDimension(1);
+    string name="Eigen C "+eigenLayoutName<MC>()+" D "+eigenLayoutName<MD>();
+    EigenDenseView<MC> CEigen(eigenLayoutOperand<MC>(exprOperands,"C"),rows,Ksize);
+    EigenDenseView<MD> DEigen(eigenLayoutOperand<MD>(exprOperands,"D"),Ksize,cols);
+    EigenCSC<T> AEigen(rows,cols);
+
+    TACO_BENCH(AEigen = BEigen.cwiseProduct(CEigen.get().lazyProduct(DEigen.get()));,name,repeat,timevalue,true);
+
+    Tensor<double> A_Eigen({rows,cols}, CSC);
+    EigenTotaco(AEigen,A_Eigen);
+    validate(name, A_Eigen, exprOperands.at("ARef"), precisionTolerance<T>());
+  }
+
+  // C = A*B with B in the layout of MB and C in the layout of MC
+  template<typename T, typename MB, typename MC>
+  void benchEigenSpMDMLayout(const OperandStore& exprOperands, const EigenCSR<T>& AEigen,
+                             int repeat, taco::util::TimeResults timevalue) {
+    int rows=AEigen.rows();
+    int Ksize=AEigen.cols();
+    int cols=exprOperands.at("B").getDimension(1);
+    string name="Eigen B "+eigenLayoutName<MB>()+" C "+eigenLayoutName<MC>();
+    EigenDenseView<MB> BEigen(eigenLayoutOperand<MB>(exprOperands,"B"),Ksize,cols);
+    MC CEigen(rows,cols);
+
+    EIGEN_BENCH_THREADS(CEigen.noalias() = AEigen * BEigen.get();,name,repeat,timevalue);
+
+    EigenRowMajor<T> CRowMajor=CEigen;
+    Tensor<double> C_Eigen({rows,cols}, Format({Dense,Dense}));
+    EigenTotaco(CRowMajor,C_Eigen);
+    validate(name, C_Eigen, exprOperands.at("CRef"), max(precisionTolerance<T>(),reassociationTolerance));
+  }
+
+  // y = alpha*A*x + beta*z with a symmetric A multiplied from its lower
+  // triangle, next to the full-storage runs. A^T = A for MATTRANSMUL.
+  template<typename T>
+  void benchEigenSymmetric(const OperandStore& exprOperands, const DenseVector<T>& xEigen,
+                           T alpha, T beta, const DenseVector<T>& zEigen, bool alphaBeta,
+                           int repeat, taco::util::TimeResults timevalue) {
+    int rows=xEigen.size();
+    DenseVector<T> yEigen(rows);
+    EigenCSR<T> ALowerEigen(rows,rows);
+    TACO_BENCH(tacoToEigen(exprOperands.csr("ALower"),ALowerEigen);,"\nEigen symmetric conversion",1,timevalue,false);
+    if (alphaBeta) {
+      // a self-adjoint view only multiplies, so alpha goes to x
+      TACO_BENCH(yEigen = beta * zEigen;
+                 yEigen.noalias() += ALowerEigen.template selfadjointView<Eigen::Lower>() * (alpha * xEigen);,
+                 "Eigen symmetric",repeat,timevalue,true);
+    }
+    else {
+      TACO_BENCH(yEigen.noalias() = ALowerEigen.template selfadjointView<Eigen::Lower>() * xEigen;,
+                 "Eigen symmetric",repeat,timevalue,true);
+    }
+
+    Tensor<double> y_EigenSymmetric({rows}, Dense);
+    EigenTotaco(yEigen,y_EigenSymmetric);
+    validate("Eigen symmetric", y_EigenSymmetric, exprOperands.at("yRef"), max(precisionTolerance<T>(),reassociationTolerance));
+  }
+
+  template<typename T>
+  void exprToEIGEN(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                   int power, bool layouts) {
     switch(Expr) {
-      case SpMV: {
+      case SpMV:
+      case SparsityTTV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        DenseVector xEigen(cols);
-        DenseVector yEigen(rows);
-        EigenCSR AEigen(rows,cols);
+        DenseVector<T> xEigen(cols);
+        DenseVector<T> yEigen(rows);
+        EigenCSR<T> AEigen(rows,cols);
 
-        tacoToEigen(exprOperands.at("x"),xEigen);
-        tacoToEigen(exprOperands.at("A"),AEigen);
+        TACO_BENCH(tacoToEigen(exprOperands.at("x"),xEigen);
+                   tacoToEigen(exprOperands.at("A"),AEigen);,"\nEigen conversion",1,timevalue,false);
 
-        TACO_BENCH(yEigen.noalias() = AEigen * xEigen;,"\nEigen",repeat,timevalue,true);
+        EIGEN_BENCH_THREADS(yEigen.noalias() = AEigen * xEigen;,"Eigen",repeat,timevalue);
 
         Tensor<double> y_Eigen({rows}, Dense);
         EigenTotaco(yEigen,y_Eigen);
 
-        validate("Eigen", y_Eigen, exprOperands.at("yRef"));
+        validate("Eigen", y_Eigen, exprOperands.at("yRef"), precisionTolerance<T>());
+
+        if (exprOperands.count("ADense")) {
+          EigenDenseView<EigenRowMajor<T>> ADense(exprOperands.at("ADense"),rows,cols);
+          TACO_BENCH(yEigen.noalias() = ADense.get() * xEigen;,"Eigen dense",repeat,timevalue,true);
+
+          Tensor<double> y_EigenDense({rows}, Dense);
+          EigenTotaco(yEigen,y_EigenDense);
+          validate("Eigen dense", y_EigenDense, exprOperands.at("yRef"), max(precisionTolerance<T>(),reassociationTolerance));
+        }
+
+        // A symmetric A is also multiplied from its lower triangle
+        if (exprOperands.count("ALower"))
+          benchEigenSymmetric<T>(exprOperands,xEigen,T(1),T(0),xEigen,false,repeat,timevalue);
         break;
       }
       case PLUS3: {
         int rows=exprOperands.at("ARef").getDimension(0);
         int cols=exprOperands.at("ARef").getDimension(1);
-        EigenCSC AEigen(rows,cols);
-        EigenCSC BEigen(rows,cols);
-        EigenCSC CEigen(rows,cols);
-        EigenCSC DEigen(rows,cols);
+        EigenCSC<T> AEigen(rows,cols);
+        EigenCSC<T> BEigen(rows,cols);
+        EigenCSC<T> CEigen(rows,cols);
+        EigenCSC<T> DEigen(rows,cols);
 
-        tacoToEigen(exprOperands.at("B"),BEigen);
-        tacoToEigen(exprOperands.at("C"),CEigen);
-        tacoToEigen(exprOperands.at("D"),DEigen);
+        TACO_BENCH(tacoToEigen(exprOperands.at("B"),BEigen);
+                   tacoToEigen(exprOperands.at("C"),CEigen);
+                   tacoToEigen(exprOperands.at("D"),DEigen);,"\nEigen conversion",1,timevalue,false);
 
-        TACO_BENCH(AEigen = BEigen + CEigen + DEigen;,"\nEigen",repeat,timevalue,true);
+        TACO_BENCH(AEigen = BEigen + CEigen + DEigen;,"Eigen",repeat,timevalue,true);
 
         Tensor<double> A_Eigen({rows,cols}, CSC);
         EigenTotaco(AEigen,A_Eigen);
 
-        validate("Eigen", A_Eigen, exprOperands.at("ARef"));
+        validate("Eigen", A_Eigen, exprOperands.at("ARef"), precisionTolerance<T>());
         break;
       }
       case MATTRANSMUL: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        DenseVector xEigen(cols);
-        DenseVector zEigen(rows);
-        DenseVector yEigen(rows);
-        double alpha, beta;
-        EigenCSC AEigen(rows,cols);
+        DenseVector<T> xEigen(cols);
+        DenseVector<T> zEigen(rows);
+        DenseVector<T> yEigen(rows);
+        T alpha, beta;
+        EigenCSC<T> AEigen(rows,cols);
 
-        tacoToEigen(exprOperands.at("x"),xEigen);
-        tacoToEigen(exprOperands.at("z"),zEigen);
-        tacoToEigen(exprOperands.at("A"),AEigen);
-        alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
-        beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+        TACO_BENCH(tacoToEigen(exprOperands.at("x"),xEigen);
+                   tacoToEigen(exprOperands.at("z"),zEigen);
+                   tacoToEigen(exprOperands.at("A"),AEigen);,"\nEigen conversion",1,timevalue,false);
+        alpha = (T)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+        beta = (T)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
 
-        TACO_BENCH(yEigen.noalias() = alpha *AEigen.transpose() * xEigen + beta * zEigen;,"\nEigen",repeat,timevalue,true);
+        TACO_BENCH(yEigen.noalias() = alpha *AEigen.transpose() * xEigen + beta * zEigen;,"Eigen",repeat,timevalue,true);
 
         Tensor<double> y_Eigen({rows}, Dense);
         EigenTotaco(yEigen,y_Eigen);
 
-        validate("Eigen", y_Eigen, exprOperands.at("yRef"));
+        validate("Eigen", y_Eigen, exprOperands.at("yRef"), precisionTolerance<T>());
+
+        // The CSC arrays of A are the CSR arrays of A^T, which Eigen can
+        // multiply row by row and in parallel
+        EigenCSR<T> ATEigen(cols,rows);
+        TACO_BENCH(ATEigen = AEigen.transpose();,"\nEigen RowMajor conversion",1,timevalue,false);
+
+        EIGEN_BENCH_THREADS(yEigen.noalias() = alpha * ATEigen * xEigen + beta * zEigen;,"Eigen RowMajor",repeat,timevalue);
+
+        Tensor<double> y_EigenRowMajor({rows}, Dense);
+        EigenTotaco(yEigen,y_EigenRowMajor);
+
+        validate("Eigen RowMajor", y_EigenRowMajor, exprOperands.at("yRef"), precisionTolerance<T>());
+
+        if (exprOperands.count("ALower"))
+          benchEigenSymmetric<T>(exprOperands,xEigen,alpha,beta,zEigen,true,repeat,timevalue);
         break;
       }
-      case RESIDUAL: {
+      case RESIDUAL:
+      case SparsitySpMV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        DenseVector xEigen(cols);
-        DenseVector zEigen(rows);
-        DenseVector yEigen(rows);
-        double alpha, beta;
-        EigenCSR AEigen(rows,cols);
+        DenseVector<T> xEigen(cols);
+        DenseVector<T> zEigen(rows);
+        DenseVector<T> yEigen(rows);
+        T alpha, beta;
+        EigenCSR<T> AEigen(rows,cols);
 
-        tacoToEigen(exprOperands.at("x"),xEigen);
-        tacoToEigen(exprOperands.at("z"),zEigen);
-        tacoToEigen(exprOperands.at("A"),AEigen);
-        alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
-        beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+        TACO_BENCH(tacoToEigen(exprOperands.at("x"),xEigen);
+                   tacoToEigen(exprOperands.at("z"),zEigen);
+                   tacoToEigen(exprOperands.at("A"),AEigen);,"\nEigen conversion",1,timevalue,false);
+        alpha = (T)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+        beta = (T)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
 
-        TACO_BENCH(yEigen.noalias() = zEigen - AEigen * xEigen ;,"\nEigen",repeat,timevalue,true);
+        // RESIDUAL is given as alpha=-1 and beta=1
+        EIGEN_BENCH_THREADS(yEigen.noalias() = alpha * AEigen * xEigen + beta * zEigen;,"Eigen",repeat,timevalue);
 
         Tensor<double> y_Eigen({rows}, Dense);
         EigenTotaco(yEigen,y_Eigen);
 
-        validate("Eigen", y_Eigen, exprOperands.at("yRef"));
+        validate("Eigen", y_Eigen, exprOperands.at("yRef"), precisionTolerance<T>());
+
+        if (exprOperands.count("ADense")) {
+          EigenDenseView<EigenRowMajor<T>> ADense(exprOperands.at("ADense"),rows,cols);
+          TACO_BENCH(yEigen.noalias() = alpha * ADense.get() * xEigen + beta * zEigen;,"Eigen dense",repeat,timevalue,true);
+
+          Tensor<double> y_EigenDense({rows}, Dense);
+          EigenTotaco(yEigen,y_EigenDense);
+          validate("Eigen dense", y_EigenDense, exprOperands.at("yRef"), max(precisionTolerance<T>(),reassociationTolerance));
+        }
+
+        if (exprOperands.count("ALower"))
+          benchEigenSymmetric<T>(exprOperands,xEigen,alpha,beta,zEigen,true,repeat,timevalue);
         break;
       }
       case SDDMM: {
         int rows=exprOperands.at("ARef").getDimension(0);
         int cols=exprOperands.at("ARef").getDimension(1);
-        EigenCSC AEigen(rows,cols);
-        EigenCSC BEigen(rows,cols);
-        EigenRowMajor CEigen(rows,100);
-        EigenColMajor DEigen(100,cols);
+        EigenCSC<T> AEigen(rows,cols);
+        EigenCSC<T> BEigen(rows,cols);
+        int Ksize=exprOperands.at("C").getDimension(1);
 
-        tacoToEigen(exprOperands.at("B"),BEigen);
-        tacoToEigen(exprOperands.at("C"),CEigen);
-        tacoToEigen(exprOperands.at("D"),DEigen);
+        // C is row-major and D column-major in taco, as Eigen wants them
+        TACO_BENCH(tacoToEigen(exprOperands.at("B"),BEigen);,"\nEigen conversion",1,timevalue,false);
+        EigenDenseView<EigenRowMajor<T>> CEigen(exprOperands.at("C"),rows,Ksize);
+        EigenDenseView<EigenColMajor<T>> DEigen(exprOperands.at("D"),Ksize,cols);
 
-        TACO_BENCH(AEigen = BEigen.cwiseProduct(CEigen.lazyProduct(DEigen));,"\nEigen",repeat,timevalue,true);
+        TACO_BENCH(AEigen = BEigen.cwiseProduct(CEigen.get().lazyProduct(DEigen.get()));,"Eigen",repeat,timevalue,true);
 
         Tensor<double> A_Eigen({rows,cols}, CSC);
         EigenTotaco(AEigen,A_Eigen);
 
-        validate("Eigen", A_Eigen, exprOperands.at("ARef"));
+        validate("Eigen", A_Eigen, exprOperands.at("ARef"), precisionTolerance<T>());
+
+        // the other three combinations of row-major and column-major C and D
+        if (layouts) {
+          benchEigenSDDMMLayout<T,EigenRowMajor<T>,EigenRowMajor<T>>(exprOperands,BEigen,repeat,timevalue);
+          benchEigenSDDMMLayout<T,EigenColMajor<T>,EigenRowMajor<T>>(exprOperands,BEigen,repeat,timevalue);
+          benchEigenSDDMMLayout<T,EigenColMajor<T>,EigenColMajor<T>>(exprOperands,BEigen,repeat,timevalue);
+        }
+        break;
+      }
+      case SparsitySpMDM: {
+        int rows=exprOperands.at("A").getDimension(0);
+        int cols=exprOperands.at("B").getDimension(1);
+        int Ksize=exprOperands.at("A").getDimension(1);
+        EigenCSR<T> AEigen(rows,Ksize);
+        EigenRowMajor<T> CEigen(rows,cols);
+
+        TACO_BENCH(tacoToEigen(exprOperands.at("A"),AEigen);,"\nEigen conversion",1,timevalue,false);
+        EigenDenseView<EigenRowMajor<T>> BEigen(exprOperands.at("B"),Ksize,cols);
+
+        EIGEN_BENCH_THREADS(CEigen.noalias() = AEigen * BEigen.get();,"Eigen",repeat,timevalue);
+
+        Tensor<double> C_Eigen({rows,cols}, Format({Dense,Dense}));
+        EigenTotaco(CEigen,C_Eigen);
+
+        validate("Eigen", C_Eigen, exprOperands.at("CRef"), max(precisionTolerance<T>(),reassociationTolerance));
+
+        // the other three combinations of row-major and column-major B and C
+        if (layouts) {
+          benchEigenSpMDMLayout<T,EigenRowMajor<T>,EigenColMajor<T>>(exprOperands,AEigen,repeat,timevalue);
+          benchEigenSpMDMLayout<T,EigenColMajor<T>,EigenRowMajor<T>>(exprOperands,AEigen,repeat,timevalue);
+          benchEigenSpMDMLayout<T,EigenColMajor<T>,EigenColMajor<T>>(exprOperands,AEigen,repeat,timevalue);
+        }
+
+        if (exprOperands.count("ADense")) {
+          EigenDenseView<EigenRowMajor<T>> ADense(exprOperands.at("ADense"),rows,Ksize);
+          TACO_BENCH(CEigen.noalias() = ADense.get() * BEigen.get();,"Eigen dense",repeat,timevalue,true);
+
+          Tensor<double> C_EigenDense({rows,cols}, Format({Dense,Dense}));
+          EigenTotaco(CEigen,C_EigenDense);
+          validate("Eigen dense", C_EigenDense, exprOperands.at("CRef"), max(precisionTolerance<T>(),reassociationTolerance));
+        }
+        break;
+      }
+      case SpTRSV: {
+        int rows=exprOperands.at("L").getDimension(0);
+        DenseVector<T> bEigen(rows);
+        DenseVector<T> xEigen(rows);
+        EigenCSR<T> LEigen(rows,rows);
+        EigenCSR<T> UEigen(rows,rows);
+
+        TACO_BENCH(tacoToEigen(exprOperands.at("b"),bEigen);
+                   tacoToEigen(exprOperands.at("L"),LEigen);
+                   tacoToEigen(exprOperands.at("U"),UEigen);,"\nEigen conversion",1,timevalue,false);
+
+        TACO_BENCH(xEigen = LEigen.template triangularView<Eigen::Lower>().solve(bEigen);,"Eigen L",repeat,timevalue,true);
+
+        Tensor<double> xL_Eigen({rows}, Dense);
+        EigenTotaco(xEigen,xL_Eigen);
+        validate("Eigen L", xL_Eigen, exprOperands.at("xLRef"), precisionTolerance<T>());
+
+        TACO_BENCH(xEigen = UEigen.template triangularView<Eigen::Upper>().solve(bEigen);,"Eigen U",repeat,timevalue,true);
+
+        Tensor<double> xU_Eigen({rows}, Dense);
+        EigenTotaco(xEigen,xU_Eigen);
+        validate("Eigen U", xU_Eigen, exprOperands.at("xURef"), precisionTolerance<T>());
+        break;
+      }
+      case MATPOW: {
+        // k SpMVs, swapping the source and destination vectors
+        int rows=exprOperands.at("A").getDimension(0);
+        DenseVector<T> xEigen(rows);
+        DenseVector<T> yEigen(rows);
+        DenseVector<T> work(rows);
+        EigenCSR<T> AEigen(rows,rows);
+
+        TACO_BENCH(tacoToEigen(exprOperands.at("x"),xEigen);
+                   tacoToEigen(exprOperands.csr("A"),AEigen);,"\nEigen conversion",1,timevalue,false);
+
+        EIGEN_BENCH_THREADS(yEigen.noalias() = AEigen * xEigen;
+                            for (int l=2; l<=power; l++) {
+                              work.swap(yEigen);
+                              yEigen.noalias() = AEigen * work;
+                            },"Eigen",repeat,timevalue);
+        cout << "Eigen time per power (ms)" << endl << timevalue.mean/power << endl;
+
+        Tensor<double> y_Eigen({rows}, Dense);
+        EigenTotaco(yEigen,y_Eigen);
+        validate("Eigen", y_Eigen, exprOperands.at("yRef"), max(precisionTolerance<T>(),reassociationTolerance));
+        break;
+      }
+      case BatchSpMV: {
+        int problems=batchSize(exprOperands,"A");
+        vector<EigenCSR<T>> AEigen;
+        vector<DenseVector<T>> xEigen, yEigen;
+        for (int k=0; k<problems; k++) {
+          const Tensor<double>& A=exprOperands.at("A"+to_string(k));
+          AEigen.push_back(EigenCSR<T>(A.getDimension(0),A.getDimension(1)));
+          xEigen.push_back(DenseVector<T>(A.getDimension(1)));
+          yEigen.push_back(DenseVector<T>(A.getDimension(0)));
+          tacoToEigen(A,AEigen[k]);
+          tacoToEigen(exprOperands.at("x"+to_string(k)),xEigen[k]);
+        }
+        int rows=exprOperands.at("A").getDimension(0);
+        int cols=exprOperands.at("A").getDimension(1);
+        EigenCSR<T> ABlockEigen(rows,cols);
+        DenseVector<T> xBlockEigen(cols);
+        DenseVector<T> yBlockEigen(rows);
+        TACO_BENCH(tacoToEigen(exprOperands.at("A"),ABlockEigen);
+                   tacoToEigen(exprOperands.at("x"),xBlockEigen);,"\nEigen conversion",1,timevalue,false);
+
+        taco::util::TimeResults backToBack, blockDiagonal;
+        TACO_BENCH(for (int k=0; k<problems; k++) yEigen[k].noalias() = AEigen[k] * xEigen[k];,
+                   "Eigen back-to-back",repeat,backToBack,true);
+        TACO_BENCH(yBlockEigen.noalias() = ABlockEigen * xBlockEigen;,
+                   "Eigen block-diagonal",repeat,blockDiagonal,true);
+        reportBatch("Eigen",problems,backToBack,blockDiagonal);
+
+        double tolerance=max(precisionTolerance<T>(),reassociationTolerance);
+        for (int k=0; k<problems; k++) {
+          Tensor<double> y_Eigen({(int)yEigen[k].size()}, Dense);
+          EigenTotaco(yEigen[k],y_Eigen);
+          validate("Eigen back-to-back "+to_string(k), y_Eigen, exprOperands.at("yRef"+to_string(k)), tolerance);
+        }
+        Tensor<double> y_Eigen({rows}, Dense);
+        EigenTotaco(yBlockEigen,y_Eigen);
+
+        validate("Eigen block-diagonal", y_Eigen, exprOperands.at("yRef"), tolerance);
+        break;
+      }
+      case BatchSDDMM: {
+        int problems=batchSize(exprOperands,"B");
+        vector<EigenCSC<T>> AEigen, BEigen;
+        vector<EigenRowMajor<T>> CEigen;
+        vector<EigenColMajor<T>> DEigen;
+        for (int k=0; k<problems; k++) {
+          const Tensor<double>& B=exprOperands.at("B"+to_string(k));
+          const Tensor<double>& C=exprOperands.at("C"+to_string(k));
+          const Tensor<double>& D=exprOperands.at("D"+to_string(k));
+          AEigen.push_back(EigenCSC<T>(B.getDimension(0),B.getDimension(1)));
+          BEigen.push_back(EigenCSC<T>(B.getDimension(0),B.getDimension(1)));
+          CEigen.push_back(EigenRowMajor<T>(C.getDimension(0),C.getDimension(1)));
+          DEigen.push_back(EigenColMajor<T>(D.getDimension(0),D.getDimension(1)));
+          tacoToEigen(B,BEigen[k]);
+          tacoToEigen(C,CEigen[k]);
+          tacoToEigen(D,DEigen[k]);
+        }
+        int rows=exprOperands.at("ARef").getDimension(0);
+        int cols=exprOperands.at("ARef").getDimension(1);
+        int Ksize=exprOperands.at("C").getDimension(1);
+        EigenCSC<T> ABlockEigen(rows,cols);
+        EigenCSC<T> BBlockEigen(rows,cols);
+        EigenRowMajor<T> CBlockEigen(rows,Ksize);
+        EigenColMajor<T> DBlockEigen(Ksize,cols);
+        TACO_BENCH(tacoToEigen(exprOperands.at("B"),BBlockEigen);
+                   tacoToEigen(exprOperands.at("C"),CBlockEigen);
+                   tacoToEigen(exprOperands.at("D"),DBlockEigen);,"\nEigen conversion",1,timevalue,false);
+
+        taco::util::TimeResults backToBack, blockDiagonal;
+        TACO_BENCH(for (int k=0; k<problems; k++) AEigen[k] = BEigen[k].cwiseProduct(CEigen[k].lazyProduct(DEigen[k]));,
+                   "Eigen back-to-back",repeat,backToBack,true);
+        TACO_BENCH(ABlockEigen = BBlockEigen.cwiseProduct(CBlockEigen.lazyProduct(DBlockEigen));,
+                   "Eigen block-diagonal",repeat,blockDiagonal,true);
+        reportBatch("Eigen",problems,backToBack,blockDiagonal);
+
+        Tensor<double> A_Eigen({rows,cols}, CSC);
+        EigenTotaco(ABlockEigen,A_Eigen);
+
+        validate("Eigen", A_Eigen, exprOperands.at("ARef"), precisionTolerance<T>());
         break;
       }
       default:
@@ -174,4 +524,16 @@ typedef Eigen::Matrix<double,Eigen::Dynamic,Eigen::Dynamic, Eigen::RowMajor> Eig
     }
   }
 
+  static ProductRegistration eigenRegistration("EIGEN",
+      {SpMV,PLUS3,MATTRANSMUL,RESIDUAL,SDDMM,SparsitySpMV,SparsityTTV,SparsitySpMDM,SpTRSV,
+       BatchSpMV,BatchSDDMM,MATPOW},
+      true, true, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        int power=matrixPower(run.parameters);
+        bool layouts=sweepLayouts(run.parameters);
+        if (run.precision==F64)
+          exprToEIGEN<double>(run.expr,run.operands,run.repeat,timevalue,power,layouts);
+        else
+          exprToEIGEN<float>(run.expr,run.operands,run.repeat,timevalue,power,layouts);
+      });
+
 #endif
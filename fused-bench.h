@@ -0,0 +1,164 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <climits>
+
+// y = A*x and t = A^T*w in one traversal of A, as bidiagonalization and BiCG
+// need them, against the two SpMVs that stream A twice. The transposed
+// products of a row are scattered into t, privately per thread when threaded:
+// thread t owns a range of rows balanced by nonzeros and the columns
+// low[t]..high[t]-1 they touch, stored from low[t] on, summed in t after.
+
+struct FusedPartition {
+  vector<int> rowStart;
+  vector<int> low;
+  vector<int> high;
+  vector<vector<double>> privateT;
+
+  int threads() const { return (int)rowStart.size()-1; }
+};
+
+  // Transposed CSR SpMV, t = A^T*w scattered row by row
+  void csrSpMVTransposed(int rows, int cols, const int* pos, const int* crd, const double* vals,
+                         const double* w, double* t) {
+    for (int j=0; j<cols; j++)
+      t[j]=0.0;
+    for (int i=0; i<rows; i++) {
+      double wi=w[i];
+      for (int p=pos[i]; p<pos[i+1]; p++)
+        t[crd[p]]+=vals[p]*wi;
+    }
+  }
+
+  void fusedSpMV(int rows, int cols, const int* pos, const int* crd, const double* vals,
+                 const double* x, const double* w, double* y, double* t) {
+    for (int j=0; j<cols; j++)
+      t[j]=0.0;
+    for (int i=0; i<rows; i++) {
+      double sum=0.0;
+      double wi=w[i];
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        int j=crd[p];
+        sum+=vals[p]*x[j];
+        t[j]+=vals[p]*wi;
+      }
+      y[i]=sum;
+    }
+  }
+
+  void partitionFused(int rows, const int* pos, const int* crd, int threads,
+                      FusedPartition& partition) {
+    partition.rowStart=partitionCSR("nnz",rows,pos,threads).rowStart;
+    partition.low.assign(threads,0);
+    partition.high.assign(threads,0);
+    partition.privateT.assign(threads,vector<double>());
+    #pragma omp parallel for schedule(static,1) num_threads(threads)
+    for (int t=0; t<threads; t++) {
+      int low=INT_MAX;
+      int high=0;
+      for (int p=pos[partition.rowStart[t]]; p<pos[partition.rowStart[t+1]]; p++) {
+        low=min(low,crd[p]);
+        high=max(high,crd[p]+1);
+      }
+      partition.low[t]=min(low,high);
+      partition.high[t]=high;
+      partition.privateT[t].resize(high-partition.low[t]);
+    }
+  }
+
+  void fusedSpMVPrivate(FusedPartition& partition, int cols, const int* pos, const int* crd,
+                        const double* vals, const double* x, const double* w, double* y, double* t) {
+    int threads=partition.threads();
+    #pragma omp parallel num_threads(threads)
+    {
+      #pragma omp for schedule(static,1)
+      for (int k=0; k<threads; k++) {
+        // tk is indexed by column, from low[k] on
+        double* tk=partition.privateT[k].data()-partition.low[k];
+        for (int j=partition.low[k]; j<partition.high[k]; j++)
+          tk[j]=0.0;
+        for (int i=partition.rowStart[k]; i<partition.rowStart[k+1]; i++) {
+          double sum=0.0;
+          double wi=w[i];
+          for (int p=pos[i]; p<pos[i+1]; p++) {
+            int j=crd[p];
+            sum+=vals[p]*x[j];
+            tk[j]+=vals[p]*wi;
+          }
+          y[i]=sum;
+        }
+      }
+      #pragma omp for schedule(static)
+      for (int j=0; j<cols; j++) {
+        double sum=0.0;
+        for (int k=0; k<threads; k++)
+          if (partition.low[k] <= j && j < partition.high[k])
+            sum+=partition.privateT[k][j-partition.low[k]];
+        t[j]=sum;
+      }
+    }
+  }
+
+  void reportMatrixBandwidth(string name, int64_t bytes, const taco::util::TimeResults& time) {
+    cout << name << " matrix GB/s" << endl << bytes/(time.mean*1e6) << endl;
+  }
+
+  void exprToFused(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue) {
+    switch(Expr) {
+      case MULTANDTRANS: {
+        const Tensor<double>& A=exprOperands.csr("A");
+        int rows=A.getDimension(0);
+        int cols=A.getDimension(1);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        getCSRArrays(A,&ia_CSR,&ja_CSR,&a_CSR);
+        vector<double> x, w, y(rows), t(cols);
+        tacoToVector(exprOperands.at("x"),x);
+        tacoToVector(exprOperands.at("w"),w);
+        int64_t bytes=panelBytes(rows,ia_CSR[rows]);
+
+        TACO_BENCH(csrSpMV(rows,ia_CSR,ja_CSR,a_CSR,x.data(),1.0,0.0,x.data(),y.data());
+                   csrSpMVTransposed(rows,cols,ia_CSR,ja_CSR,a_CSR,w.data(),t.data());,
+                   "\nFUSED two SpMVs",repeat,timevalue,true);
+        reportMatrixBandwidth("FUSED two SpMVs",2*bytes,timevalue);
+
+        benchNextPhaseOn(1);
+        TACO_BENCH(fusedSpMV(rows,cols,ia_CSR,ja_CSR,a_CSR,x.data(),w.data(),y.data(),t.data());,
+                   "FUSED serial",repeat,timevalue,true);
+        reportMatrixBandwidth("FUSED serial",bytes,timevalue);
+        Tensor<double> y_fused({rows}, Dense);
+        Tensor<double> t_fused({cols}, Dense);
+        VectorTotaco(y,y_fused);
+        VectorTotaco(t,t_fused);
+        validate("FUSED serial y", y_fused, exprOperands.at("yRef"), reassociationTolerance);
+        validate("FUSED serial t", t_fused, exprOperands.at("tRef"), reassociationTolerance);
+
+        FusedPartition partition;
+        TACO_BENCH(partitionFused(rows,ia_CSR,ja_CSR,benchThreads(),partition);,
+                   "\nFUSED partitioning",1,timevalue,false);
+        string name="FUSED "+to_string(partition.threads())+" threads";
+        TACO_BENCH(fusedSpMVPrivate(partition,cols,ia_CSR,ja_CSR,a_CSR,x.data(),w.data(),y.data(),t.data());,
+                   name,repeat,timevalue,true);
+        reportMatrixBandwidth(name,bytes,timevalue);
+        Tensor<double> y_private({rows}, Dense);
+        Tensor<double> t_private({cols}, Dense);
+        VectorTotaco(y,y_private);
+        VectorTotaco(t,t_private);
+        validate(name+" y", y_private, exprOperands.at("yRef"), reassociationTolerance);
+        validate(name+" t", t_private, exprOperands.at("tRef"), reassociationTolerance);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for FUSED" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration fusedRegistration("FUSED",
+      {MULTANDTRANS},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToFused(run.expr,run.operands,run.repeat,timevalue);
+      });
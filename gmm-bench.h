@@ -5,16 +5,18 @@ using namespace std;
 
 #ifdef GMM
 #include "gmm/gmm.h"
-typedef gmm::csc_matrix<double> GmmCSC;
-typedef gmm::csr_matrix<double> GmmCSR;
-typedef gmm::col_matrix< gmm::wsvector<double> > GmmSparse;
-typedef gmm::linalg_traits<gmm::wsvector<double>>::const_iterator GmmIterator;
-
-  void GMMTotaco(const GmmSparse& src, Tensor<double>& dst) {
+template<typename T> using GmmCSC = gmm::csc_matrix<T>;
+template<typename T> using GmmCSR = gmm::csr_matrix<T>;
+template<typename T> using GmmSparse = gmm::col_matrix< gmm::wsvector<T> >;
+template<typename T> using GmmDense = gmm::dense_matrix<T>;
+template<typename T> using GmmIterator = typename gmm::linalg_traits<gmm::wsvector<T>>::const_iterator;
+
+  template<typename T>
+  void GMMTotaco(const GmmSparse<T>& src, Tensor<double>& dst) {
     for (int j = 0; j < gmm::mat_ncols(src); ++j) {
-      typename gmm::linalg_traits<GmmSparse>::const_sub_col_type col = mat_const_col(src, j);
-      GmmIterator it1 = vect_const_begin(col);
-      GmmIterator ite1 = vect_const_end(col);
+      typename gmm::linalg_traits<GmmSparse<T>>::const_sub_col_type col = mat_const_col(src, j);
+      GmmIterator<T> it1 = vect_const_begin(col);
+      GmmIterator<T> ite1 = vect_const_end(col);
       while (it1 != ite1) {
         dst.insert({(int)(it1.index()),j},*it1);
         ++it1;
@@ -23,106 +25,205 @@ typedef gmm::linalg_traits<gmm::wsvector<double>>::const_iterator GmmIterator;
     dst.pack();
   }
 
-  void tacoToGMM(const Tensor<double>& src, GmmSparse& dst) {
+  template<typename T>
+  void tacoToGMM(const Tensor<double>& src, GmmSparse<T>& dst) {
+    for (auto& value : iterate<double>(src))
+      dst(value.first.at(0),value.first.at(1)) = value.second;
+  }
+
+  template<typename T>
+  void tacoToGMM(const Tensor<double>& src, GmmDense<T>& dst) {
     for (auto& value : iterate<double>(src))
       dst(value.first.at(0),value.first.at(1)) = value.second;
   }
 
-  void GMMTotaco(const std::vector<double>& src, Tensor<double>& dst){
+  template<typename T>
+  void GMMTotaco(const std::vector<T>& src, Tensor<double>& dst){
     for (int i=0; i<dst.getDimension(0); ++i)
       dst.insert({i}, src[i]);
     dst.pack();
   }
 
-  void tacoToGMM(const Tensor<double>& src, std::vector<double>& dst)  {
+  template<typename T>
+  void tacoToGMM(const Tensor<double>& src, std::vector<T>& dst)  {
     for (auto& value : iterate<double>(src))
       dst[value.first[0]] = value.second;
   }
 
-  void exprToGMM(BenchExpr Expr, map<string,Tensor<double>> exprOperands,int repeat, taco::util::TimeResults timevalue) {
+  template<typename T>
+  void exprToGMM(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                 int power) {
     switch(Expr) {
-      case SpMV: {
+      case SpMV:
+      case SparsityTTV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
 
-        GmmSparse Agmm_tmp(rows,cols);
-        tacoToGMM(exprOperands.at("A"),Agmm_tmp);
-        GmmCSR Agmm(rows,cols);
-        gmm::copy(Agmm_tmp, Agmm);
-        std::vector<double> xgmm(cols), ygmm(rows);
+        GmmSparse<T> Agmm_tmp(rows,cols);
+        GmmCSR<T> Agmm(rows,cols);
+        TACO_BENCH(tacoToGMM(exprOperands.at("A"),Agmm_tmp);
+                   gmm::copy(Agmm_tmp, Agmm);,"\nGMM conversion",1,timevalue,false);
+        std::vector<T> xgmm(cols), ygmm(rows);
         tacoToGMM(exprOperands.at("x"),xgmm);
 
-        TACO_BENCH(gmm::mult(Agmm, xgmm, ygmm);,"\nGMM",repeat,timevalue,true);
+        TACO_BENCH(gmm::mult(Agmm, xgmm, ygmm);,"GMM",repeat,timevalue,true);
 
         Tensor<double> y_gmm({rows}, Dense);
         GMMTotaco(ygmm,y_gmm);
 
-        validate("GMM++", y_gmm, exprOperands.at("yRef"));
+        validate("GMM++", y_gmm, exprOperands.at("yRef"), precisionTolerance<T>());
         break;
       }
       case PLUS3: {
         int rows=exprOperands.at("ARef").getDimension(0);
         int cols=exprOperands.at("ARef").getDimension(1);
-        GmmSparse Agmm(rows,cols);
-        GmmSparse Bgmm(rows,cols);
-        GmmSparse Cgmm(rows,cols);
-        GmmSparse Dgmm(rows,cols);
+        GmmSparse<T> Agmm(rows,cols);
+        GmmSparse<T> Bgmm(rows,cols);
+        GmmSparse<T> Cgmm(rows,cols);
+        GmmSparse<T> Dgmm(rows,cols);
 
-        tacoToGMM(exprOperands.at("B"),Bgmm);
-        tacoToGMM(exprOperands.at("C"),Cgmm);
-        tacoToGMM(exprOperands.at("D"),Dgmm);
+        TACO_BENCH(tacoToGMM(exprOperands.at("B"),Bgmm);
+                   tacoToGMM(exprOperands.at("C"),Cgmm);
+                   tacoToGMM(exprOperands.at("D"),Dgmm);,"\nGMM conversion",1,timevalue,false);
 
-        TACO_BENCH(Agmm=Bgmm;gmm::add(Cgmm,Agmm);gmm::add(Dgmm,Agmm);,"\nGMM",repeat,timevalue,true);
+        TACO_BENCH(Agmm=Bgmm;gmm::add(Cgmm,Agmm);gmm::add(Dgmm,Agmm);,"GMM",repeat,timevalue,true);
 
         Tensor<double> A_gmm({rows,cols}, CSC);
         GMMTotaco(Agmm,A_gmm);
 
         // comment out for now as Gmm++ and taco treat physical zeros differently
-        // validate("GMM", A_gmm, exprOperands.at("ARef"));
+        // validate("GMM", A_gmm, exprOperands.at("ARef"), precisionTolerance<T>());
         break;
       }
       case MATTRANSMUL: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
 
-        GmmSparse Agmm_tmp(rows,cols);
-        tacoToGMM(exprOperands.at("A"),Agmm_tmp);
-        GmmCSC Agmm(rows,cols);
-        gmm::copy(Agmm_tmp, Agmm);
-        std::vector<double> xgmm(cols), ygmm(rows), zgmm(rows);
+        GmmSparse<T> Agmm_tmp(rows,cols);
+        GmmCSC<T> Agmm(rows,cols);
+        TACO_BENCH(tacoToGMM(exprOperands.at("A"),Agmm_tmp);
+                   gmm::copy(Agmm_tmp, Agmm);,"\nGMM conversion",1,timevalue,false);
+        std::vector<T> xgmm(cols), ygmm(rows), zgmm(rows);
         tacoToGMM(exprOperands.at("x"),xgmm);
         tacoToGMM(exprOperands.at("z"),zgmm);
-        double alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
-        double beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+        T alpha = (T)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+        T beta = (T)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
 
-        TACO_BENCH(gmm::mult(gmm::transposed(Agmm), gmm::scaled(xgmm, alpha), gmm::scaled(zgmm, beta), ygmm);,"\nGMM",repeat,timevalue,true);
+        TACO_BENCH(gmm::mult(gmm::transposed(Agmm), gmm::scaled(xgmm, alpha), gmm::scaled(zgmm, beta), ygmm);,"GMM",repeat,timevalue,true);
 
         Tensor<double> y_gmm({rows}, Dense);
         GMMTotaco(ygmm,y_gmm);
 
-        validate("GMM++", y_gmm, exprOperands.at("yRef"));
+        validate("GMM++", y_gmm, exprOperands.at("yRef"), precisionTolerance<T>());
         break;
       }
-      case RESIDUAL: {
+      case RESIDUAL:
+      case SparsitySpMV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
 
-        GmmSparse Agmm_tmp(rows,cols);
-        tacoToGMM(exprOperands.at("A"),Agmm_tmp);
-        GmmCSR Agmm(rows,cols);
-        gmm::copy(Agmm_tmp, Agmm);
-        std::vector<double> xgmm(cols), ygmm(rows), zgmm(rows);
+        GmmSparse<T> Agmm_tmp(rows,cols);
+        GmmCSR<T> Agmm(rows,cols);
+        TACO_BENCH(tacoToGMM(exprOperands.at("A"),Agmm_tmp);
+                   gmm::copy(Agmm_tmp, Agmm);,"\nGMM conversion",1,timevalue,false);
+        std::vector<T> xgmm(cols), ygmm(rows), zgmm(rows);
         tacoToGMM(exprOperands.at("x"),xgmm);
         tacoToGMM(exprOperands.at("z"),zgmm);
-        double alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
-        double beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+        T alpha = (T)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+        T beta = (T)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
 
-        TACO_BENCH(gmm::mult(Agmm, gmm::scaled(xgmm, -1.0), zgmm, ygmm);,"\nGMM",repeat,timevalue,true);
+        // RESIDUAL is given as alpha=-1 and beta=1
+        TACO_BENCH(gmm::mult(Agmm, gmm::scaled(xgmm, alpha), gmm::scaled(zgmm, beta), ygmm);,"GMM",repeat,timevalue,true);
 
         Tensor<double> y_gmm({rows}, Dense);
         GMMTotaco(ygmm,y_gmm);
 
-        validate("GMM++", y_gmm, exprOperands.at("yRef"));
+        validate("GMM++", y_gmm, exprOperands.at("yRef"), precisionTolerance<T>());
+        break;
+      }
+      case SparsitySpMDM: {
+        int rows=exprOperands.at("CRef").getDimension(0);
+        int cols=exprOperands.at("CRef").getDimension(1);
+        int Ksize=exprOperands.at("A").getDimension(1);
+        GmmSparse<T> Agmm_tmp(rows,Ksize);
+        GmmCSR<T> Agmm(rows,Ksize);
+        GmmDense<T> Bgmm(Ksize,cols), Cgmm(rows,cols);
+        TACO_BENCH(tacoToGMM(exprOperands.at("A"),Agmm_tmp);
+                   gmm::copy(Agmm_tmp, Agmm);
+                   tacoToGMM(exprOperands.at("B"),Bgmm);,"\nGMM conversion",1,timevalue,false);
+
+        TACO_BENCH(gmm::mult(Agmm, Bgmm, Cgmm);,"GMM",repeat,timevalue,true);
+
+        Tensor<double> C_gmm({rows,cols}, Format({Dense,Dense}));
+        for (int i=0; i<rows; i++)
+          for (int j=0; j<cols; j++)
+            C_gmm.insert({i,j}, (double)Cgmm(i,j));
+        C_gmm.pack();
+        validate("GMM++", C_gmm, exprOperands.at("CRef"), max(precisionTolerance<T>(),reassociationTolerance));
+        break;
+      }
+      case BatchSpMV: {
+        int problems=batchSize(exprOperands,"A");
+        vector<GmmCSR<T>> Agmm;
+        vector<std::vector<T>> xgmm, ygmm;
+        for (int k=0; k<problems; k++) {
+          const Tensor<double>& A=exprOperands.at("A"+to_string(k));
+          GmmSparse<T> Agmm_tmp(A.getDimension(0),A.getDimension(1));
+          tacoToGMM(A,Agmm_tmp);
+          Agmm.push_back(GmmCSR<T>(A.getDimension(0),A.getDimension(1)));
+          gmm::copy(Agmm_tmp, Agmm[k]);
+          xgmm.push_back(std::vector<T>(A.getDimension(1)));
+          ygmm.push_back(std::vector<T>(A.getDimension(0)));
+          tacoToGMM(exprOperands.at("x"+to_string(k)),xgmm[k]);
+        }
+        int rows=exprOperands.at("A").getDimension(0);
+        int cols=exprOperands.at("A").getDimension(1);
+        GmmSparse<T> ABlockgmm_tmp(rows,cols);
+        GmmCSR<T> ABlockgmm(rows,cols);
+        TACO_BENCH(tacoToGMM(exprOperands.at("A"),ABlockgmm_tmp);
+                   gmm::copy(ABlockgmm_tmp, ABlockgmm);,"\nGMM conversion",1,timevalue,false);
+        std::vector<T> xBlockgmm(cols), yBlockgmm(rows);
+        tacoToGMM(exprOperands.at("x"),xBlockgmm);
+
+        taco::util::TimeResults backToBack, blockDiagonal;
+        TACO_BENCH(for (int k=0; k<problems; k++) gmm::mult(Agmm[k], xgmm[k], ygmm[k]);,
+                   "GMM back-to-back",repeat,backToBack,true);
+        TACO_BENCH(gmm::mult(ABlockgmm, xBlockgmm, yBlockgmm);,
+                   "GMM block-diagonal",repeat,blockDiagonal,true);
+        reportBatch("GMM",problems,backToBack,blockDiagonal);
+
+        double tolerance=max(precisionTolerance<T>(),reassociationTolerance);
+        for (int k=0; k<problems; k++) {
+          Tensor<double> y_gmm({(int)ygmm[k].size()}, Dense);
+          GMMTotaco(ygmm[k],y_gmm);
+          validate("GMM++ back-to-back "+to_string(k), y_gmm, exprOperands.at("yRef"+to_string(k)), tolerance);
+        }
+        Tensor<double> y_gmm({rows}, Dense);
+        GMMTotaco(yBlockgmm,y_gmm);
+
+        validate("GMM++ block-diagonal", y_gmm, exprOperands.at("yRef"), tolerance);
+        break;
+      }
+      case MATPOW: {
+        // k SpMVs, swapping the source and destination vectors
+        int rows=exprOperands.at("A").getDimension(0);
+        GmmSparse<T> Agmm_tmp(rows,rows);
+        GmmCSR<T> Agmm(rows,rows);
+        TACO_BENCH(tacoToGMM(exprOperands.at("A"),Agmm_tmp);
+                   gmm::copy(Agmm_tmp, Agmm);,"\nGMM conversion",1,timevalue,false);
+        std::vector<T> xgmm(rows), ygmm(rows), work(rows);
+        tacoToGMM(exprOperands.at("x"),xgmm);
+
+        TACO_BENCH(gmm::mult(Agmm, xgmm, ygmm);
+                   for (int l=2; l<=power; l++) {
+                     work.swap(ygmm);
+                     gmm::mult(Agmm, work, ygmm);
+                   },"GMM",repeat,timevalue,true);
+        cout << "GMM time per power (ms)" << endl << timevalue.mean/power << endl;
+
+        Tensor<double> y_gmm({rows}, Dense);
+        GMMTotaco(ygmm,y_gmm);
+        validate("GMM++", y_gmm, exprOperands.at("yRef"), max(precisionTolerance<T>(),reassociationTolerance));
         break;
       }
       default:
@@ -131,4 +232,14 @@ typedef gmm::linalg_traits<gmm::wsvector<double>>::const_iterator GmmIterator;
     }
 
   }
+
+  static ProductRegistration gmmRegistration("GMM",
+      {SpMV,PLUS3,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV,SparsitySpMDM,BatchSpMV,MATPOW},
+      false, true, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        if (run.precision==F64)
+          exprToGMM<double>(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters));
+        else
+          exprToGMM<float>(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters));
+      });
+
 #endif
@@ -0,0 +1,228 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+// Layouts of the dense operands of SDDMM and SparsitySpMDM. Row-major and
+// column-major are taco's {Dense,Dense} and {Dense,Dense},{1,0} formats.
+// Tiled stores blocks of layoutTile x layoutTile elements contiguously, the
+// blocks and the elements of a block in row-major order, so that a row of a
+// block is one cache line. The last blocks of a matrix are padded with zeros.
+// taco, Eigen and MKL only take the first two; the LAYOUT product runs every
+// combination of the three on native kernels.
+
+enum DenseLayout {RowMajorLayout, ColMajorLayout, TiledLayout};
+const vector<string> denseLayoutNames={"row-major","col-major","tiled"};
+const int layoutTile=8;
+
+  // Whether the taco, Eigen and MKL products also sweep the layouts they take
+  bool sweepLayouts(const map<string,string>& parameters) {
+    return parameters.count("layouts")!=0;
+  }
+
+  Format layoutFormat(DenseLayout layout) {
+    taco_uassert(layout!=TiledLayout) << "taco has no tiled dense format";
+    return (layout==RowMajorLayout) ? Format({Dense,Dense}) : Format({Dense,Dense},{1,0});
+  }
+
+  template<DenseLayout L>
+  inline size_t layoutOffset(int i, int j, int rows, int cols);
+
+  template<>
+  inline size_t layoutOffset<RowMajorLayout>(int i, int j, int rows, int cols) {
+    return (size_t)i*cols+j;
+  }
+
+  template<>
+  inline size_t layoutOffset<ColMajorLayout>(int i, int j, int rows, int cols) {
+    return (size_t)j*rows+i;
+  }
+
+  template<>
+  inline size_t layoutOffset<TiledLayout>(int i, int j, int rows, int cols) {
+    int tilesPerRow=(cols+layoutTile-1)/layoutTile;
+    return ((size_t)(i/layoutTile)*tilesPerRow+j/layoutTile)*layoutTile*layoutTile
+           + (i%layoutTile)*layoutTile + j%layoutTile;
+  }
+
+struct LayoutMatrix {
+  DenseLayout layout;
+  int rows;
+  int cols;
+  vector<double> vals;
+
+  size_t offset(int i, int j) const {
+    switch (layout) {
+      case RowMajorLayout: return layoutOffset<RowMajorLayout>(i,j,rows,cols);
+      case ColMajorLayout: return layoutOffset<ColMajorLayout>(i,j,rows,cols);
+      default: return layoutOffset<TiledLayout>(i,j,rows,cols);
+    }
+  }
+};
+
+  void allocateLayout(DenseLayout layout, int rows, int cols, LayoutMatrix& dst) {
+    dst.layout=layout;
+    dst.rows=rows;
+    dst.cols=cols;
+    size_t size=(size_t)rows*cols;
+    if (layout==TiledLayout)
+      size=(size_t)((rows+layoutTile-1)/layoutTile)*((cols+layoutTile-1)/layoutTile)*layoutTile*layoutTile;
+    dst.vals.assign(size,0.0);
+  }
+
+  void tacoToLayout(const Tensor<double>& src, DenseLayout layout, LayoutMatrix& dst) {
+    allocateLayout(layout,src.getDimension(0),src.getDimension(1),dst);
+    for (auto& value : iterate<double>(src))
+      dst.vals[dst.offset(value.first.at(0),value.first.at(1))]=value.second;
+  }
+
+  void layoutTotaco(const LayoutMatrix& src, Tensor<double>& dst) {
+    for (int i=0; i<src.rows; i++)
+      for (int j=0; j<src.cols; j++)
+        dst.insert({i,j},src.vals[src.offset(i,j)]);
+    dst.pack();
+  }
+
+  // C = A*B with A in CSR. Threads own rows of C, in chunks long enough that
+  // a column-major C is not falsely shared but at the chunk edges.
+  template<DenseLayout LB, DenseLayout LC>
+  void layoutSpMDM(int rows, const int* pos, const int* crd, const double* vals,
+                   const LayoutMatrix& B, LayoutMatrix& C) {
+    int Ksize=B.rows;
+    int cols=B.cols;
+    const double* b=B.vals.data();
+    double* c=C.vals.data();
+    #pragma omp parallel for schedule(dynamic,64)
+    for (int i=0; i<rows; i++) {
+      for (int j=0; j<cols; j++)
+        c[layoutOffset<LC>(i,j,rows,cols)]=0.0;
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        double a=vals[p];
+        int k=crd[p];
+        for (int j=0; j<cols; j++)
+          c[layoutOffset<LC>(i,j,rows,cols)]+=a*b[layoutOffset<LB>(k,j,Ksize,cols)];
+      }
+    }
+  }
+
+  // A = B o (CxD) with B in CSC, as the fused SDDMM product
+  template<DenseLayout LC, DenseLayout LD>
+  void layoutSDDMM(int cols, const int* pos, const int* crd, const double* vals,
+                   const LayoutMatrix& C, const LayoutMatrix& D, double* A) {
+    int rows=C.rows;
+    int Ksize=C.cols;
+    const double* c=C.vals.data();
+    const double* d=D.vals.data();
+    #pragma omp parallel for schedule(dynamic,64)
+    for (int k=0; k<cols; k++) {
+      for (int p=pos[k]; p<pos[k+1]; p++) {
+        int i=crd[p];
+        double sum=0.0;
+        for (int j=0; j<Ksize; j++)
+          sum+=c[layoutOffset<LC>(i,j,rows,Ksize)]*d[layoutOffset<LD>(j,k,Ksize,cols)];
+        A[p]=vals[p]*sum;
+      }
+    }
+  }
+
+typedef void (*LayoutSpMDMKernel)(int, const int*, const int*, const double*,
+                                  const LayoutMatrix&, LayoutMatrix&);
+typedef void (*LayoutSDDMMKernel)(int, const int*, const int*, const double*,
+                                  const LayoutMatrix&, const LayoutMatrix&, double*);
+
+// Kernels by the layouts of their two dense operands
+const LayoutSpMDMKernel layoutSpMDMKernels[3][3]={
+  {layoutSpMDM<RowMajorLayout,RowMajorLayout>,layoutSpMDM<RowMajorLayout,ColMajorLayout>,
+   layoutSpMDM<RowMajorLayout,TiledLayout>},
+  {layoutSpMDM<ColMajorLayout,RowMajorLayout>,layoutSpMDM<ColMajorLayout,ColMajorLayout>,
+   layoutSpMDM<ColMajorLayout,TiledLayout>},
+  {layoutSpMDM<TiledLayout,RowMajorLayout>,layoutSpMDM<TiledLayout,ColMajorLayout>,
+   layoutSpMDM<TiledLayout,TiledLayout>}};
+
+const LayoutSDDMMKernel layoutSDDMMKernels[3][3]={
+  {layoutSDDMM<RowMajorLayout,RowMajorLayout>,layoutSDDMM<RowMajorLayout,ColMajorLayout>,
+   layoutSDDMM<RowMajorLayout,TiledLayout>},
+  {layoutSDDMM<ColMajorLayout,RowMajorLayout>,layoutSDDMM<ColMajorLayout,ColMajorLayout>,
+   layoutSDDMM<ColMajorLayout,TiledLayout>},
+  {layoutSDDMM<TiledLayout,RowMajorLayout>,layoutSDDMM<TiledLayout,ColMajorLayout>,
+   layoutSDDMM<TiledLayout,TiledLayout>}};
+
+  // Convert a dense operand to each layout once, timing the conversions
+  vector<LayoutMatrix> layoutsOf(string name, const Tensor<double>& src, bool& first,
+                                 taco::util::TimeResults timevalue) {
+    vector<LayoutMatrix> dst(denseLayoutNames.size());
+    for (size_t l=0; l<denseLayoutNames.size(); l++) {
+      TACO_BENCH(tacoToLayout(src,(DenseLayout)l,dst[l]);,
+                 (first ? "\n" : "")+string("LAYOUT ")+name+" "+denseLayoutNames[l]+" conversion",
+                 1,timevalue,false);
+      first=false;
+    }
+    return dst;
+  }
+
+  void exprToLayout(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue) {
+    bool first=true;
+    switch(Expr) {
+      case SDDMM: {
+        const Tensor<double>& B=exprOperands.at("B");
+        int cols=B.getDimension(1);
+        int Ksize=exprOperands.at("C").getDimension(1);
+        double *b_CSC;
+        int* ib_CSC;
+        int* jb_CSC;
+        getCSCArrays(exprOperands.csc("B"),&ib_CSC,&jb_CSC,&b_CSC);
+        int nnz=ib_CSC[cols];
+        vector<LayoutMatrix> Cs=layoutsOf("C",exprOperands.at("C"),first,timevalue);
+        vector<LayoutMatrix> Ds=layoutsOf("D",exprOperands.at("D"),first,timevalue);
+
+        vector<double> A(nnz);
+        for (size_t lc=0; lc<Cs.size(); lc++) {
+          for (size_t ld=0; ld<Ds.size(); ld++) {
+            string name="LAYOUT C "+denseLayoutNames[lc]+" D "+denseLayoutNames[ld];
+            LayoutSDDMMKernel kernel=layoutSDDMMKernels[lc][ld];
+            TACO_BENCH(kernel(cols,ib_CSC,jb_CSC,b_CSC,Cs[lc],Ds[ld],A.data());,
+                       name,repeat,timevalue,true);
+            reportGFLOPS(name,(2.0*Ksize+1)*nnz,timevalue);
+            Tensor<double> A_layout(B.getDimensions(), CSC);
+            CSCValuesTotaco(cols,ib_CSC,jb_CSC,A,A_layout);
+            validate(name, A_layout, exprOperands.at("ARef"), reassociationTolerance);
+          }
+        }
+        break;
+      }
+      case SparsitySpMDM: {
+        const Tensor<double>& CRef=exprOperands.at("CRef");
+        int rows=CRef.getDimension(0);
+        int cols=CRef.getDimension(1);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        vector<LayoutMatrix> Bs=layoutsOf("B",exprOperands.at("B"),first,timevalue);
+
+        for (size_t lb=0; lb<Bs.size(); lb++) {
+          for (size_t lc=0; lc<denseLayoutNames.size(); lc++) {
+            string name="LAYOUT B "+denseLayoutNames[lb]+" C "+denseLayoutNames[lc];
+            LayoutMatrix C;
+            allocateLayout((DenseLayout)lc,rows,cols,C);
+            LayoutSpMDMKernel kernel=layoutSpMDMKernels[lb][lc];
+            TACO_BENCH(kernel(rows,ia_CSR,ja_CSR,a_CSR,Bs[lb],C);,name,repeat,timevalue,true);
+            reportGFLOPS(name,2.0*ia_CSR[rows]*cols,timevalue);
+            Tensor<double> C_layout({rows,cols}, Format({Dense,Dense}));
+            layoutTotaco(C,C_layout);
+            validate(name, C_layout, CRef, reassociationTolerance);
+          }
+        }
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for LAYOUT" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration layoutRegistration("LAYOUT",
+      {SDDMM,SparsitySpMDM},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToLayout(run.expr,run.operands,run.repeat,timevalue);
+      });
@@ -0,0 +1,205 @@
+#include <omp.h>
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+// y = A^k*x, as power iterations apply SpMV to the same matrix. The naive
+// kernel runs k SpMVs and streams A k times. The communication-avoiding
+// kernel (the PA1 matrix powers kernel of Demmel et al.) splits the rows in
+// blocks. For each block it keeps the rows S_l it has to compute at each
+// level l: S_k is the block, and S_l holds the columns that the rows of
+// S_l+1 read. It then runs the k levels on its rows back to back, while
+// their tile of A is in cache, recomputing the values it shares with the
+// neighbouring blocks instead of exchanging them.
+
+const int defaultMatrixPower=4;
+const int defaultPowerTileKB=256;
+
+  // Power of MATPOW, given by -k (checked to be at least 1 when parsed)
+  int matrixPower(const map<string,string>& parameters) {
+    return parameters.count("k") ? stoi(parameters.at("k")) : defaultMatrixPower;
+  }
+
+struct MatrixPowers {
+  int rows;
+  int power;
+  vector<int> blockStart;
+  // rows of level l of block b, for l=1..power, at levelRows[b*power+l-1]
+  vector<vector<int>> levelRows;
+  long computedNnz;
+  // even and odd level values of each thread, two rows-long halves
+  vector<vector<double>> scratch;
+
+  int blocks() const { return (int)blockStart.size()-1; }
+};
+
+  // Build the level row sets of blocks of about tileBytes of A. Gives up
+  // (returns false) when the recomputed nonzeros exceed maxRedundancy times
+  // those of the naive kernel.
+  bool buildMatrixPowers(int rows, const int* pos, const int* crd, int power, int64_t tileBytes,
+                         double maxRedundancy, MatrixPowers& dst) {
+    dst.rows=rows;
+    dst.power=power;
+    dst.blockStart.assign(1,0);
+    int64_t bytes=0;
+    for (int i=0; i<rows; i++) {
+      bytes+=panelBytes(1,pos[i+1]-pos[i]);
+      if (bytes > tileBytes || i==rows-1) {
+        dst.blockStart.push_back(i+1);
+        bytes=0;
+      }
+    }
+    int blocks=dst.blocks();
+    dst.levelRows.assign((size_t)blocks*power,vector<int>());
+    long budget=(long)(maxRedundancy*power*pos[rows]);
+    long computed=0;
+    bool fits=true;
+    #pragma omp parallel
+    {
+      vector<int> marker(rows,-1);
+      #pragma omp for schedule(dynamic)
+      for (int b=0; b<blocks; b++) {
+        bool going;
+        #pragma omp atomic read
+        going=fits;
+        if (!going)
+          continue;
+        vector<int>& top=dst.levelRows[(size_t)b*power+power-1];
+        for (int i=dst.blockStart[b]; i<dst.blockStart[b+1]; i++)
+          top.push_back(i);
+        for (int l=power-1; l>=1; l--) {
+          const vector<int>& above=dst.levelRows[(size_t)b*power+l];
+          vector<int>& level=dst.levelRows[(size_t)b*power+l-1];
+          int stamp=b*power+l;
+          for (int i : above)
+            for (int p=pos[i]; p<pos[i+1]; p++)
+              if (marker[crd[p]]!=stamp) {
+                marker[crd[p]]=stamp;
+                level.push_back(crd[p]);
+              }
+          sort(level.begin(),level.end());
+        }
+        long blockNnz=0;
+        for (int l=0; l<power; l++)
+          for (int i : dst.levelRows[(size_t)b*power+l])
+            blockNnz+=pos[i+1]-pos[i];
+        long total;
+        #pragma omp atomic capture
+        total=computed+=blockNnz;
+        if (total > budget) {
+          #pragma omp atomic write
+          fits=false;
+        }
+      }
+    }
+    dst.computedNnz=computed;
+    if (!fits) {
+      dst.levelRows.clear();
+      return false;
+    }
+    dst.scratch.assign(omp_get_max_threads(),vector<double>(2*(size_t)rows));
+    return true;
+  }
+
+  // y = A^k*x from k SpMVs, ping-ponging between y and work
+  void naivePowers(int rows, const int* pos, const int* crd, const double* vals, int power,
+                   const double* x, double* y, vector<double>& work) {
+    const double* src=x;
+    for (int l=1; l<=power; l++) {
+      double* dst=((power-l)%2==0) ? y : work.data();
+      csrSpMV(rows,pos,crd,vals,src,1.0,0.0,src,dst);
+      src=dst;
+    }
+  }
+
+  void caPowers(MatrixPowers& A, const int* pos, const int* crd, const double* vals,
+                const double* x, double* y) {
+    int power=A.power;
+    #pragma omp parallel num_threads(A.scratch.size())
+    {
+      double* even=A.scratch[omp_get_thread_num()].data();
+      double* odd=even+A.rows;
+      #pragma omp for schedule(dynamic)
+      for (int b=0; b<A.blocks(); b++) {
+        const double* src=x;
+        for (int l=1; l<=power; l++) {
+          double* dst=(l==power) ? y : ((l%2) ? odd : even);
+          for (int i : A.levelRows[(size_t)b*power+l-1]) {
+            double sum=0.0;
+            for (int p=pos[i]; p<pos[i+1]; p++)
+              sum+=vals[p]*src[crd[p]];
+            dst[i]=sum;
+          }
+          src=dst;
+        }
+      }
+    }
+  }
+
+  // Cost of one power and the bytes moved from memory, assuming a matrix
+  // tile stays in cache across the levels of its block
+  void reportPowers(string name, int power, int64_t bytes, const taco::util::TimeResults& time) {
+    cout << name << " time per power (ms)" << endl << time.mean/power << endl;
+    cout << name << " memory traffic (MB)" << endl << bytes/1e6 << endl;
+  }
+
+  void exprToPowers(BenchExpr Expr, const OperandStore& exprOperands,int repeat,
+                    taco::util::TimeResults timevalue, int power, int64_t tileBytes) {
+    switch(Expr) {
+      case MATPOW: {
+        const Tensor<double>& A=exprOperands.csr("A");
+        int rows=A.getDimension(0);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        getCSRArrays(A,&ia_CSR,&ja_CSR,&a_CSR);
+        vector<double> x, y(rows), work(rows);
+        tacoToVector(exprOperands.at("x"),x);
+        int64_t vectorBytes=(int64_t)rows*sizeof(double);
+        int64_t matrixBytes=panelBytes(rows,ia_CSR[rows]);
+
+        TACO_BENCH(naivePowers(rows,ia_CSR,ja_CSR,a_CSR,power,x.data(),y.data(),work);,
+                   "\nPOWERS naive",repeat,timevalue,true);
+        reportPowers("POWERS naive",power,power*(matrixBytes+2*vectorBytes),timevalue);
+        Tensor<double> y_naive({rows}, Dense);
+        VectorTotaco(y,y_naive);
+        validate("POWERS naive", y_naive, exprOperands.at("yRef"), reassociationTolerance);
+
+        MatrixPowers powers;
+        bool fits;
+        TACO_BENCH(fits=buildMatrixPowers(rows,ia_CSR,ja_CSR,power,tileBytes,2.0,powers);,
+                   "\nPOWERS CA preprocessing",1,timevalue,false);
+        if (!fits) {
+          cout << " !! POWERS CA skipped: blocks recompute more than twice the nonzeros of "
+               << "the naive kernel" << endl;
+          break;
+        }
+        cout << "POWERS CA: " << powers.blocks() << " blocks, recomputes "
+             << (double)powers.computedNnz/((double)power*ia_CSR[rows]) << "x the naive nonzeros" << endl;
+
+        TACO_BENCH(caPowers(powers,ia_CSR,ja_CSR,a_CSR,x.data(),y.data());,
+                   "POWERS CA",repeat,timevalue,true);
+        int64_t tileTraffic=0;
+        for (int b=0; b<powers.blocks(); b++)
+          for (int i : powers.levelRows[(size_t)b*power])
+            tileTraffic+=panelBytes(1,ia_CSR[i+1]-ia_CSR[i]);
+        reportPowers("POWERS CA",power,tileTraffic+2*vectorBytes,timevalue);
+        Tensor<double> y_ca({rows}, Dense);
+        VectorTotaco(y,y_ca);
+        validate("POWERS CA", y_ca, exprOperands.at("yRef"), reassociationTolerance);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for POWERS" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration powersRegistration("POWERS",
+      {MATPOW},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        int tileKB=run.parameters.count("tile") ? stoi(run.parameters.at("tile")) : defaultPowerTileKB;
+        exprToPowers(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters),
+                     (int64_t)tileKB*1024);
+      });
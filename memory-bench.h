@@ -0,0 +1,245 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// Allocation tracking. malloc and its variants are interposed so that every
+// allocation of taco, the products and the C++ runtime (operator new ends up
+// in malloc) is counted while a phase is measured. Peak RSS is the kernel
+// high-water mark of the process, reset at the start of each phase.
+// The blocks allocated by the measured code are recorded, so that they leave
+// the live heap whenever they are freed, also by the untimed setup of the
+// next run, while blocks allocated before the phase never do.
+struct MemoryCounters {
+  std::atomic<bool> active;
+  std::atomic<long> allocations;
+  std::atomic<long> bytes;
+  std::atomic<long> live;
+  std::atomic<long> peakLive;
+};
+static MemoryCounters memoryCounters;
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+
+extern "C" {
+  void* __libc_malloc(size_t size);
+  void* __libc_calloc(size_t n, size_t size);
+  void* __libc_realloc(void* ptr, size_t size);
+  void* __libc_memalign(size_t alignment, size_t size);
+  void __libc_free(void* ptr);
+}
+
+// Blocks allocated in the current phase, in an open-addressing table that
+// does not allocate. A freed block leaves a tombstone until the next phase
+// clears the table. Blocks that find no slot stay in the live heap.
+const int trackedBlockBits=18;
+const int trackedBlockProbes=64;
+static std::atomic<void*> trackedBlocks[1<<trackedBlockBits];
+static std::atomic<long> trackedBlockCount;
+static void* const trackedTombstone=(void*)1;
+
+  static inline size_t trackedBlockSlot(void* ptr) {
+    return (size_t)((((uint64_t)(uintptr_t)ptr>>4)*0x9E3779B97F4A7C15ULL)>>(64-trackedBlockBits));
+  }
+
+  static inline void trackBlock(void* ptr) {
+    size_t mask=(1<<trackedBlockBits)-1;
+    size_t slot=trackedBlockSlot(ptr);
+    for (int probe=0; probe<trackedBlockProbes; probe++) {
+      void* expected=NULL;
+      if (trackedBlocks[(slot+probe)&mask].compare_exchange_strong(expected,ptr,std::memory_order_relaxed)) {
+        trackedBlockCount.fetch_add(1,std::memory_order_relaxed);
+        return;
+      }
+    }
+  }
+
+  // Whether ptr was allocated in the current phase, forgetting it
+  static inline bool untrackBlock(void* ptr) {
+    if (trackedBlockCount.load(std::memory_order_relaxed)==0)
+      return false;
+    size_t mask=(1<<trackedBlockBits)-1;
+    size_t slot=trackedBlockSlot(ptr);
+    for (int probe=0; probe<trackedBlockProbes; probe++) {
+      std::atomic<void*>& entry=trackedBlocks[(slot+probe)&mask];
+      void* tracked=entry.load(std::memory_order_relaxed);
+      if (tracked==NULL)
+        return false;
+      if (tracked==ptr)
+        return entry.compare_exchange_strong(tracked,trackedTombstone,std::memory_order_relaxed);
+    }
+    return false;
+  }
+
+  static void clearTrackedBlocks() {
+    if (trackedBlockCount.load()==0)
+      return;
+    for (auto& entry : trackedBlocks)
+      entry.store(NULL,std::memory_order_relaxed);
+    trackedBlockCount=0;
+  }
+
+  static inline void countAllocation(void* ptr) {
+    if (ptr==NULL || !memoryCounters.active.load(std::memory_order_relaxed))
+      return;
+    long size=malloc_usable_size(ptr);
+    trackBlock(ptr);
+    memoryCounters.allocations.fetch_add(1,std::memory_order_relaxed);
+    memoryCounters.bytes.fetch_add(size,std::memory_order_relaxed);
+    long live=memoryCounters.live.fetch_add(size,std::memory_order_relaxed)+size;
+    long peak=memoryCounters.peakLive.load(std::memory_order_relaxed);
+    while (live>peak && !memoryCounters.peakLive.compare_exchange_weak(peak,live,std::memory_order_relaxed));
+  }
+
+  // Size of a block allocated in the current phase, 0 for the others
+  static inline long trackedSize(void* ptr) {
+    return (ptr && untrackBlock(ptr)) ? (long)malloc_usable_size(ptr) : 0;
+  }
+
+  static inline void countFree(void* ptr) {
+    memoryCounters.live.fetch_sub(trackedSize(ptr),std::memory_order_relaxed);
+  }
+
+extern "C" {
+  void* malloc(size_t size) noexcept {
+    void* ptr=__libc_malloc(size);
+    countAllocation(ptr);
+    return ptr;
+  }
+
+  void* calloc(size_t n, size_t size) noexcept {
+    void* ptr=__libc_calloc(n,size);
+    countAllocation(ptr);
+    return ptr;
+  }
+
+  void* realloc(void* ptr, size_t size) noexcept {
+    long previous=trackedSize(ptr);
+    void* dst=__libc_realloc(ptr,size);
+    if (dst || size==0) {
+      memoryCounters.live.fetch_sub(previous,std::memory_order_relaxed);
+      countAllocation(dst);
+    }
+    else if (previous)
+      trackBlock(ptr);
+    return dst;
+  }
+
+  void* memalign(size_t alignment, size_t size) noexcept {
+    void* ptr=__libc_memalign(alignment,size);
+    countAllocation(ptr);
+    return ptr;
+  }
+
+  void* aligned_alloc(size_t alignment, size_t size) noexcept {
+    return memalign(alignment,size);
+  }
+
+  int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept {
+    *ptr=memalign(alignment,size);
+    return *ptr ? 0 : ENOMEM;
+  }
+
+  void free(void* ptr) noexcept {
+    countFree(ptr);
+    __libc_free(ptr);
+  }
+}
+#else
+  static void clearTrackedBlocks() {}
+#endif
+
+  // Read a field of /proc/self/status in kB, without allocating
+  static long readProcStatus(const char* field) {
+    char buffer[4096];
+    int fd=open("/proc/self/status",O_RDONLY);
+    if (fd<0)
+      return 0;
+    ssize_t size=read(fd,buffer,sizeof(buffer)-1);
+    close(fd);
+    if (size<=0)
+      return 0;
+    buffer[size]='\0';
+    const char* line=strstr(buffer,field);
+    return line ? atol(line+strlen(field)) : 0;
+  }
+
+  // Writing 5 to clear_refs resets the RSS high-water mark (Linux >= 4.0).
+  // Without it the peak RSS reported is the one of the whole process.
+  static bool resetPeakRSS() {
+    int fd=open("/proc/self/clear_refs",O_WRONLY);
+    if (fd<0)
+      return false;
+    bool reset=(write(fd,"5",1)==1);
+    close(fd);
+    return reset;
+  }
+
+  static bool peakRSSReset=false;
+
+  static void startMemoryPhase() {
+    clearTrackedBlocks();
+    memoryCounters.allocations=0;
+    memoryCounters.bytes=0;
+    memoryCounters.live=0;
+    memoryCounters.peakLive=0;
+    peakRSSReset=resetPeakRSS();
+  }
+
+  // Only the measured code is counted, not its setup
+  static inline void resumeMemoryPhase() {
+    memoryCounters.active.store(true,std::memory_order_relaxed);
+  }
+
+  static inline void pauseMemoryPhase() {
+    memoryCounters.active.store(false,std::memory_order_relaxed);
+  }
+
+  // Allocations, allocated bytes and high-water marks of the measured run
+  static void reportMemoryPhase() {
+    double MB=1024.0*1024.0;
+    cout << "memory: " << memoryCounters.allocations << " allocations, "
+         << memoryCounters.bytes/MB << " MB allocated, "
+         << memoryCounters.peakLive/MB << " MB heap high-water, "
+         << readProcStatus("VmHWM:")/1024.0 << " MB peak RSS"
+         << (peakRSSReset ? "" : " (process)") << endl;
+  }
+
+static void* volatile memoryCheckBefore;
+static void* volatile memoryCheckBlock;
+
+  // The heap high-water of a phase whose runs each allocate the same block,
+  // freed by the untimed setup of the next run, while the first run frees a
+  // block allocated before the phase, must not depend on the repetitions
+  static bool checkMemoryPhase() {
+#if defined(__GLIBC__)
+    const size_t blockBytes=1<<16;
+    long peaks[2];
+    int repeats[2]={1,4};
+    for (int k=0; k<2; k++) {
+      memoryCheckBefore=malloc(4*blockBytes);
+      startMemoryPhase();
+      for (int r=0; r<repeats[k]; r++) {
+        free(memoryCheckBlock);
+        memoryCheckBlock=NULL;
+        resumeMemoryPhase();
+        free(memoryCheckBefore);
+        memoryCheckBefore=NULL;
+        memoryCheckBlock=malloc(blockBytes);
+        pauseMemoryPhase();
+      }
+      free(memoryCheckBlock);
+      memoryCheckBlock=NULL;
+      peaks[k]=memoryCounters.peakLive;
+    }
+    return peaks[0]==peaks[1] && peaks[0]>=(long)blockBytes;
+#else
+    return true;
+#endif
+  }
@@ -8,30 +8,71 @@ using namespace std;
   #include "mkl_blas.h"
   #include "mkl.h"
 
-  void exprToMKL(BenchExpr Expr, map<string,Tensor<double>> exprOperands,int repeat, taco::util::TimeResults timevalue) {
+  // The classic sparse BLAS routines take one-based arrays they do not
+  // modify through non-const pointers
+  void oneBasedMKL(const CSRArrays& src, int** pos, int** crd, double** vals) {
+    *pos=const_cast<int*>(src.pos.data());
+    *crd=const_cast<int*>(src.crd.data());
+    *vals=const_cast<double*>(src.vals.data());
+  }
+
+  // A symmetric A multiplied from its lower triangle by the inspector-executor
+  // API, with a 0-based handle sharing taco's arrays. A^T = A for
+  // MATTRANSMUL. y is reset to z before each product.
+  void benchMKLSymmetric(const OperandStore& exprOperands, double alpha, double beta,
+                         int repeat, taco::util::TimeResults timevalue) {
+    const Tensor<double>& ALower=exprOperands.csr("ALower");
+    int rows=ALower.getDimension(0);
+    double *a_CSR;
+    int* ia_CSR;
+    int* ja_CSR;
+    getCSRArrays(ALower,&ia_CSR,&ja_CSR,&a_CSR);
+    sparse_matrix_t AMKL;
+    mkl_sparse_d_create_csr(&AMKL, SPARSE_INDEX_BASE_ZERO, rows, rows,
+                            ia_CSR, ia_CSR+1, ja_CSR, a_CSR);
+    struct matrix_descr descr;
+    descr.type = SPARSE_MATRIX_TYPE_SYMMETRIC;
+    descr.mode = SPARSE_FILL_MODE_LOWER;
+    descr.diag = SPARSE_DIAG_NON_UNIT;
+    Tensor<double> y_mkl({rows}, Dense);
+    y_mkl.pack();
+    double* xvals=((double*)(exprOperands.at("x").getStorage().getValues().getData()));
+    double* yvals=((double*)(y_mkl.getStorage().getValues().getData()));
+    const double* zvals=exprOperands.count("z") ?
+        ((double*)(exprOperands.at("z").getStorage().getValues().getData())) : NULL;
+
+    TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals ? zvals[k] : 0.0;},
+               mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, alpha, AMKL, descr, xvals, beta, yvals);,
+               "\nMKL symmetric",repeat,timevalue,true)
+    validate("MKL symmetric", y_mkl, exprOperands.at("yRef"), reassociationTolerance);
+
+    mkl_sparse_set_mv_hint(AMKL, SPARSE_OPERATION_NON_TRANSPOSE, descr, repeat);
+    TACO_BENCH(mkl_sparse_optimize(AMKL);,"MKL symmetric analysis",1,timevalue,false)
+    TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals ? zvals[k] : 0.0;},
+               mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, alpha, AMKL, descr, xvals, beta, yvals);,
+               "MKL symmetric Optimized",repeat,timevalue,true)
+    validate("MKL symmetric Optimized", y_mkl, exprOperands.at("yRef"), reassociationTolerance);
+    mkl_sparse_destroy(AMKL);
+  }
+
+  template<typename T>
+  void exprToMKL(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                 int power);
+
+  template<>
+  void exprToMKL<double>(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                         int power) {
     switch(Expr) {
-      case SpMV: {
-        char matdescra[6] = "G  C ";
+      case SpMV:
+      case SparsityTTV: {
         int rows=exprOperands.at("A").getDimension(0);
-        int cols=exprOperands.at("A").getDimension(1);
-        int nnz=exprOperands.at("A").getStorage().getValues().getSize();
 
-        // convert to CSR
-        Tensor<double> ACSR({rows,cols}, CSR);
-        for (auto& value : iterate<double>(exprOperands.at("A"))) {
-          ACSR.insert({value.first.at(0),value.first.at(1)},value.second);
-        }
-        ACSR.pack();
+        // mkl_dcsrgemv only takes one-based indices
         double *a_CSR;
         int* ia_CSR;
         int* ja_CSR;
-        getCSRArrays(ACSR,&ia_CSR,&ja_CSR,&a_CSR);
-        for (int i = 0; i < rows+1; ++i) {
-          ia_CSR[i] = ia_CSR[i] + 1;
-        }
-        for (int i = 0; i < nnz; ++i) {
-          ja_CSR[i] = ja_CSR[i] + 1;
-        }
+        TACO_BENCH(oneBasedMKL(exprOperands.oneBasedCSR("A"),&ia_CSR,&ja_CSR,&a_CSR);,
+                   "\nMKL conversion",1,timevalue,false);
         Tensor<double> y_mkl({rows}, Dense);
         y_mkl.pack();
 
@@ -39,99 +80,110 @@ using namespace std;
         TACO_BENCH(mkl_dcsrgemv(&transa, &rows, a_CSR, ia_CSR, ja_CSR,
                                 (double*)(exprOperands.at("x").getStorage().getValues().getData()),
                                 (double*)(y_mkl.getStorage().getValues().getData()));,
-                   "\nMKL", repeat,timevalue,true)
+                   "MKL", repeat,timevalue,true)
 
         // commented for now due to floating-point precision issues
         // validate("MKL", y_mkl, exprOperands.at("yRef"));
 
+        if (exprOperands.count("ALower"))
+          benchMKLSymmetric(exprOperands,1.0,0.0,repeat,timevalue);
         break;
       }
       case PLUS3: {
         int rows=exprOperands.at("ARef").getDimension(0);
         int cols=exprOperands.at("ARef").getDimension(1);
-        int nnz=exprOperands.at("B").getStorage().getValues().getSize();
-        // convert to CSR
-        Tensor<double> BCSR({rows,cols}, CSR);
-        for (auto& value : iterate<double>(exprOperands.at("B"))) {
-          BCSR.insert({value.first.at(0),value.first.at(1)},value.second);
-        }
-        BCSR.pack();
-        double *b_CSR;
-        int* ib_CSR;
-        int* jb_CSR;
-        getCSRArrays(BCSR,&ib_CSR,&jb_CSR,&b_CSR);
-        Tensor<double> CCSR({rows,cols}, CSR);
-        for (auto& value : iterate<double>(exprOperands.at("C"))) {
-          CCSR.insert({value.first.at(0),value.first.at(1)},value.second);
-        }
-        CCSR.pack();
-        double *c_CSR;
-        int* ic_CSR;
-        int* jc_CSR;
-        getCSRArrays(CCSR,&ic_CSR,&jc_CSR,&c_CSR);
-        Tensor<double> DCSR({rows,cols}, CSR);
-        for (auto& value : iterate<double>(exprOperands.at("D"))) {
-          DCSR.insert({value.first.at(0),value.first.at(1)},value.second);
-        }
-        DCSR.pack();
-        double *d_CSR;
-        int* id_CSR;
-        int* jd_CSR;
-        getCSRArrays(DCSR,&id_CSR,&jd_CSR,&d_CSR);
+        // The classic sparse BLAS routines such as mkl_dcsradd only take
+        // one-based indices
+        double *b_CSR, *c_CSR, *d_CSR;
+        int *ib_CSR, *ic_CSR, *id_CSR;
+        int *jb_CSR, *jc_CSR, *jd_CSR;
+        TACO_BENCH(oneBasedMKL(exprOperands.oneBasedCSR("B"),&ib_CSR,&jb_CSR,&b_CSR);
+                   oneBasedMKL(exprOperands.oneBasedCSR("C"),&ic_CSR,&jc_CSR,&c_CSR);
+                   oneBasedMKL(exprOperands.oneBasedCSR("D"),&id_CSR,&jd_CSR,&d_CSR);,
+                   "\nMKL conversion",1,timevalue,false);
 
+        // A = T + D with T = B + C. The symbolic pass (request=1) only computes
+        // the row pointers of its output, which gives the exact size to
+        // allocate. T has to be computed once to get the pattern of A.
         char transa = 'N';
-        int ptrsize = rows + 1;
         double malpha=1.0;
-        double mbeta=0.0;
-
-        for (int i = 0; i < ptrsize; ++i) {
-          ib_CSR[i] = ib_CSR[i] + 1;
-          ic_CSR[i] = ic_CSR[i] + 1;
-          id_CSR[i] = id_CSR[i] + 1;
-        }
-        for (int i = 0; i < nnz; ++i) {
-          jb_CSR[i] = jb_CSR[i] + 1;
-          jc_CSR[i] = jc_CSR[i] + 1;
-          jd_CSR[i] = jd_CSR[i] + 1;
-        }
-        MKL_INT request = 0;
+        MKL_INT symbolic = 1;
+        MKL_INT numeric = 2;
         MKL_INT sort = 0;
         MKL_INT ret;
-        double *a_CSR;
-        int* ia_CSR;
-        int* ja_CSR;
+        MKL_INT nnzT, nnzA;
+        vector<int> it_CSR(rows+1), ia_CSR(rows+1);
+        vector<int> jt_CSR, ja_CSR;
+        vector<double> t_CSR, a_CSR;
+        TACO_BENCH(mkl_dcsradd(&transa, &symbolic, &sort, &rows, &cols, b_CSR, jb_CSR, ib_CSR, &malpha, c_CSR, jc_CSR, ic_CSR, NULL, NULL, it_CSR.data(), &nnzT, &ret);
+                   nnzT=it_CSR[rows]-1;
+                   jt_CSR.resize(nnzT);
+                   t_CSR.resize(nnzT);
+                   mkl_dcsradd(&transa, &numeric, &sort, &rows, &cols, b_CSR, jb_CSR, ib_CSR, &malpha, c_CSR, jc_CSR, ic_CSR, t_CSR.data(), jt_CSR.data(), it_CSR.data(), &nnzT, &ret);
+                   mkl_dcsradd(&transa, &symbolic, &sort, &rows, &cols, t_CSR.data(), jt_CSR.data(), it_CSR.data(), &malpha, d_CSR, jd_CSR, id_CSR, NULL, NULL, ia_CSR.data(), &nnzA, &ret);
+                   nnzA=ia_CSR[rows]-1;
+                   ja_CSR.resize(nnzA);
+                   a_CSR.resize(nnzA);,"MKL symbolic",1,timevalue,false);
 
-        TACO_BENCH( a_CSR = new double[4*nnz]; ia_CSR = new int[4*nnz]; ja_CSR = new int[4*nnz];
-             mkl_dcsradd(&transa, &request, &sort, &rows, &cols, b_CSR, jb_CSR, ib_CSR, &malpha, c_CSR, jc_CSR, ic_CSR, a_CSR, ja_CSR, ia_CSR, &nnz, &ret);
-             mkl_dcsradd(&transa, &request, &sort, &rows, &cols, a_CSR, ja_CSR, ia_CSR, &malpha, d_CSR, jd_CSR, id_CSR, a_CSR, ja_CSR, ia_CSR, &nnz, &ret);,
-             "\nMKL",repeat,timevalue,true);
+        TACO_BENCH(mkl_dcsradd(&transa, &numeric, &sort, &rows, &cols, b_CSR, jb_CSR, ib_CSR, &malpha, c_CSR, jc_CSR, ic_CSR, t_CSR.data(), jt_CSR.data(), it_CSR.data(), &nnzT, &ret);
+                   mkl_dcsradd(&transa, &numeric, &sort, &rows, &cols, t_CSR.data(), jt_CSR.data(), it_CSR.data(), &malpha, d_CSR, jd_CSR, id_CSR, a_CSR.data(), ja_CSR.data(), ia_CSR.data(), &nnzA, &ret);,
+                   "MKL",repeat,timevalue,true);
 
-        for (int i = 0; i < ptrsize; ++i) {
-          ia_CSR[i] = ia_CSR[i] - 1;
-        }
-        for (int i = 0; i < nnz; ++i) {
-          ja_CSR[i] = ja_CSR[i] - 1;
+        Tensor<double> AMKL({rows,cols}, CSR);
+        for (int i = 0; i < rows; ++i) {
+          for (int p = ia_CSR[i]-1; p < ia_CSR[i+1]-1; ++p)
+            AMKL.insert({i,ja_CSR[p]-1},a_CSR[p]);
         }
-        Tensor<double> AMKL=makeCSR("AMKL",{rows,cols}, ia_CSR, ja_CSR, a_CSR);
+        AMKL.pack();
         validate("MKL", AMKL, exprOperands.at("ARef"));
 
+        // Inspector-executor API: the handles share the one-based arrays.
+        // mkl_sparse_d_add sizes and allocates its output itself, so that
+        // allocation stays timed; outputs are destroyed outside the timer.
+        sparse_matrix_t BIE, CIE, DIE;
+        sparse_matrix_t TIE = NULL;
+        sparse_matrix_t AIE = NULL;
+        TACO_BENCH(mkl_sparse_d_create_csr(&BIE, SPARSE_INDEX_BASE_ONE, rows, cols, ib_CSR, ib_CSR+1, jb_CSR, b_CSR);
+                   mkl_sparse_d_create_csr(&CIE, SPARSE_INDEX_BASE_ONE, rows, cols, ic_CSR, ic_CSR+1, jc_CSR, c_CSR);
+                   mkl_sparse_d_create_csr(&DIE, SPARSE_INDEX_BASE_ONE, rows, cols, id_CSR, id_CSR+1, jd_CSR, d_CSR);,
+                   "\nMKL IE setup",1,timevalue,false);
+        TACO_BENCH_SETUP(if (TIE) mkl_sparse_destroy(TIE);
+                         if (AIE) mkl_sparse_destroy(AIE);,
+                         mkl_sparse_d_add(SPARSE_OPERATION_NON_TRANSPOSE, BIE, 1.0, CIE, &TIE);
+                         mkl_sparse_d_add(SPARSE_OPERATION_NON_TRANSPOSE, TIE, 1.0, DIE, &AIE);,
+                         "MKL IE",repeat,timevalue,true);
+
+        sparse_index_base_t indexing;
+        MKL_INT AIErows, AIEcols;
+        MKL_INT *rowsStart, *rowsEnd, *colIndex;
+        double* values;
+        mkl_sparse_d_export_csr(AIE, &indexing, &AIErows, &AIEcols, &rowsStart, &rowsEnd, &colIndex, &values);
+        Tensor<double> AMKLIE({rows,cols}, CSR);
+        for (int i = 0; i < rows; ++i) {
+          for (int p = rowsStart[i]-indexing; p < rowsEnd[i]-indexing; ++p)
+            AMKLIE.insert({i,colIndex[p]-indexing},values[p]);
+        }
+        AMKLIE.pack();
+        validate("MKL IE", AMKLIE, exprOperands.at("ARef"));
+
+        mkl_sparse_destroy(TIE);
+        mkl_sparse_destroy(AIE);
+        mkl_sparse_destroy(BIE);
+        mkl_sparse_destroy(CIE);
+        mkl_sparse_destroy(DIE);
         break;
       }
       case MATTRANSMUL: {
         char matdescra[6] = "G  C ";
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        int ptrsize = exprOperands.at("A").getStorage().getIndex().getSize();
         double *a_CSC;
         int* ia_CSC;
         int* ja_CSC;
-        getCSCArrays(exprOperands.at("A"),&ia_CSC,&ja_CSC,&a_CSC);
-        int* pointerB=new int[ptrsize-1];
-        int* pointerE=new int[ptrsize-1];
-        for (int i=0; i<ptrsize-1; i++) {
-          pointerB[i]=ia_CSC[i];
-          pointerE[i]=ia_CSC[i+1];
-        }
+        getCSCArrays(exprOperands.csc("A"),&ia_CSC,&ja_CSC,&a_CSC);
+        vector<int> pointerB(cols), pointerE(cols);
+        TACO_BENCH(for (int k=0; k<cols; k++) {pointerB[k]=ia_CSC[k]; pointerE[k]=ia_CSC[k+1];},
+                   "\nMKL conversion",1,timevalue,false);
         Tensor<double> y_mkl({rows}, Dense);
         y_mkl.pack();
 
@@ -141,40 +193,32 @@ using namespace std;
         double* zvals=((double*)(exprOperands.at("z").getStorage().getValues().getData()));
 
         char transa = 'T';
-        TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-        mkl_dcscmv(&transa, &rows, &cols, &alpha, matdescra, a_CSC, ja_CSC, pointerB,
-                   pointerE, (double*)(exprOperands.at("x").getStorage().getValues().getData()),
+        TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];},
+        mkl_dcscmv(&transa, &rows, &cols, &alpha, matdescra, a_CSC, ja_CSC, pointerB.data(),
+                   pointerE.data(), (double*)(exprOperands.at("x").getStorage().getValues().getData()),
                    &beta, (double*)(y_mkl.getStorage().getValues().getData()));,
-                   "\nMKL", repeat,timevalue,true)
+                   "MKL", repeat,timevalue,true)
 
         validate("MKL", y_mkl, exprOperands.at("yRef"));
 
+        if (exprOperands.count("ALower"))
+          benchMKLSymmetric(exprOperands,alpha,beta,repeat,timevalue);
         break;
       }
-      case RESIDUAL: {
+      case RESIDUAL:
+      case SparsitySpMV: {
         char matdescra[6] = "G  C ";
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        int nnz=exprOperands.at("A").getStorage().getValues().getSize();
-        // convert to CSR
-        Tensor<double> ACSR({rows,cols}, CSR);
-        for (auto& value : iterate<double>(exprOperands.at("A"))) {
-          ACSR.insert({value.first.at(0),value.first.at(1)},value.second);
-        }
-        ACSR.pack();
         double *a_CSR;
         int* ia_CSR;
         int* ja_CSR;
-        getCSRArrays(ACSR,&ia_CSR,&ja_CSR,&a_CSR);
-        double alpha=-1.0;
-        double beta=1.0;
-
-        int* pointerB=new int[nnz];
-        int* pointerE=new int[nnz];
-        for (int i=0; i<nnz; i++) {
-          pointerB[i]=ia_CSR[i];
-          pointerE[i]=ia_CSR[i+1];
-        }
+        vector<int> pointerB(rows), pointerE(rows);
+        TACO_BENCH(getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+                   for (int k=0; k<rows; k++) {pointerB[k]=ia_CSR[k]; pointerE[k]=ia_CSR[k+1];},
+                   "\nMKL conversion",1,timevalue,false);
+        double alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+        double beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
 
         Tensor<double> y_mkl({rows}, Dense);
         y_mkl.pack();
@@ -183,67 +227,94 @@ using namespace std;
         double* zvals=((double*)(exprOperands.at("z").getStorage().getValues().getData()));
 
         char transa = 'N';
-        TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-        mkl_dcsrmv(&transa, &rows, &cols, &alpha, matdescra, a_CSR, ja_CSR, pointerB,
-                   pointerE, (double*)(exprOperands.at("x").getStorage().getValues().getData()),
+        TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];},
+        mkl_dcsrmv(&transa, &rows, &cols, &alpha, matdescra, a_CSR, ja_CSR, pointerB.data(),
+                   pointerE.data(), (double*)(exprOperands.at("x").getStorage().getValues().getData()),
                    &beta, (double*)(y_mkl.getStorage().getValues().getData()));,
-                   "\nMKL", repeat,timevalue,true)
+                   "MKL", repeat,timevalue,true)
 
-        validate("MKL", y_mkl, exprOperands.at("yRef"));
+        validate("MKL", y_mkl, exprOperands.at("yRef"), reassociationTolerance);
 
+        if (exprOperands.count("ALower"))
+          benchMKLSymmetric(exprOperands,alpha,beta,repeat,timevalue);
         break;
       }
       case SparsitySpMDM: {
-        // use MKL to benchmark dense matrix-matrix mult
+        char matdescra[6] = "G  C ";
         int rows=exprOperands.at("CRef").getDimension(0);
         int cols=exprOperands.at("CRef").getDimension(1);
-        double* C_mkl = (double*)malloc(sizeof(double)*rows*cols);
-        double* A_mkl = (double*)exprOperands.at("A").getStorage().getValues().getData();
+        int Ksize=exprOperands.at("A").getDimension(1);
+        double alpha = 1.0;
+        double beta = 0.0;
+
+        // sparse A, 0-based so that B and C are row-major
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        TACO_BENCH(getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);,
+                   "\nMKL conversion",1,timevalue,false);
         double* B_mkl = (double*)exprOperands.at("B").getStorage().getValues().getData();
+        vector<double> C_csrmm((size_t)rows*cols);
+
+        char transa = 'N';
+        TACO_BENCH(mkl_dcsrmm(&transa, &rows, &cols, &Ksize, &alpha, matdescra, a_CSR, ja_CSR, ia_CSR,
+                              ia_CSR+1, B_mkl, &cols, &beta, C_csrmm.data(), &cols);,
+                   "MKL", repeat, timevalue, true);
+
+        Tensor<double> C_mkl_sparse({rows, cols}, Format({Dense,Dense}));
+        for (int i=0; i<rows; i++)
+          for (int j=0; j<cols; j++)
+            C_mkl_sparse.insert({i,j},C_csrmm[(size_t)i*cols+j]);
+        C_mkl_sparse.pack();
+        validate("MKL", C_mkl_sparse, exprOperands.at("CRef"), reassociationTolerance);
+
+        // use MKL to benchmark dense matrix-matrix mult
+        if (!exprOperands.count("ADense"))
+          break;
+        double* C_mkl = (double*)malloc(sizeof(double)*rows*cols);
+        double* A_mkl = (double*)exprOperands.at("ADense").getStorage().getValues().getData();
 #ifdef MKL_PRINT_DENSE
         for (int i=0; i<rows; i++) {
-          for (int j=0; j<cols; j++) {
-            printf(" %g ", ((double*)(exprOperands.at("A").getStorage().getValues().getData()))[i+j*rows]);
+          for (int j=0; j<Ksize; j++) {
+            printf(" %g ", A_mkl[(size_t)i*Ksize+j]);
           }
           printf("\n");
         }
         printf("\n");
-        for (int i=0; i<rows; i++) {
+        for (int i=0; i<Ksize; i++) {
           for (int j=0; j<cols; j++) {
-            printf(" %g ", ((double*)(exprOperands.at("B").getStorage().getValues().getData()))[i+j*rows]);
+            printf(" %g ", B_mkl[(size_t)i*cols+j]);
           }
           printf("\n");
         } 
         printf("\n");
 #endif
-        double alpha = 1.0;
-        double beta = 0.0;
-        
-        // this does alpha * op(A) * op(B) + beta*C
+        // this does alpha * op(A) * op(B) + beta*C. A, B and C are row-major,
+        // so their leading dimensions are their numbers of columns
         TACO_BENCH(
           cblas_dgemm(CblasRowMajor, CblasNoTrans, CblasNoTrans, rows, cols,
-                      rows, alpha, A_mkl, rows, B_mkl, cols, beta, C_mkl, rows);,
-	"\nMKL", repeat, timevalue, true);
+                      Ksize, alpha, A_mkl, Ksize, B_mkl, cols, beta, C_mkl, cols);,
+	"MKL dense", repeat, timevalue, true);
         
         Tensor<double> C_mkl_validation({rows, cols}, Format({Dense,Dense}));
         for (int i=0; i<rows; i++) {
           for (int j=0; j<cols; j++) {
-            C_mkl_validation.insert({i,j},C_mkl[i+j*rows]);
+            C_mkl_validation.insert({i,j},C_mkl[(size_t)i*cols+j]);
           }
         }
-        validate("MKL", C_mkl_validation, exprOperands.at("CRef"));
+        validate("MKL dense", C_mkl_validation, exprOperands.at("CRef"), reassociationTolerance);
 
 #ifdef MKL_PRINT_DENSE        
         for (int i=0; i<rows; i++) {
           for (int j=0; j<cols; j++) {
-            printf(" %g ", C_mkl[i+j*rows]);
+            printf(" %g ", C_mkl[(size_t)i*cols+j]);
           }
           printf("\n");
         }
         printf("\n");
         for (int i=0; i<rows; i++) {
           for (int j=0; j<cols; j++) {
-            printf(" %g ", ((double*)(exprOperands.at("CRef").getStorage().getValues().getData()))[i+j*rows]);
+            printf(" %g ", ((double*)(exprOperands.at("CRef").getStorage().getValues().getData()))[(size_t)i*cols+j]);
           }
           printf("\n");
         }
@@ -251,10 +322,389 @@ using namespace std;
        free(C_mkl);
         break;
       }
+      case SpTRSV: {
+        int rows=exprOperands.at("L").getDimension(0);
+        double* bvals=((double*)(exprOperands.at("b").getStorage().getValues().getData()));
+
+        vector<string> triangles {"L","U"};
+        for (auto& triangle : triangles) {
+          double *a_CSR;
+          int* ia_CSR;
+          int* ja_CSR;
+          getCSRArrays(exprOperands.at(triangle),&ia_CSR,&ja_CSR,&a_CSR);
+
+          // 0-based handle sharing taco's arrays
+          sparse_matrix_t AMKL;
+          mkl_sparse_d_create_csr(&AMKL, SPARSE_INDEX_BASE_ZERO, rows, rows,
+                                  ia_CSR, ia_CSR+1, ja_CSR, a_CSR);
+          struct matrix_descr descr;
+          descr.type = SPARSE_MATRIX_TYPE_TRIANGULAR;
+          descr.mode = (triangle=="L") ? SPARSE_FILL_MODE_LOWER : SPARSE_FILL_MODE_UPPER;
+          descr.diag = SPARSE_DIAG_NON_UNIT;
+          mkl_sparse_set_sv_hint(AMKL, SPARSE_OPERATION_NON_TRANSPOSE, descr, repeat);
+
+          TACO_BENCH(mkl_sparse_optimize(AMKL);,"\nMKL "+triangle+" analysis",1,timevalue,false)
+
+          Tensor<double> x_mkl({rows}, Dense);
+          x_mkl.pack();
+          double* xvals=((double*)(x_mkl.getStorage().getValues().getData()));
+
+          TACO_BENCH(mkl_sparse_d_trsv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, AMKL, descr, bvals, xvals);,
+                     "MKL "+triangle,repeat,timevalue,true)
+
+          // mkl_sparse_optimize may reorder the solve, so the sums of a row
+          // are not in the order of the reference
+          validate("MKL "+triangle, x_mkl, exprOperands.at("x"+triangle+"Ref"), reassociationTolerance);
+          mkl_sparse_destroy(AMKL);
+        }
+        break;
+      }
+      case BatchSpMV: {
+        int problems=batchSize(exprOperands,"A");
+        struct matrix_descr descr;
+        descr.type = SPARSE_MATRIX_TYPE_GENERAL;
+
+        // 0-based handles sharing taco's arrays, the block-diagonal one last
+        vector<sparse_matrix_t> AMKL(problems+1);
+        vector<double*> xvals(problems+1), yvals(problems+1);
+        vector<Tensor<double>> y_mkl;
+        for (int k=0; k<=problems; k++) {
+          string id = (k<problems) ? to_string(k) : "";
+          const Tensor<double>& A=exprOperands.at("A"+id);
+          int rows=A.getDimension(0);
+          int cols=A.getDimension(1);
+          double *a_CSR;
+          int* ia_CSR;
+          int* ja_CSR;
+          getCSRArrays(A,&ia_CSR,&ja_CSR,&a_CSR);
+          mkl_sparse_d_create_csr(&AMKL[k], SPARSE_INDEX_BASE_ZERO, rows, cols,
+                                  ia_CSR, ia_CSR+1, ja_CSR, a_CSR);
+          y_mkl.push_back(Tensor<double>({rows}, Dense));
+          y_mkl[k].pack();
+          xvals[k]=(double*)(exprOperands.at("x"+id).getStorage().getValues().getData());
+          yvals[k]=(double*)(y_mkl[k].getStorage().getValues().getData());
+        }
+
+        taco::util::TimeResults backToBack, blockDiagonal;
+        TACO_BENCH(for (int k=0; k<problems; k++) mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, AMKL[k], descr, xvals[k], 0.0, yvals[k]);,
+                   "\nMKL back-to-back",repeat,backToBack,true);
+        TACO_BENCH(mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, AMKL[problems], descr, xvals[problems], 0.0, yvals[problems]);,
+                   "MKL block-diagonal",repeat,blockDiagonal,true);
+        reportBatch("MKL",problems,backToBack,blockDiagonal);
+
+        for (int k=0; k<problems; k++)
+          validate("MKL back-to-back "+to_string(k), y_mkl[k], exprOperands.at("yRef"+to_string(k)),
+                   reassociationTolerance);
+        validate("MKL block-diagonal", y_mkl[problems], exprOperands.at("yRef"), reassociationTolerance);
+        for (auto& A : AMKL)
+          mkl_sparse_destroy(A);
+        break;
+      }
+      case MATPOW: {
+        // k SpMVs ping-ponging between y and work, as MKL has no matrix powers
+        // kernel. A 0-based handle shares taco's arrays.
+        int rows=exprOperands.at("A").getDimension(0);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        sparse_matrix_t AMKL;
+        mkl_sparse_d_create_csr(&AMKL, SPARSE_INDEX_BASE_ZERO, rows, rows,
+                                ia_CSR, ia_CSR+1, ja_CSR, a_CSR);
+        struct matrix_descr descr;
+        descr.type = SPARSE_MATRIX_TYPE_GENERAL;
+        double* xvals=((double*)(exprOperands.at("x").getStorage().getValues().getData()));
+        vector<double> y(rows), work(rows);
+
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH(for (int l=1; l<=power; l++)
+                     mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, AMKL, descr,
+                                     (l==1) ? xvals : (((power-l)%2) ? y.data() : work.data()),
+                                     0.0, ((power-l)%2) ? work.data() : y.data());,
+                   "\nMKL",repeat,untunedTime,true);
+        cout << "MKL time per power (ms)" << endl << untunedTime.mean/power << endl;
+        Tensor<double> y_mkl({rows}, Dense);
+        VectorTotaco(y,y_mkl);
+        validate("MKL", y_mkl, exprOperands.at("yRef"), reassociationTolerance);
+
+        mkl_sparse_set_mv_hint(AMKL, SPARSE_OPERATION_NON_TRANSPOSE, descr, repeat*power);
+        TACO_BENCH(mkl_sparse_optimize(AMKL);,"\nMKL analysis",1,tuningTime,false);
+        TACO_BENCH(for (int l=1; l<=power; l++)
+                     mkl_sparse_d_mv(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, AMKL, descr,
+                                     (l==1) ? xvals : (((power-l)%2) ? y.data() : work.data()),
+                                     0.0, ((power-l)%2) ? work.data() : y.data());,
+                   "MKL Optimized",repeat,tunedTime,true);
+        reportBreakEven("MKL Optimized", tuningTime.mean, untunedTime, tunedTime);
+        Tensor<double> y_mklOptimized({rows}, Dense);
+        VectorTotaco(y,y_mklOptimized);
+        validate("MKL Optimized", y_mklOptimized, exprOperands.at("yRef"), reassociationTolerance);
+        mkl_sparse_destroy(AMKL);
+        break;
+      }
       default:
         cout << " !! Expression not implemented for MKL" << endl;
         break;
     }
   }
 
+  // Single precision goes through the inspector-executor API, which shares
+  // taco's 0-based index arrays and only needs a float copy of the values
+  template<>
+  void exprToMKL<float>(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                        int power) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        // A^T is computed as the CSR matrix given by the CSC arrays of A
+        bool transposed = (Expr==MATTRANSMUL);
+        const Tensor<double>& A=exprOperands.at("A");
+        int rows=A.getDimension(transposed ? 1 : 0);
+        int cols=A.getDimension(transposed ? 0 : 1);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        if (transposed)
+          getCSCArrays(exprOperands.csc("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        else
+          getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        vector<float> a_float(a_CSR, a_CSR+ia_CSR[rows]);
+
+        sparse_matrix_t AMKL;
+        mkl_sparse_s_create_csr(&AMKL, SPARSE_INDEX_BASE_ZERO, rows, cols,
+                                ia_CSR, ia_CSR+1, ja_CSR, a_float.data());
+        struct matrix_descr descr;
+        descr.type = SPARSE_MATRIX_TYPE_GENERAL;
+
+        float alpha=1.0;
+        float beta=0.0;
+        if (hasAlphaBeta(Expr)) {
+          alpha = (float)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = (float)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+        }
+        double* xvals=((double*)(exprOperands.at("x").getStorage().getValues().getData()));
+        vector<float> x_float(xvals, xvals+cols);
+        vector<float> z_float(rows);
+        if (hasAlphaBeta(Expr)) {
+          double* zvals=((double*)(exprOperands.at("z").getStorage().getValues().getData()));
+          z_float.assign(zvals, zvals+rows);
+        }
+        vector<float> y_float(rows);
+
+        if (!hasAlphaBeta(Expr)) {
+          TACO_BENCH(mkl_sparse_s_mv(SPARSE_OPERATION_NON_TRANSPOSE, alpha, AMKL, descr, x_float.data(), beta, y_float.data());,
+                     "\nMKL", repeat,timevalue,true) }
+        else {
+          TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {y_float[k]=z_float[k];},
+                     mkl_sparse_s_mv(SPARSE_OPERATION_NON_TRANSPOSE, alpha, AMKL, descr, x_float.data(), beta, y_float.data());,
+                     "\nMKL", repeat,timevalue,true) }
+
+        Tensor<double> y_mkl({rows}, Dense);
+        for (int i=0; i<rows; i++)
+          y_mkl.insert({i}, (double)y_float[i]);
+        y_mkl.pack();
+        validate("MKL", y_mkl, exprOperands.at("yRef"), precisionTolerance<float>());
+
+        mkl_sparse_destroy(AMKL);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for MKL in single precision" << endl;
+        break;
+    }
+  }
+
+  // Wrap the CSC arrays of a CSC matrix, or the shared CSR arrays of any
+  // other, in an inspector-executor handle, zero-based and without copy
+  void tacoToMKLIE(const OperandStore& operands, string name, sparse_matrix_t& dst) {
+    const Tensor<double>& src=operands.at(name);
+    int rows=src.getDimension(0);
+    int cols=src.getDimension(1);
+    double *vals;
+    int* pos;
+    int* crd;
+    if (src.getFormat()==CSC) {
+      getCSCArrays(src,&pos,&crd,&vals);
+      mkl_sparse_d_create_csc(&dst, SPARSE_INDEX_BASE_ZERO, rows, cols, pos, pos+1, crd, vals);
+    }
+    else {
+      getCSRArrays(operands.csr(name),&pos,&crd,&vals);
+      mkl_sparse_d_create_csr(&dst, SPARSE_INDEX_BASE_ZERO, rows, cols, pos, pos+1, crd, vals);
+    }
+  }
+
+  void MKLIETotaco(const vector<double>& src, int rows, int cols, Tensor<double>& dst,
+                   DenseLayout layout=RowMajorLayout) {
+    for (int i=0; i<rows; i++)
+      for (int j=0; j<cols; j++)
+        dst.insert({i,j}, src[(layout==RowMajorLayout) ? (size_t)i*cols+j : (size_t)j*rows+i]);
+    dst.pack();
+  }
+
+  // C = A*B with mkl_sparse_d_mm, B and C dense row-major, or also both
+  // column-major with -layouts: MKL takes B and C in the same layout. The
+  // optimization hinted with the repeat count is timed on its own, as OSKI
+  // tuning is.
+  void benchMKLIEmm(const OperandStore& exprOperands, int repeat, taco::util::TimeResults timevalue,
+                    bool layouts) {
+    const Tensor<double>& CRef=exprOperands.at("CRef");
+    int rows=exprOperands.at("A").getDimension(0);
+    int Ksize=exprOperands.at("A").getDimension(1);
+    int cols=exprOperands.at("B").getDimension(1);
+    struct matrix_descr descr;
+    descr.type = SPARSE_MATRIX_TYPE_GENERAL;
+    vector<double> C((size_t)rows*cols);
+
+    vector<DenseLayout> sweep={RowMajorLayout};
+    if (layouts)
+      sweep.push_back(ColMajorLayout);
+    for (DenseLayout layout : sweep) {
+      bool rowMajor=(layout==RowMajorLayout);
+      string name=rowMajor ? string("MKL-IE") : "MKL-IE "+denseLayoutNames[layout];
+      sparse_layout_t mklLayout=rowMajor ? SPARSE_LAYOUT_ROW_MAJOR : SPARSE_LAYOUT_COLUMN_MAJOR;
+      const Tensor<double>& B=rowMajor ? exprOperands.rowMajor("B") : exprOperands.colMajor("B");
+      const double* Bvals=(double*)(B.getStorage().getValues().getData());
+      int ldb=rowMajor ? cols : Ksize;
+      int ldc=rowMajor ? cols : rows;
+      sparse_matrix_t AMKL;
+      TACO_BENCH(tacoToMKLIE(exprOperands,"A",AMKL);,"\n"+name+" setup",1,timevalue,false);
+
+      taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+      TACO_BENCH(mkl_sparse_d_mm(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, AMKL, descr, mklLayout,
+                                 Bvals, cols, ldb, 0.0, C.data(), ldc);,name,repeat,untunedTime,true);
+      Tensor<double> C_mkl({rows,cols}, Format({Dense,Dense}));
+      MKLIETotaco(C,rows,cols,C_mkl,layout);
+      validate(name, C_mkl, CRef, reassociationTolerance);
+
+      TACO_BENCH(mkl_sparse_set_mm_hint(AMKL, SPARSE_OPERATION_NON_TRANSPOSE, descr, mklLayout, cols, repeat);
+                 mkl_sparse_optimize(AMKL);,name+" optimize",1,tuningTime,false);
+      TACO_BENCH(mkl_sparse_d_mm(SPARSE_OPERATION_NON_TRANSPOSE, 1.0, AMKL, descr, mklLayout,
+                                 Bvals, cols, ldb, 0.0, C.data(), ldc);,name+" Optimized",repeat,tunedTime,true);
+      reportBreakEven(name+" Optimized", tuningTime.mean, untunedTime, tunedTime);
+      Tensor<double> C_mklOptimized({rows,cols}, Format({Dense,Dense}));
+      MKLIETotaco(C,rows,cols,C_mklOptimized,layout);
+      validate(name+" Optimized", C_mklOptimized, CRef, reassociationTolerance);
+
+      mkl_sparse_destroy(AMKL);
+    }
+  }
+
+  // C = A*B with dgemm on the dense A, for A and B in layout lb and C in
+  // layout lc. dgemm reads an operand stored in the other layout than C as
+  // its transpose.
+  void denseLayoutDgemm(DenseLayout lb, DenseLayout lc, int rows, int cols, int Ksize,
+                        const double* A, const double* B, double* C) {
+    CBLAS_LAYOUT order=(lc==RowMajorLayout) ? CblasRowMajor : CblasColMajor;
+    CBLAS_TRANSPOSE trans=(lb==lc) ? CblasNoTrans : CblasTrans;
+    int lda=(lb==RowMajorLayout) ? Ksize : rows;
+    int ldb=(lb==RowMajorLayout) ? cols : Ksize;
+    int ldc=(lc==RowMajorLayout) ? cols : rows;
+    cblas_dgemm(order, trans, trans, rows, cols, Ksize, 1.0, A, lda, B, ldb, 0.0, C, ldc);
+  }
+
+  // "MKL dense" over the row-major and column-major combinations of the
+  // operands and the result, with -layouts
+  void benchMKLDenseLayouts(const OperandStore& exprOperands, int repeat, taco::util::TimeResults timevalue) {
+    if (!exprOperands.count("ADense"))
+      return;
+    const Tensor<double>& CRef=exprOperands.at("CRef");
+    int rows=CRef.getDimension(0);
+    int cols=CRef.getDimension(1);
+    int Ksize=exprOperands.at("ADense").getDimension(1);
+    vector<double> C((size_t)rows*cols);
+    bool first=true;
+    for (DenseLayout lb : {RowMajorLayout,ColMajorLayout}) {
+      bool rowMajor=(lb==RowMajorLayout);
+      const Tensor<double>& ALayout=rowMajor ? exprOperands.rowMajor("ADense") : exprOperands.colMajor("ADense");
+      const Tensor<double>& BLayout=rowMajor ? exprOperands.rowMajor("B") : exprOperands.colMajor("B");
+      const double* A=(double*)(ALayout.getStorage().getValues().getData());
+      const double* B=(double*)(BLayout.getStorage().getValues().getData());
+      for (DenseLayout lc : {RowMajorLayout,ColMajorLayout}) {
+        string name="MKL dense A,B "+denseLayoutNames[lb]+" C "+denseLayoutNames[lc];
+        TACO_BENCH(denseLayoutDgemm(lb,lc,rows,cols,Ksize,A,B,C.data());,
+                   (first ? "\n" : "")+name,repeat,timevalue,true);
+        first=false;
+        Tensor<double> C_mkl({rows,cols}, Format({Dense,Dense}));
+        MKLIETotaco(C,rows,cols,C_mkl,lc);
+        validate(name, C_mkl, CRef, reassociationTolerance);
+      }
+    }
+  }
+
+  void exprToMKLIE(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                   bool layouts) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        const Tensor<double>& A=exprOperands.at("A");
+        sparse_operation_t op = (Expr==MATTRANSMUL) ? SPARSE_OPERATION_TRANSPOSE : SPARSE_OPERATION_NON_TRANSPOSE;
+        int rows=A.getDimension(Expr==MATTRANSMUL ? 1 : 0);
+        sparse_matrix_t AMKL;
+        TACO_BENCH(tacoToMKLIE(exprOperands,"A",AMKL);,"\nMKL-IE setup",1,timevalue,false);
+        struct matrix_descr descr;
+        descr.type = SPARSE_MATRIX_TYPE_GENERAL;
+
+        double alpha=1.0;
+        double beta=0.0;
+        const double* x=(double*)(exprOperands.at("x").getStorage().getValues().getData());
+        const double* z=NULL;
+        if (hasAlphaBeta(Expr)) {
+          alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          z = (double*)(exprOperands.at("z").getStorage().getValues().getData());
+        }
+        vector<double> y(rows);
+
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH_SETUP(if (z) for (int k=0; k<rows; k++) y[k]=z[k];,
+                         mkl_sparse_d_mv(op, alpha, AMKL, descr, x, beta, y.data());,"MKL-IE",repeat,untunedTime,true);
+        Tensor<double> y_mkl({rows}, Dense);
+        VectorTotaco(y,y_mkl);
+        validate("MKL-IE", y_mkl, exprOperands.at("yRef"), reassociationTolerance);
+
+        TACO_BENCH(mkl_sparse_set_mv_hint(AMKL, op, descr, repeat);
+                   mkl_sparse_optimize(AMKL);,"MKL-IE optimize",1,tuningTime,false);
+        TACO_BENCH_SETUP(if (z) for (int k=0; k<rows; k++) y[k]=z[k];,
+                         mkl_sparse_d_mv(op, alpha, AMKL, descr, x, beta, y.data());,"MKL-IE Optimized",repeat,tunedTime,true);
+        reportBreakEven("MKL-IE Optimized", tuningTime.mean, untunedTime, tunedTime);
+        Tensor<double> y_mklOptimized({rows}, Dense);
+        VectorTotaco(y,y_mklOptimized);
+        validate("MKL-IE Optimized", y_mklOptimized, exprOperands.at("yRef"), reassociationTolerance);
+
+        mkl_sparse_destroy(AMKL);
+        break;
+      }
+      case SparsitySpMDM: {
+        benchMKLIEmm(exprOperands,repeat,timevalue,layouts);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for MKL-IE" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration mklRegistration("MKL",
+      {SpMV,PLUS3,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV,SparsitySpMDM,SpTRSV,BatchSpMV,
+       MATPOW},
+      true, true, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        if (run.precision==F64)
+          exprToMKL<double>(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters));
+        else
+          exprToMKL<float>(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters));
+        if (run.expr==SparsitySpMDM && run.precision==F64 && sweepLayouts(run.parameters))
+          benchMKLDenseLayouts(run.operands,run.repeat,timevalue);
+      });
+
+  static ProductRegistration mklIERegistration("MKL-IE",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV,SparsitySpMDM},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToMKLIE(run.expr,run.operands,run.repeat,timevalue,sweepLayouts(run.parameters));
+      });
+
 #endif
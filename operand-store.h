@@ -0,0 +1,109 @@
+#ifndef TACO_BENCH_OPERAND_STORE_H
+#define TACO_BENCH_OPERAND_STORE_H
+
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+// Copy a tensor into another format
+inline Tensor<double> convertTensor(const Tensor<double>& src, Format format) {
+  Tensor<double> dst(src.getDimensions(),format);
+  for (auto& value : iterate<double>(src))
+    dst.insert(value.first,value.second);
+  dst.pack();
+  return dst;
+}
+
+// CSR arrays owned outside of taco, e.g. one-based
+struct CSRArrays {
+  vector<int> pos;
+  vector<int> crd;
+  vector<double> vals;
+};
+
+// Operands of an expression shared by all the products. The representations
+// the products start from (CSR, CSC, one-based CSR, dense row-major or
+// column-major, transpose) are computed at most once, on first use, and
+// handed out as const views, so that a product only pays the conversion to
+// its own data structures.
+struct OperandStore {
+  const map<string,Tensor<double>>& operands;
+  mutable map<string,Tensor<double>> conversions;
+  mutable map<string,CSRArrays> oneBased;
+
+  OperandStore(const map<string,Tensor<double>>& operands) : operands(operands) {}
+
+  const Tensor<double>& at(string name) const {
+    return operands.at(name);
+  }
+
+  size_t count(string name) const {
+    return operands.count(name);
+  }
+
+  const Tensor<double>& csr(string name) const {
+    return inFormat(name,"CSR",CSR);
+  }
+
+  const Tensor<double>& csc(string name) const {
+    return inFormat(name,"CSC",CSC);
+  }
+
+  const Tensor<double>& rowMajor(string name) const {
+    return inFormat(name,"RowMajor",Format({Dense,Dense}));
+  }
+
+  const Tensor<double>& colMajor(string name) const {
+    return inFormat(name,"ColMajor",Format({Dense,Dense},{1,0}));
+  }
+
+  // Transpose of a matrix, in CSR
+  const Tensor<double>& transposed(string name) const {
+    string key=name+":Transposed";
+    auto conversion=conversions.find(key);
+    if (conversion!=conversions.end())
+      return conversion->second;
+    const Tensor<double>& src=operands.at(name);
+    Tensor<double> dst({src.getDimension(1),src.getDimension(0)},CSR);
+    for (auto& value : iterate<double>(src))
+      dst.insert({value.first.at(1),value.first.at(0)},value.second);
+    dst.pack();
+    return conversions[key]=dst;
+  }
+
+  // One-based CSR arrays, as the classic sparse BLAS routines take them
+  const CSRArrays& oneBasedCSR(string name) const {
+    auto conversion=oneBased.find(name);
+    if (conversion!=oneBased.end())
+      return conversion->second;
+    const Tensor<double>& src=csr(name);
+    int rows=src.getDimension(0);
+    double *vals;
+    int* pos;
+    int* crd;
+    getCSRArrays(src,&pos,&crd,&vals);
+    CSRArrays& dst=oneBased[name];
+    dst.pos.resize(rows+1);
+    dst.crd.resize(pos[rows]);
+    dst.vals.assign(vals,vals+pos[rows]);
+    for (int i=0; i<rows+1; i++)
+      dst.pos[i]=pos[i]+1;
+    for (int p=0; p<pos[rows]; p++)
+      dst.crd[p]=crd[p]+1;
+    return dst;
+  }
+
+  const Tensor<double>& inFormat(string name, string tag, Format format) const {
+    const Tensor<double>& src=operands.at(name);
+    if (src.getFormat()==format)
+      return src;
+    string key=name+":"+tag;
+    auto conversion=conversions.find(key);
+    if (conversion!=conversions.end())
+      return conversion->second;
+    return conversions[key]=convertTensor(src,format);
+  }
+};
+
+#endif
@@ -34,28 +34,65 @@ extern "C" {
                              cols, STRIDE_UNIT);
   }
 
-  void exprToOSKI(BenchExpr Expr, map<string,Tensor<double>> exprOperands,int repeat, taco::util::TimeResults timevalue) {
+  // OSKI reads only the lower triangle of a symmetric A with MAT_SYMM_LOWER.
+  // y is reset to z before each product.
+  void benchOSKISymmetric(const OperandStore& exprOperands, double alpha, double beta,
+                          int repeat, taco::util::TimeResults timevalue) {
+    const Tensor<double>& ALower=exprOperands.csr("ALower");
+    int rows=ALower.getDimension(0);
+    double *a_CSR;
+    int* ia_CSR;
+    int* ja_CSR;
+    getCSRArrays(ALower,&ia_CSR,&ja_CSR,&a_CSR);
+    oski_matrix_t Aoski;
+    oski_vecview_t xoski, yoski;
+    TACO_BENCH(Aoski = oski_CreateMatCSR(ia_CSR,ja_CSR,a_CSR,rows,rows,SHARE_INPUTMAT,
+                                         2,INDEX_ZERO_BASED,MAT_SYMM_LOWER);
+               tacoToOSKI(exprOperands.at("x"),xoski);,"\nOSKI symmetric conversion",1,timevalue,false);
+    Tensor<double> y_oski({rows}, Dense);
+    y_oski.pack();
+    tacoToOSKI(y_oski,yoski);
+    double* yvals=((double*)(y_oski.getStorage().getValues().getData()));
+    const double* zvals=exprOperands.count("z") ?
+        ((double*)(exprOperands.at("z").getStorage().getValues().getData())) : NULL;
+
+    taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+    TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals ? zvals[k] : 0.0;},
+               oski_MatMult(Aoski, OP_NORMAL, alpha, xoski, beta, yoski);,"OSKI symmetric",repeat,untunedTime,true);
+    validate("OSKI symmetric", y_oski, exprOperands.at("yRef"), reassociationTolerance);
+
+    oski_SetHintMatMult(Aoski, OP_NORMAL, alpha, SYMBOLIC_VEC, beta, SYMBOLIC_VEC, ALWAYS_TUNE_AGGRESSIVELY);
+    TACO_BENCH(oski_TuneMat(Aoski);,"\nOSKI symmetric tuning",1,tuningTime,false);
+    TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals ? zvals[k] : 0.0;},
+               oski_MatMult(Aoski, OP_NORMAL, alpha, xoski, beta, yoski);,"OSKI symmetric Tuned",repeat,tunedTime,true);
+    reportBreakEven("OSKI symmetric Tuned", tuningTime.mean, untunedTime, tunedTime);
+  }
+
+  void exprToOSKI(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                  int power) {
     switch(Expr) {
-      case SpMV: {
+      case SpMV:
+      case SparsityTTV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
         oski_matrix_t Aoski;
         oski_vecview_t xoski, yoski;
         oski_Init();
 
-        tacoToOSKI(exprOperands.at("A"),Aoski);
-        tacoToOSKI(exprOperands.at("x"),xoski);
+        TACO_BENCH(tacoToOSKI(exprOperands.at("A"),Aoski);
+                   tacoToOSKI(exprOperands.at("x"),xoski);,"\nOSKI conversion",1,timevalue,false);
         Tensor<double> y_oski({rows}, Dense);
         y_oski.pack();
         tacoToOSKI(y_oski,yoski);
 
-        TACO_BENCH( oski_MatMult(Aoski, OP_NORMAL, 1, xoski, 0, yoski);,"\nOSKI",repeat,timevalue,true );
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH( oski_MatMult(Aoski, OP_NORMAL, 1, xoski, 0, yoski);,"OSKI",repeat,untunedTime,true );
 
         validate("OSKI", y_oski, exprOperands.at("yRef"));
 
         // Tuned version
         oski_SetHintMatMult(Aoski, OP_NORMAL, 1.0, SYMBOLIC_VEC, 0.0, SYMBOLIC_VEC, ALWAYS_TUNE_AGGRESSIVELY);
-        oski_TuneMat(Aoski);
+        TACO_BENCH(oski_TuneMat(Aoski);,"\nOSKI tuning",1,tuningTime,false);
         char* xform = oski_GetMatTransforms (Aoski);
         int blockSize=0;
         if (xform) {
@@ -69,10 +106,10 @@ extern "C" {
           oski_Free (xform);
         }
 
-        TACO_BENCH(oski_MatMult(Aoski, OP_NORMAL, 1, xoski, 0, yoski);,"\nOSKI Tuned",repeat,timevalue,true);
+        TACO_BENCH(oski_MatMult(Aoski, OP_NORMAL, 1, xoski, 0, yoski);,"OSKI Tuned",repeat,tunedTime,true);
+        reportBreakEven("OSKI Tuned", tuningTime.mean, untunedTime, tunedTime);
 
-        // commented for now as validate doesn't account for limited floating-point precision
-        // validate("OSKI Tuned", y_oski, exprOperands.at("yRef"));
+        validate("OSKI Tuned", y_oski, exprOperands.at("yRef"), reassociationTolerance);
 
         // commented to avoid some crashes with poski
   //      oski_DestroyMat(Aoski);
@@ -110,19 +147,21 @@ extern "C" {
           TACO_BENCH(yb.assemble();,"Assemble",1,timevalue,false)
           TACO_BENCH(yb.compute();, "Compute",repeat, timevalue, true)
         }
+        if (exprOperands.count("ALower"))
+          benchOSKISymmetric(exprOperands,1.0,0.0,repeat,timevalue);
         break;
       }
       case MATTRANSMUL:
-      case RESIDUAL: {
+      case RESIDUAL:
+      case SparsitySpMV: {
         int rows=exprOperands.at("A").getDimension(0);
-        int cols=exprOperands.at("A").getDimension(1);
         oski_matrix_t Aoski;
         oski_vecview_t xoski, yoski, zoski;
         oski_Init();
 
-        tacoToOSKI(exprOperands.at("A"),Aoski);
-        tacoToOSKI(exprOperands.at("x"),xoski);
-        tacoToOSKI(exprOperands.at("z"),zoski);
+        TACO_BENCH(tacoToOSKI(exprOperands.at("A"),Aoski);
+                   tacoToOSKI(exprOperands.at("x"),xoski);
+                   tacoToOSKI(exprOperands.at("z"),zoski);,"\nOSKI conversion",1,timevalue,false);
         Tensor<double> y_oski({rows}, Dense);
         y_oski.pack();
         tacoToOSKI(y_oski,yoski);
@@ -132,32 +171,159 @@ extern "C" {
         double* yvals=((double*)(y_oski.getStorage().getValues().getData()));
         double* zvals=((double*)(exprOperands.at("z").getStorage().getValues().getData()));
 
-        if (Expr==MATTRANSMUL) {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                     oski_MatMult(Aoski, OP_TRANS, alpha, xoski, beta, yoski);,"\nOSKI",repeat,timevalue,true); }
-        else {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                     oski_MatMult(Aoski, OP_NORMAL, -1.0, xoski, 1.0, yoski);,"\nOSKI",repeat,timevalue,true); }
+        // RESIDUAL is given as alpha=-1 and beta=1
+        oski_matop_t op = (Expr==MATTRANSMUL) ? OP_TRANS : OP_NORMAL;
+
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];},
+                   oski_MatMult(Aoski, op, alpha, xoski, beta, yoski);,"OSKI",repeat,untunedTime,true);
 
         validate("OSKI", y_oski, exprOperands.at("yRef"));
 
         // Tuned version
-        if (Expr==MATTRANSMUL) {
-          oski_SetHintMatMult(Aoski, OP_TRANS, alpha, SYMBOLIC_VEC, beta, SYMBOLIC_VEC, ALWAYS_TUNE_AGGRESSIVELY); }
-        else {
-          oski_SetHintMatMult(Aoski, OP_NORMAL, -1.0, SYMBOLIC_VEC, 1.0, SYMBOLIC_VEC, ALWAYS_TUNE_AGGRESSIVELY); }
-        oski_TuneMat(Aoski);
-
-        if (Expr==MATTRANSMUL) {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                     oski_MatMult(Aoski, OP_TRANS, alpha, xoski, beta, yoski);,"\nOSKI Tuned",repeat,timevalue,true); }
-        else {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                     oski_MatMult(Aoski, OP_NORMAL, -1.0, xoski, 1.0, yoski);,"\nOSKI Tuned",repeat,timevalue,true); }
-
-        // commented for now as validate doesn't account for limited floating-point precision
-        // validate("OSKI Tuned", y_oski, exprOperands.at("yRef"));
+        oski_SetHintMatMult(Aoski, op, alpha, SYMBOLIC_VEC, beta, SYMBOLIC_VEC, ALWAYS_TUNE_AGGRESSIVELY);
+        TACO_BENCH(oski_TuneMat(Aoski);,"\nOSKI tuning",1,tuningTime,false);
+
+        TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];},
+                   oski_MatMult(Aoski, op, alpha, xoski, beta, yoski);,"OSKI Tuned",repeat,tunedTime,true);
+        reportBreakEven("OSKI Tuned", tuningTime.mean, untunedTime, tunedTime);
+
+        validate("OSKI Tuned", y_oski, exprOperands.at("yRef"), reassociationTolerance);
+
+        // A^T = A for MATTRANSMUL
+        if (exprOperands.count("ALower"))
+          benchOSKISymmetric(exprOperands,alpha,beta,repeat,timevalue);
+        break;
+      }
+      case SparsitySpMDM: {
+        // B and C are row-major multivectors
+        int rows=exprOperands.at("CRef").getDimension(0);
+        int cols=exprOperands.at("CRef").getDimension(1);
+        int Ksize=exprOperands.at("A").getDimension(1);
+        oski_matrix_t Aoski;
+        oski_vecview_t Boski, Coski;
+        oski_Init();
+
+        TACO_BENCH(tacoToOSKI(exprOperands.at("A"),Aoski);
+                   Boski = oski_CreateMultiVecView((double*)(exprOperands.at("B").getStorage().getValues().getData()),
+                                                   Ksize, cols, LAYOUT_ROWMAJ, cols);,"\nOSKI conversion",1,timevalue,false);
+        vector<double> C((size_t)rows*cols);
+        Coski = oski_CreateMultiVecView(C.data(), rows, cols, LAYOUT_ROWMAJ, cols);
+
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH(oski_MatMult(Aoski, OP_NORMAL, 1, Boski, 0, Coski);,"OSKI",repeat,untunedTime,true);
 
+        Tensor<double> C_oski({rows,cols}, Format({Dense,Dense}));
+        for (int i=0; i<rows; i++)
+          for (int j=0; j<cols; j++)
+            C_oski.insert({i,j}, C[(size_t)i*cols+j]);
+        C_oski.pack();
+        validate("OSKI", C_oski, exprOperands.at("CRef"), reassociationTolerance);
+
+        oski_SetHintMatMult(Aoski, OP_NORMAL, 1.0, SYMBOLIC_MULTIVEC, 0.0, SYMBOLIC_MULTIVEC, ALWAYS_TUNE_AGGRESSIVELY);
+        TACO_BENCH(oski_TuneMat(Aoski);,"\nOSKI tuning",1,tuningTime,false);
+        TACO_BENCH(oski_MatMult(Aoski, OP_NORMAL, 1, Boski, 0, Coski);,"OSKI Tuned",repeat,tunedTime,true);
+        reportBreakEven("OSKI Tuned", tuningTime.mean, untunedTime, tunedTime);
+        break;
+      }
+      case MULTANDTRANS: {
+        int rows=exprOperands.at("A").getDimension(0);
+        int cols=exprOperands.at("A").getDimension(1);
+        oski_matrix_t Aoski;
+        oski_vecview_t xoski, woski, yoski, toski;
+        oski_Init();
+
+        TACO_BENCH(tacoToOSKI(exprOperands.at("A"),Aoski);
+                   tacoToOSKI(exprOperands.at("x"),xoski);
+                   tacoToOSKI(exprOperands.at("w"),woski);,"\nOSKI conversion",1,timevalue,false);
+        Tensor<double> y_oski({rows}, Dense);
+        Tensor<double> t_oski({cols}, Dense);
+        y_oski.pack();
+        t_oski.pack();
+        tacoToOSKI(y_oski,yoski);
+        tacoToOSKI(t_oski,toski);
+
+        taco::util::TimeResults separateTime, untunedTime, tuningTime, tunedTime;
+        TACO_BENCH(oski_MatMult(Aoski, OP_NORMAL, 1, xoski, 0, yoski);
+                   oski_MatMult(Aoski, OP_TRANS, 1, woski, 0, toski);,"OSKI two SpMVs",repeat,separateTime,true);
+        TACO_BENCH(oski_MatMultAndMatTransMult(Aoski, 1, xoski, 0, yoski, OP_TRANS, 1, woski, 0, toski);,
+                   "OSKI fused",repeat,untunedTime,true);
+
+        validate("OSKI fused y", y_oski, exprOperands.at("yRef"), reassociationTolerance);
+        validate("OSKI fused t", t_oski, exprOperands.at("tRef"), reassociationTolerance);
+
+        oski_SetHintMatMultAndMatTransMult(Aoski, 1.0, SYMBOLIC_VEC, 0.0, SYMBOLIC_VEC,
+                                           OP_TRANS, 1.0, SYMBOLIC_VEC, 0.0, SYMBOLIC_VEC, ALWAYS_TUNE_AGGRESSIVELY);
+        TACO_BENCH(oski_TuneMat(Aoski);,"\nOSKI tuning",1,tuningTime,false);
+        TACO_BENCH(oski_MatMultAndMatTransMult(Aoski, 1, xoski, 0, yoski, OP_TRANS, 1, woski, 0, toski);,
+                   "OSKI fused Tuned",repeat,tunedTime,true);
+        reportBreakEven("OSKI fused Tuned", tuningTime.mean, untunedTime, tunedTime);
+        break;
+      }
+      case MATPOW: {
+        int rows=exprOperands.at("A").getDimension(0);
+        oski_matrix_t Aoski;
+        oski_vecview_t xoski, yoski, workoski;
+        oski_Init();
+
+        TACO_BENCH(tacoToOSKI(exprOperands.at("A"),Aoski);
+                   tacoToOSKI(exprOperands.at("x"),xoski);,"\nOSKI conversion",1,timevalue,false);
+        vector<double> y(rows), work(rows);
+        yoski = oski_CreateVecView(y.data(), rows, STRIDE_UNIT);
+        workoski = oski_CreateVecView(work.data(), rows, STRIDE_UNIT);
+
+        // k SpMVs ping-ponging between y and work against oski_MatPowMult
+        taco::util::TimeResults naiveTime, untunedTime, tuningTime, tunedTime;
+        TACO_BENCH(for (int l=1; l<=power; l++)
+                     oski_MatMult(Aoski, OP_NORMAL, 1, (l==1) ? xoski : (((power-l)%2) ? yoski : workoski),
+                                  0, ((power-l)%2) ? workoski : yoski);,"OSKI naive",repeat,naiveTime,true);
+        cout << "OSKI naive time per power (ms)" << endl << naiveTime.mean/power << endl;
+        Tensor<double> y_naive({rows}, Dense);
+        VectorTotaco(y,y_naive);
+        validate("OSKI naive", y_naive, exprOperands.at("yRef"), reassociationTolerance);
+
+        TACO_BENCH(oski_MatPowMult(Aoski, OP_NORMAL, power, 1, xoski, 0, yoski, INVALID_VEC);,
+                   "OSKI MatPowMult",repeat,untunedTime,true);
+        cout << "OSKI MatPowMult time per power (ms)" << endl << untunedTime.mean/power << endl;
+        Tensor<double> y_oski({rows}, Dense);
+        VectorTotaco(y,y_oski);
+        validate("OSKI MatPowMult", y_oski, exprOperands.at("yRef"), reassociationTolerance);
+
+        oski_SetHintMatPowMult(Aoski, OP_NORMAL, power, 1.0, SYMBOLIC_VEC, 0.0, SYMBOLIC_VEC, ALWAYS_TUNE_AGGRESSIVELY);
+        TACO_BENCH(oski_TuneMat(Aoski);,"\nOSKI tuning",1,tuningTime,false);
+        TACO_BENCH(oski_MatPowMult(Aoski, OP_NORMAL, power, 1, xoski, 0, yoski, INVALID_VEC);,
+                   "OSKI MatPowMult Tuned",repeat,tunedTime,true);
+        reportBreakEven("OSKI MatPowMult Tuned", tuningTime.mean, untunedTime, tunedTime);
+        break;
+      }
+      case BatchSpMV: {
+        int problems=batchSize(exprOperands,"A");
+        oski_Init();
+
+        // the block-diagonal problem is stored last
+        vector<oski_matrix_t> Aoski(problems+1);
+        vector<oski_vecview_t> xoski(problems+1), yoski(problems+1);
+        vector<Tensor<double>> y_oski;
+        for (int k=0; k<=problems; k++) {
+          string id = (k<problems) ? to_string(k) : "";
+          tacoToOSKI(exprOperands.at("A"+id),Aoski[k]);
+          tacoToOSKI(exprOperands.at("x"+id),xoski[k]);
+          y_oski.push_back(Tensor<double>({exprOperands.at("A"+id).getDimension(0)}, Dense));
+          y_oski[k].pack();
+          tacoToOSKI(y_oski[k],yoski[k]);
+        }
+
+        taco::util::TimeResults backToBack, blockDiagonal;
+        TACO_BENCH(for (int k=0; k<problems; k++) oski_MatMult(Aoski[k], OP_NORMAL, 1, xoski[k], 0, yoski[k]);,
+                   "\nOSKI back-to-back",repeat,backToBack,true);
+        TACO_BENCH(oski_MatMult(Aoski[problems], OP_NORMAL, 1, xoski[problems], 0, yoski[problems]);,
+                   "OSKI block-diagonal",repeat,blockDiagonal,true);
+        reportBatch("OSKI",problems,backToBack,blockDiagonal);
+
+        for (int k=0; k<problems; k++)
+          validate("OSKI back-to-back "+to_string(k), y_oski[k], exprOperands.at("yRef"+to_string(k)),
+                   reassociationTolerance);
+        validate("OSKI block-diagonal", y_oski[problems], exprOperands.at("yRef"), reassociationTolerance);
         break;
       }
       default:
@@ -166,4 +332,11 @@ extern "C" {
     }
   }
 
+  static ProductRegistration oskiRegistration("OSKI",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV,SparsitySpMDM,BatchSpMV,MULTANDTRANS,
+       MATPOW},
+      false, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToOSKI(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters));
+      });
+
 #endif
@@ -0,0 +1,230 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <chrono>
+
+// Row partitions of a CSR matrix for threaded SpMV. Thread t starts at the
+// nonzero nnzStart[t] of row rowStart[t], with
+// pos[rowStart[t]] <= nnzStart[t] <= pos[rowStart[t]+1]. It completes the rows
+// rowStart[t]..rowStart[t+1]-1 and adds the head of row rowStart[t+1] it
+// computed to y after all the threads are done, so that a row split across
+// threads is merged without atomics.
+//   rows:   same number of rows per thread, as schedule(static)
+//   nnz:    same number of nonzeros per thread, splitting between rows
+//   merge:  same number of rows plus nonzeros per thread (merge path)
+//   hybrid: nnz, but rows longer than a thread share are split across threads
+
+struct RowPartition {
+  string strategy;
+  vector<int> rowStart;
+  vector<int> nnzStart;
+  mutable vector<double> carry;  // head of row rowStart[t+1], set by partitionedSpMV
+
+  int threads() const { return (int)rowStart.size()-1; }
+};
+
+const vector<string> partitionStrategies={"rows","nnz","merge","hybrid"};
+
+  bool isPartitionStrategy(string strategy) {
+    return std::find(partitionStrategies.begin(),partitionStrategies.end(),strategy)
+           !=partitionStrategies.end();
+  }
+
+  void partitionRows(int rows, const int* pos, int threads, RowPartition& partition) {
+    for (int t=0; t<=threads; t++) {
+      int row=(int)((long)t*rows/threads);
+      partition.rowStart.push_back(row);
+      partition.nnzStart.push_back(pos[row]);
+    }
+  }
+
+  // Cut at the row boundary nearest to t*nnz/threads, or right at it when the
+  // row it falls in is longer than a thread share and splitLongRows is set
+  void partitionNnz(int rows, const int* pos, int threads, bool splitLongRows,
+                    RowPartition& partition) {
+    long nnz=pos[rows];
+    long share=(nnz+threads-1)/threads;
+    for (int t=0; t<=threads; t++) {
+      int target=(int)(nnz*t/threads);
+      int row=(int)(std::upper_bound(pos,pos+rows+1,target)-pos)-1;
+      if (t==0) {
+        partition.rowStart.push_back(0);
+        partition.nnzStart.push_back(0);
+      }
+      else if (t==threads || row>=rows) {
+        partition.rowStart.push_back(rows);
+        partition.nnzStart.push_back(pos[rows]);
+      }
+      else if (splitLongRows && pos[row+1]-pos[row] > share) {
+        partition.rowStart.push_back(row);
+        partition.nnzStart.push_back(target);
+      }
+      else {
+        if (pos[row+1]-target < target-pos[row])
+          row++;
+        partition.rowStart.push_back(row);
+        partition.nnzStart.push_back(pos[row]);
+      }
+    }
+  }
+
+  // Split the merge of the row ends pos[1..rows] with the nonzeros 0..nnz-1
+  // in equal diagonals, as in Merrill and Garland's merge-based SpMV
+  void partitionMergePath(int rows, const int* pos, int threads, RowPartition& partition) {
+    long nnz=pos[rows];
+    long length=rows+nnz;
+    for (int t=0; t<=threads; t++) {
+      long diagonal=min(length*t/threads,length);
+      long low=max(diagonal-nnz,0L);
+      long high=min(diagonal,(long)rows);
+      while (low < high) {
+        long pivot=(low+high)/2;
+        if (pos[pivot+1] <= diagonal-pivot-1)
+          low=pivot+1;
+        else
+          high=pivot;
+      }
+      partition.rowStart.push_back((int)low);
+      partition.nnzStart.push_back((int)(diagonal-low));
+    }
+  }
+
+  RowPartition partitionCSR(string strategy, int rows, const int* pos, int threads) {
+    RowPartition partition;
+    partition.strategy=strategy;
+    if (strategy=="nnz")
+      partitionNnz(rows,pos,threads,false,partition);
+    else if (strategy=="hybrid")
+      partitionNnz(rows,pos,threads,true,partition);
+    else if (strategy=="merge")
+      partitionMergePath(rows,pos,threads,partition);
+    else
+      partitionRows(rows,pos,threads,partition);
+    partition.carry.assign(threads,0.0);
+    return partition;
+  }
+
+  // y = alpha*A*x + beta*z over a partition, z is not read when beta is zero.
+  // threadTimes, when given, gets the time (ms) each thread computed for.
+  template<typename V, typename T>
+  void partitionedSpMV(const RowPartition& partition, const int* pos, const int* crd, const V* vals,
+                       const T* x, T alpha, T beta, const T* z, T* y, double* threadTimes=NULL) {
+    int threads=partition.threads();
+    double* carry=partition.carry.data();
+    #pragma omp parallel for schedule(static,1) num_threads(threads)
+    for (int t=0; t<threads; t++) {
+      auto begin=std::chrono::steady_clock::now();
+      int first=partition.nnzStart[t];
+      int last=partition.nnzStart[t+1];
+      int endRow=partition.rowStart[t+1];
+      for (int i=partition.rowStart[t]; i<endRow; i++) {
+        T sum=0;
+        for (int p=max(pos[i],first); p<pos[i+1]; p++)
+          sum+=(T)vals[p]*x[crd[p]];
+        y[i]=(beta == T(0)) ? alpha*sum : alpha*sum+beta*z[i];
+      }
+      T sum=0;
+      for (int p=max(pos[endRow],first); p<last; p++)
+        sum+=(T)vals[p]*x[crd[p]];
+      carry[t]=sum;
+      if (threadTimes)
+        threadTimes[t]=std::chrono::duration<double,std::milli>(
+            std::chrono::steady_clock::now()-begin).count();
+    }
+    for (int t=0; t<threads; t++) {
+      if (carry[t] != 0.0)
+        y[partition.rowStart[t+1]]+=alpha*(T)carry[t];
+    }
+  }
+
+  // Work of the most loaded thread over the average, in nonzeros assigned and
+  // in time measured
+  void reportImbalance(string name, const RowPartition& partition, const vector<double>& threadTimes) {
+    int threads=partition.threads();
+    long nnz=partition.nnzStart.back()-partition.nnzStart.front();
+    long maxNnz=0;
+    double maxTime=0.0;
+    double totalTime=0.0;
+    for (int t=0; t<threads; t++) {
+      maxNnz=max(maxNnz,(long)(partition.nnzStart[t+1]-partition.nnzStart[t]));
+      maxTime=max(maxTime,threadTimes[t]);
+      totalTime+=threadTimes[t];
+    }
+    cout << name << " load imbalance on " << threads << " threads (max/mean): nnz "
+         << (nnz ? (double)maxNnz*threads/nnz : 1.0) << ", time "
+         << (totalTime>0 ? maxTime*threads/totalTime : 1.0) << endl;
+  }
+
+  // Time SpMV with a partition, then report the imbalance of one more run
+  template<typename V, typename T>
+  void benchPartitionedSpMV(string name, const RowPartition& partition, const int* pos,
+                            const int* crd, const V* vals, const T* x, T alpha, T beta,
+                            const T* z, T* y, int repeat, taco::util::TimeResults& timevalue) {
+    TACO_BENCH(partitionedSpMV(partition,pos,crd,vals,x,alpha,beta,z,y);,
+               name,repeat,timevalue,true)
+    vector<double> threadTimes(partition.threads());
+    partitionedSpMV(partition,pos,crd,vals,x,alpha,beta,z,y,threadTimes.data());
+    reportImbalance(name,partition,threadTimes);
+  }
+
+  void exprToPartitioned(BenchExpr Expr, const OperandStore& exprOperands,int repeat,
+                         taco::util::TimeResults timevalue, string strategy) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        // A^T is computed as the CSR matrix given by the CSC arrays of A
+        bool transposed = (Expr==MATTRANSMUL);
+        const Tensor<double>& A=exprOperands.at("A");
+        int rows=A.getDimension(transposed ? 1 : 0);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        if (transposed)
+          getCSCArrays(exprOperands.csc("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        else
+          getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+
+        double alpha=1.0;
+        double beta=0.0;
+        vector<double> x, z, y(rows);
+        tacoToVector(exprOperands.at("x"),x);
+        if (hasAlphaBeta(Expr)) {
+          alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          tacoToVector(exprOperands.at("z"),z);
+        }
+
+        bool first=true;
+        for (string s : partitionStrategies) {
+          if (strategy!="all" && strategy!=s)
+            continue;
+          string name="PARTITIONED "+s;
+          RowPartition partition;
+          TACO_BENCH(partition=partitionCSR(s,rows,ia_CSR,benchThreads());,
+                     (first ? "\n" : "")+name+" partitioning",1,timevalue,false)
+          first=false;
+          benchPartitionedSpMV(name,partition,ia_CSR,ja_CSR,a_CSR,x.data(),alpha,beta,z.data(),
+                               y.data(),repeat,timevalue);
+          Tensor<double> y_partitioned({rows}, Dense);
+          VectorTotaco(y,y_partitioned);
+          validate(name, y_partitioned, exprOperands.at("yRef"), reassociationTolerance);
+        }
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for PARTITIONED" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration partitionedRegistration("PARTITIONED",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToPartitioned(run.expr,run.operands,run.repeat,timevalue,
+                          run.parameters.count("partition") ? run.parameters.at("partition") : "all");
+      });
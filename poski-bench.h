@@ -8,17 +8,12 @@ extern "C" {
 #include <poski/poski.h>
 }
 
-  void tacoToPOSKI(const Tensor<double>& src, poski_mat_t& dst, bool transpose = false) {
-    int rows=src.getDimension(0);
-    int cols=src.getDimension(1);
-    // convert to CSR
-    Tensor<double> ACSR({rows,cols}, CSR);
-    for (auto& value : iterate<double>(src)) {
-      int i = transpose ? value.first.at(1) : value.first.at(0);
-      int j = transpose ? value.first.at(0) : value.first.at(1);
-      ACSR.insert({i,j},value.second);
-    }
-    ACSR.pack();
+  // pOSKI copies the CSR arrays it is given (COPY_INPUTMAT), so the shared
+  // CSR view of the operand is passed as is. Unless partitioned, pOSKI splits
+  // the rows evenly between its threads.
+  void tacoToPOSKI(const Tensor<double>& ACSR, poski_mat_t& dst, bool partitioned=false) {
+    int rows=ACSR.getDimension(0);
+    int cols=ACSR.getDimension(1);
     double *a_CSR;
     int* ia_CSR;
     int* ja_CSR;
@@ -26,8 +21,11 @@ extern "C" {
 
     // default thread object
     poski_threadarg_t *poski_thread = poski_InitThreads();
-    poski_ThreadHints(poski_thread, NULL, POSKI_OPENMP, 12);
+    const int threads=12;
+    poski_ThreadHints(poski_thread, NULL, POSKI_OPENMP, threads);
     poski_partitionarg_t *mat_partition = NULL;
+    if (partitioned)
+      mat_partition = poski_partitionMatHints(OneD, threads, KERNEL_MatMult, OP_NORMAL);
 
     // create CSR matrix
      dst = poski_CreateMatCSR(ia_CSR, ja_CSR, a_CSR,
@@ -42,9 +40,11 @@ extern "C" {
                           cols, STRIDE_UNIT, NULL);
   }
 
-  void exprToPOSKI(BenchExpr Expr, map<string,Tensor<double>> exprOperands,int repeat, taco::util::TimeResults timevalue) {
+  void exprToPOSKI(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                   bool partitioned, int power) {
     switch(Expr) {
-      case SpMV: {
+      case SpMV:
+      case SparsityTTV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
 
@@ -61,25 +61,26 @@ extern "C" {
         poski_Init();
 
         poski_mat_t A_tunable;
-        tacoToPOSKI(exprOperands.at("A"),A_tunable);
+        TACO_BENCH(tacoToPOSKI(exprOperands.csr("A"),A_tunable,partitioned);,"\nPOSKI conversion",1,timevalue,false);
         Tensor<double> y_poski({rows}, Dense);
         y_poski.pack();
         poski_vec_t xposki_view, yposki_view;
         tacoToPOSKI(y_poski,yposki_view);
         xposki_view = poski_CreateVec((double*)(xposki.getStorage().getValues().getData()), cols, STRIDE_UNIT, NULL);
 
-        TACO_BENCH(poski_MatMult(A_tunable, OP_NORMAL, 1, xposki_view, 0, yposki_view);,"\nPOSKI",repeat,timevalue,true)
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH(poski_MatMult(A_tunable, OP_NORMAL, 1, xposki_view, 0, yposki_view);,"POSKI",repeat,untunedTime,true)
 
         validate("POSKI", y_poski, exprOperands.at("yRef"));
 
         // tune
         poski_TuneHint_MatMult(A_tunable, OP_NORMAL, 1, xposki_view, 0, yposki_view, ALWAYS_TUNE_AGGRESSIVELY);
-        poski_TuneMat(A_tunable);
+        TACO_BENCH(poski_TuneMat(A_tunable);,"\nPOSKI tuning",1,tuningTime,false);
 
-        TACO_BENCH(poski_MatMult(A_tunable, OP_NORMAL, 1, xposki_view, 0, yposki_view);,"\nPOSKI Tuned",repeat,timevalue,true);
+        TACO_BENCH(poski_MatMult(A_tunable, OP_NORMAL, 1, xposki_view, 0, yposki_view);,"POSKI Tuned",repeat,tunedTime,true);
+        reportBreakEven("POSKI Tuned", tuningTime.mean, untunedTime, tunedTime);
 
-        // commented for now as validate doesn't account for limited floating-point precision
-        // validate("POSKI Tuned", y_poski, exprOperands.at("yRef"));
+        validate("POSKI Tuned", y_poski, exprOperands.at("yRef"), reassociationTolerance);
 
         // deallocate everything -- commented because of some crashes
     //    poski_DestroyMat(A_tunable);
@@ -90,7 +91,8 @@ extern "C" {
         break;
       }
       case MATTRANSMUL:
-      case RESIDUAL: {
+      case RESIDUAL:
+      case SparsitySpMV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
 
@@ -106,7 +108,7 @@ extern "C" {
         poski_Init();
 
         poski_mat_t A_tunable;
-        tacoToPOSKI(exprOperands.at("A"),A_tunable,Expr==MATTRANSMUL);
+        TACO_BENCH(tacoToPOSKI(Expr==MATTRANSMUL ? exprOperands.transposed("A") : exprOperands.csr("A"),A_tunable,partitioned);,"\nPOSKI conversion",1,timevalue,false);
         Tensor<double> y_poski({rows}, Dense);
         y_poski.pack();
         poski_vec_t xposki_view, yposki_view, zposki_view;
@@ -119,31 +121,22 @@ extern "C" {
         double* yvals=((double*)(y_poski.getStorage().getValues().getData()));
         double* zvals=((double*)(exprOperands.at("z").getStorage().getValues().getData()));
 
-        if (Expr==MATTRANSMUL) {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                     poski_MatMult(A_tunable, OP_NORMAL, alpha, xposki_view, beta, yposki_view);,"\nPOSKI",repeat,timevalue,true) }
-        else {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                     poski_MatMult(A_tunable, OP_NORMAL, -1.0, xposki_view, 1.0, yposki_view);,"\nPOSKI",repeat,timevalue,true) }
+        // A^T is converted for MATTRANSMUL, RESIDUAL is given as alpha=-1 and beta=1
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];},
+                   poski_MatMult(A_tunable, OP_NORMAL, alpha, xposki_view, beta, yposki_view);,"POSKI",repeat,untunedTime,true)
 
         validate("POSKI", y_poski, exprOperands.at("yRef"));
 
         // tune
-        if (Expr==MATTRANSMUL) {
-          poski_TuneHint_MatMult(A_tunable, OP_NORMAL, alpha, xposki_view, beta, yposki_view, ALWAYS_TUNE_AGGRESSIVELY); }
-        else {
-          poski_TuneHint_MatMult(A_tunable, OP_NORMAL, -1.0, xposki_view, 1.0, yposki_view, ALWAYS_TUNE_AGGRESSIVELY); }
-        poski_TuneMat(A_tunable);
-
-        if (Expr==MATTRANSMUL) {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                     poski_MatMult(A_tunable, OP_NORMAL, alpha, xposki_view, beta, yposki_view);,"\nPOSKI Tuned",repeat,timevalue,true); }
-        else {
-          TACO_BENCH(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];} ;
-                      poski_MatMult(A_tunable, OP_NORMAL, -1.0, xposki_view, 1.0, yposki_view);,"\nPOSKI Tuned",repeat,timevalue,true) }
-
-        // commented for now as validate doesn't account for limited floating-point precision
-        // validate("POSKI Tuned", y_poski, exprOperands.at("yRef"));
+        poski_TuneHint_MatMult(A_tunable, OP_NORMAL, alpha, xposki_view, beta, yposki_view, ALWAYS_TUNE_AGGRESSIVELY);
+        TACO_BENCH(poski_TuneMat(A_tunable);,"\nPOSKI tuning",1,tuningTime,false);
+
+        TACO_BENCH_SETUP(for (auto k=0; k<rows; k++) {yvals[k]=zvals[k];},
+                   poski_MatMult(A_tunable, OP_NORMAL, alpha, xposki_view, beta, yposki_view);,"POSKI Tuned",repeat,tunedTime,true);
+        reportBreakEven("POSKI Tuned", tuningTime.mean, untunedTime, tunedTime);
+
+        validate("POSKI Tuned", y_poski, exprOperands.at("yRef"), reassociationTolerance);
 
         // deallocate everything -- commented because of some crashes
     //    poski_DestroyMat(A_tunable);
@@ -153,10 +146,87 @@ extern "C" {
     //    poski_Close();
         break;
       }
+      case SparsitySpMDM: {
+        // pOSKI has no multivectors: one SpMV per column of the row-major B
+        // and C, seen as vectors of stride cols
+        int rows=exprOperands.at("CRef").getDimension(0);
+        int cols=exprOperands.at("CRef").getDimension(1);
+        int Ksize=exprOperands.at("A").getDimension(1);
+        double* Bvals=(double*)(exprOperands.at("B").getStorage().getValues().getData());
+        vector<double> C((size_t)rows*cols);
+        poski_Init();
+
+        poski_mat_t A_tunable;
+        vector<poski_vec_t> Bposki_view(cols), Cposki_view(cols);
+        TACO_BENCH(tacoToPOSKI(exprOperands.csr("A"),A_tunable,partitioned);
+                   for (int j=0; j<cols; j++) {
+                     Bposki_view[j] = poski_CreateVec(Bvals+j, Ksize, cols, NULL);
+                     Cposki_view[j] = poski_CreateVec(C.data()+j, rows, cols, NULL);
+                   },"\nPOSKI conversion",1,timevalue,false);
+
+        TACO_BENCH(for (int j=0; j<cols; j++) poski_MatMult(A_tunable, OP_NORMAL, 1, Bposki_view[j], 0, Cposki_view[j]);,
+                   "POSKI",repeat,timevalue,true);
+
+        Tensor<double> C_poski({rows,cols}, Format({Dense,Dense}));
+        for (int i=0; i<rows; i++)
+          for (int j=0; j<cols; j++)
+            C_poski.insert({i,j}, C[(size_t)i*cols+j]);
+        C_poski.pack();
+        validate("POSKI", C_poski, exprOperands.at("CRef"), reassociationTolerance);
+        break;
+      }
+      case MATPOW: {
+        // k SpMVs ping-ponging between y and work, as pOSKI has no matrix
+        // powers kernel. Both vectors get the extras that let pOSKI tune.
+        int rows=exprOperands.at("A").getDimension(0);
+        int extra = 0;
+        if (rows%8)
+          extra = 8-rows%8;
+        vector<double> x(rows+extra), y(rows+extra), work(rows+extra);
+        for (auto& value : iterate<double>(exprOperands.at("x")))
+          x[value.first[0]] = value.second;
+
+        poski_Init();
+
+        poski_mat_t A_tunable;
+        TACO_BENCH(tacoToPOSKI(exprOperands.csr("A"),A_tunable,partitioned);,"\nPOSKI conversion",1,timevalue,false);
+        poski_vec_t xposki_view = poski_CreateVec(x.data(), rows, STRIDE_UNIT, NULL);
+        poski_vec_t yposki_view = poski_CreateVec(y.data(), rows, STRIDE_UNIT, NULL);
+        poski_vec_t workposki_view = poski_CreateVec(work.data(), rows, STRIDE_UNIT, NULL);
+
+        taco::util::TimeResults untunedTime, tuningTime, tunedTime;
+        TACO_BENCH(for (int l=1; l<=power; l++)
+                     poski_MatMult(A_tunable, OP_NORMAL, 1, (l==1) ? xposki_view : (((power-l)%2) ? yposki_view : workposki_view),
+                                   0, ((power-l)%2) ? workposki_view : yposki_view);,"POSKI",repeat,untunedTime,true);
+        cout << "POSKI time per power (ms)" << endl << untunedTime.mean/power << endl;
+        Tensor<double> y_poski({rows}, Dense);
+        VectorTotaco(y,y_poski);
+        validate("POSKI", y_poski, exprOperands.at("yRef"), reassociationTolerance);
+
+        poski_TuneHint_MatMult(A_tunable, OP_NORMAL, 1, xposki_view, 0, yposki_view, ALWAYS_TUNE_AGGRESSIVELY);
+        TACO_BENCH(poski_TuneMat(A_tunable);,"\nPOSKI tuning",1,tuningTime,false);
+        TACO_BENCH(for (int l=1; l<=power; l++)
+                     poski_MatMult(A_tunable, OP_NORMAL, 1, (l==1) ? xposki_view : (((power-l)%2) ? yposki_view : workposki_view),
+                                   0, ((power-l)%2) ? workposki_view : yposki_view);,"POSKI Tuned",repeat,tunedTime,true);
+        reportBreakEven("POSKI Tuned", tuningTime.mean, untunedTime, tunedTime);
+        Tensor<double> y_poskiTuned({rows}, Dense);
+        VectorTotaco(y,y_poskiTuned);
+        validate("POSKI Tuned", y_poskiTuned, exprOperands.at("yRef"), reassociationTolerance);
+        break;
+      }
       default:
         cout << " !! Expression not implemented for POSKI" << endl;
         break;
     }
   }
 
+  static ProductRegistration poskiRegistration("POSKI",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV,SparsitySpMDM,MATPOW},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        // -partition other than rows asks pOSKI for its nnz-balanced partitions
+        exprToPOSKI(run.expr,run.operands,run.repeat,timevalue,
+                    run.parameters.count("partition") && run.parameters.at("partition")!="rows",
+                    matrixPower(run.parameters));
+      });
+
 #endif
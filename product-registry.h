@@ -0,0 +1,117 @@
+// Product plugin API, included by taco-bench and by the translation units
+// of shared objects loaded with -load, so it only holds inline definitions
+#ifndef TACO_BENCH_PRODUCT_REGISTRY_H
+#define TACO_BENCH_PRODUCT_REGISTRY_H
+
+#include "taco/tensor.h"
+#include "taco/util/timers.h"
+#include "operand-store.h"
+
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+using namespace taco;
+using namespace std;
+
+// Enum of possible expressions to Benchmark
+enum BenchExpr {SpMV, PLUS3, MATTRANSMUL, RESIDUAL, SDDMM, SparsitySpMV, SparsityTTV, SparsitySpMDM, SpTRSV,
+                BatchSpMV, BatchSDDMM, MULTANDTRANS, MATPOW};
+static const char* const benchExprNames[]={"SpMV", "PLUS3", "MATTRANSMUL", "RESIDUAL", "SDDMM", "SparsitySpMV",
+                                           "SparsityTTV", "SparsitySpMDM", "SpTRSV", "BatchSpMV",
+                                           "BatchSDDMM", "MULTANDTRANS", "MATPOW"};
+
+// Precision of the values (and accumulation) used by the products
+enum Precision {F64, F32, Mixed};
+
+// One run of a product on the operands of an expression. The hooks of the
+// product keep their own data (converted operands, handles) in state and
+// store the result in result, with hasResult set, to have it validated.
+struct ProductRun {
+  BenchExpr expr;
+  const OperandStore& operands;
+  Precision precision;
+  int repeat;
+  int threads;
+  map<string,string> parameters;
+  void* state;
+  bool hasResult;
+  Tensor<double> result;
+
+  ProductRun(BenchExpr expr, const OperandStore& operands, Precision precision,
+             int repeat, int threads, const map<string,string>& parameters)
+      : expr(expr), operands(operands), precision(precision), repeat(repeat),
+        threads(threads), parameters(parameters), state(NULL), hasResult(false) {}
+};
+
+typedef function<void(ProductRun&)> ProductHook;
+
+// A benchmarked product: the expressions it supports, whether it runs
+// multithreaded and in single precision, and its phases. taco-bench times
+// convert and setup once, run <repeat> times with a cold cache, then calls
+// teardown. Each of these phases runs once more, untimed, to measure the
+// memory it allocates, so running it again must be safe. Products timing
+// their own phases set bench instead.
+struct Product {
+  string name;
+  vector<BenchExpr> expressions;
+  bool multithreaded;
+  bool singlePrecision;
+  ProductHook convert;
+  ProductHook setup;
+  ProductHook run;
+  ProductHook teardown;
+  function<void(ProductRun&, taco::util::TimeResults)> bench;
+
+  Product(string name, vector<BenchExpr> expressions, bool multithreaded, bool singlePrecision)
+      : name(name), expressions(expressions), multithreaded(multithreaded),
+        singlePrecision(singlePrecision) {}
+
+  bool supports(BenchExpr expr) const {
+    return std::find(expressions.begin(),expressions.end(),expr)!=expressions.end();
+  }
+};
+
+// Products in the order they registered: the built-in ones first, then the
+// ones loaded from shared objects
+typedef vector<Product> ProductRegistry;
+
+inline ProductRegistry& productRegistry() {
+  static ProductRegistry registry;
+  return registry;
+}
+
+// Products are looked up by name regardless of case, as -p gives them
+inline Product* findProduct(string name) {
+  for (auto& product : productRegistry()) {
+    if (product.name.size()==name.size() &&
+        std::equal(name.begin(),name.end(),product.name.begin(),[](char a, char b) {
+          return toupper((unsigned char)a)==toupper((unsigned char)b);
+        }))
+      return &product;
+  }
+  return NULL;
+}
+
+// Register a product from a static object of its header
+struct ProductRegistration {
+  ProductRegistration(const Product& product) {
+    productRegistry().push_back(product);
+  }
+
+  ProductRegistration(string name, vector<BenchExpr> expressions, bool multithreaded,
+                      bool singlePrecision,
+                      function<void(ProductRun&, taco::util::TimeResults)> bench) {
+    Product product(name,expressions,multithreaded,singlePrecision);
+    product.bench=bench;
+    productRegistry().push_back(product);
+  }
+};
+
+// Entry point of a shared object loaded with -load=<library>: it adds its
+// products to the registry it is given. The library must be built against
+// the same taco headers and with the same compiler as taco-bench.
+extern "C" typedef void (*RegisterProductsFunction)(ProductRegistry& registry);
+#define TACO_BENCH_REGISTER_SYMBOL "registerTacoBenchProducts"
+
+#endif
@@ -0,0 +1,99 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+// Fused SDDMM A = B o (CxD) driven by the nonzeros of B: only the dot products
+// C(i,:).D(:,k) at the nonzeros (i,k) of B are computed, so the rows x cols
+// product CxD is never materialized. B is CSC, C is row-major and D is
+// column-major, so both dot product operands are contiguous.
+
+  inline void sddmmColumn(int k, const int* pos, const int* crd, const double* vals,
+                          const double* C, const double* D, int Ksize, double* A) {
+    const double* Dk=D+(size_t)k*Ksize;
+    for (int p=pos[k]; p<pos[k+1]; p++) {
+      const double* Ci=C+(size_t)crd[p]*Ksize;
+      double sum=0.0;
+      for (int j=0; j<Ksize; j++)
+        sum+=Ci[j]*Dk[j];
+      A[p]=vals[p]*sum;
+    }
+  }
+
+  void sddmmSerial(int cols, const int* pos, const int* crd, const double* vals,
+                   const double* C, const double* D, int Ksize, double* A) {
+    for (int k=0; k<cols; k++)
+      sddmmColumn(k,pos,crd,vals,C,D,Ksize,A);
+  }
+
+  // Columns of B can hold very different numbers of nonzeros, hence the
+  // dynamic schedule
+  void sddmmParallel(int cols, const int* pos, const int* crd, const double* vals,
+                     const double* C, const double* D, int Ksize, double* A) {
+    #pragma omp parallel for schedule(dynamic,64)
+    for (int k=0; k<cols; k++)
+      sddmmColumn(k,pos,crd,vals,C,D,Ksize,A);
+  }
+
+  // Pack values sharing the sparsity pattern of a CSC matrix into a taco tensor
+  void CSCValuesTotaco(int cols, const int* pos, const int* crd, const vector<double>& vals,
+                       Tensor<double>& dst) {
+    for (int k=0; k<cols; k++)
+      for (int p=pos[k]; p<pos[k+1]; p++)
+        dst.insert({crd[p],k},vals[p]);
+    dst.pack();
+  }
+
+  void exprToSDDMM(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue) {
+    switch(Expr) {
+      case SDDMM: {
+        const Tensor<double>& B=exprOperands.at("B");
+        int rows=B.getDimension(0);
+        int cols=B.getDimension(1);
+        int Ksize=exprOperands.at("C").getDimension(1);
+        double *b_CSC;
+        int* ib_CSC;
+        int* jb_CSC;
+        getCSCArrays(exprOperands.csc("B"),&ib_CSC,&jb_CSC,&b_CSC);
+        int nnz=ib_CSC[cols];
+        const double* C=(double*)(exprOperands.rowMajor("C").getStorage().getValues().getData());
+        const double* D=(double*)(exprOperands.colMajor("D").getStorage().getValues().getData());
+
+        double MB=1024.0*1024.0;
+        double operandBytes=(double)(cols+1+nnz)*sizeof(int) + (double)nnz*sizeof(double)
+                            + ((double)rows+cols)*Ksize*sizeof(double);
+        double fusedBytes=(double)nnz*sizeof(double);
+        double materializedBytes=(double)rows*cols*sizeof(double);
+        cout << endl << "SDDMM operands footprint (MB): " << operandBytes/MB << endl;
+        cout << "SDDMM fused temporaries and output (MB): " << fusedBytes/MB << endl;
+        cout << "SDDMM materialized CxD (MB): " << materializedBytes/MB << endl;
+        cout << "SDDMM materialized over fused footprint: " << materializedBytes/fusedBytes << endl;
+
+        vector<double> A(nnz);
+        benchNextPhaseOn(1);
+        TACO_BENCH(sddmmSerial(cols,ib_CSC,jb_CSC,b_CSC,C,D,Ksize,A.data());,
+                   "\nSDDMM fused serial",repeat,timevalue,true);
+        reportGFLOPS("SDDMM fused serial",(2.0*Ksize+1)*nnz,timevalue);
+        Tensor<double> A_serial({rows,cols}, CSC);
+        CSCValuesTotaco(cols,ib_CSC,jb_CSC,A,A_serial);
+        validate("SDDMM fused serial", A_serial, exprOperands.at("ARef"), reassociationTolerance);
+
+        TACO_BENCH(sddmmParallel(cols,ib_CSC,jb_CSC,b_CSC,C,D,Ksize,A.data());,
+                   "SDDMM fused parallel",repeat,timevalue,true);
+        reportGFLOPS("SDDMM fused parallel",(2.0*Ksize+1)*nnz,timevalue);
+        Tensor<double> A_parallel({rows,cols}, CSC);
+        CSCValuesTotaco(cols,ib_CSC,jb_CSC,A,A_parallel);
+        validate("SDDMM fused parallel", A_parallel, exprOperands.at("ARef"), reassociationTolerance);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for fused SDDMM" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration sddmmRegistration("SDDMM",
+      {SDDMM},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToSDDMM(run.expr,run.operands,run.repeat,timevalue);
+      });
@@ -0,0 +1,183 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// SELL-C-sigma: rows are sorted by length within windows of sigma rows, then
+// grouped in chunks of C rows (the SIMD width) padded to their longest row
+// and stored column by column, so that one SIMD lane handles one row.
+#if defined(__AVX512F__)
+const int sellC=8;
+const char sellKernel[]="AVX-512";
+#elif defined(__AVX2__) && defined(__FMA__)
+const int sellC=4;
+const char sellKernel[]="AVX2";
+#else
+const int sellC=4;
+const char sellKernel[]="scalar (build with -DNATIVE_ARCH=ON for AVX2 or AVX-512)";
+#endif
+
+struct SELL {
+  int rows;
+  int nnz;
+  int sigma;
+  vector<int> perm;       // original row of each sorted row
+  vector<int> chunkPtr;   // offset of each chunk in crd/vals
+  vector<int> chunkLen;   // padded row length of each chunk
+  vector<int> crd;
+  vector<double> vals;
+
+  int chunks() const { return (int)chunkLen.size(); }
+  // fraction of stored entries that are padding
+  double paddingOverhead() const {
+    return nnz ? (double)(vals.size()-nnz)/nnz : 0.0;
+  }
+};
+
+  void CSRToSELL(int rows, const int* pos, const int* crd, const double* vals,
+                 int sigma, SELL& dst) {
+    sigma=max(sellC,(sigma/sellC)*sellC);
+    dst.rows=rows;
+    dst.nnz=pos[rows];
+    dst.sigma=sigma;
+    dst.perm.resize(rows);
+    for (int i=0; i<rows; i++)
+      dst.perm[i]=i;
+    for (int w=0; w<rows; w+=sigma) {
+      stable_sort(dst.perm.begin()+w, dst.perm.begin()+min(rows,w+sigma),
+                   [&](int a, int b) { return pos[a+1]-pos[a] > pos[b+1]-pos[b]; });
+    }
+
+    int chunks=(rows+sellC-1)/sellC;
+    dst.chunkPtr.assign(chunks+1,0);
+    dst.chunkLen.assign(chunks,0);
+    for (int c=0; c<chunks; c++) {
+      for (int r=c*sellC; r<min(rows,(c+1)*sellC); r++) {
+        int i=dst.perm[r];
+        dst.chunkLen[c]=max(dst.chunkLen[c],pos[i+1]-pos[i]);
+      }
+      dst.chunkPtr[c+1]=dst.chunkPtr[c]+dst.chunkLen[c]*sellC;
+    }
+
+    // padding reuses column 0 with a zero value so gathers stay in bounds
+    dst.crd.assign(dst.chunkPtr[chunks],0);
+    dst.vals.assign(dst.chunkPtr[chunks],0.0);
+    #pragma omp parallel for schedule(static)
+    for (int c=0; c<chunks; c++) {
+      for (int r=c*sellC; r<min(rows,(c+1)*sellC); r++) {
+        int i=dst.perm[r];
+        int lane=r-c*sellC;
+        for (int k=0; k<pos[i+1]-pos[i]; k++) {
+          dst.crd[dst.chunkPtr[c]+k*sellC+lane]=crd[pos[i]+k];
+          dst.vals[dst.chunkPtr[c]+k*sellC+lane]=vals[pos[i]+k];
+        }
+      }
+    }
+  }
+
+  // y = alpha*A*x + beta*z, z is not read when beta is zero
+  void sellSpMV(const SELL& A, const double* x, double alpha, double beta,
+                const double* z, double* y) {
+    const int* crd=A.crd.data();
+    const double* vals=A.vals.data();
+    #pragma omp parallel for schedule(static)
+    for (int c=0; c<A.chunks(); c++) {
+      double sum[sellC];
+      const int* ccrd=crd+A.chunkPtr[c];
+      const double* cvals=vals+A.chunkPtr[c];
+#if defined(__AVX512F__)
+      __m512d acc=_mm512_setzero_pd();
+      for (int k=0; k<A.chunkLen[c]; k++) {
+        __m256i idx=_mm256_loadu_si256((const __m256i*)(ccrd+k*sellC));
+        acc=_mm512_fmadd_pd(_mm512_loadu_pd(cvals+k*sellC),_mm512_i32gather_pd(idx,x,8),acc);
+      }
+      _mm512_storeu_pd(sum,acc);
+#elif defined(__AVX2__) && defined(__FMA__)
+      __m256d acc=_mm256_setzero_pd();
+      for (int k=0; k<A.chunkLen[c]; k++) {
+        __m128i idx=_mm_loadu_si128((const __m128i*)(ccrd+k*sellC));
+        acc=_mm256_fmadd_pd(_mm256_loadu_pd(cvals+k*sellC),_mm256_i32gather_pd(x,idx,8),acc);
+      }
+      _mm256_storeu_pd(sum,acc);
+#else
+      for (int lane=0; lane<sellC; lane++)
+        sum[lane]=0.0;
+      for (int k=0; k<A.chunkLen[c]; k++)
+        for (int lane=0; lane<sellC; lane++)
+          sum[lane]+=cvals[k*sellC+lane]*x[ccrd[k*sellC+lane]];
+#endif
+      for (int r=c*sellC; r<min(A.rows,(c+1)*sellC); r++) {
+        int i=A.perm[r];
+        y[i] = (beta == 0.0) ? alpha*sum[r-c*sellC] : alpha*sum[r-c*sellC]+beta*z[i];
+      }
+    }
+  }
+
+  // Convert a CSR matrix, then benchmark and validate y = alpha*A*x + beta*z
+  void benchSELL(int rows, const int* pos, const int* crd, const double* vals,
+                 const vector<double>& x, double alpha, double beta, const vector<double>& z,
+                 const Tensor<double>& yRef, int sigma, int repeat, taco::util::TimeResults timevalue) {
+    SELL ASELL;
+    TACO_BENCH(CSRToSELL(rows,pos,crd,vals,sigma,ASELL);,"\nSELL convert",1,timevalue,false);
+    cout << "SELL-C-sigma: C=" << sellC << ", sigma=" << ASELL.sigma << ", " << sellKernel << " kernel" << endl;
+    cout << "SELL padding overhead: " << ASELL.paddingOverhead() << endl;
+
+    vector<double> y(rows);
+    TACO_BENCH(sellSpMV(ASELL,x.data(),alpha,beta,z.data(),y.data());,"SELL",repeat,timevalue,true);
+    reportGFLOPS("SELL",2.0*ASELL.nnz,timevalue);
+
+    Tensor<double> y_sell({rows}, Dense);
+    VectorTotaco(y,y_sell);
+
+    validate("SELL", y_sell, yRef, reassociationTolerance);
+  }
+
+  void exprToSELL(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                  int sigma) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL:
+      case SparsitySpMV:
+      case SparsityTTV: {
+        // A^T is computed as the CSR matrix given by the CSC arrays of A
+        bool transposed = (Expr==MATTRANSMUL);
+        const Tensor<double>& A=exprOperands.at("A");
+        int rows=A.getDimension(transposed ? 1 : 0);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        if (transposed)
+          getCSCArrays(exprOperands.csc("A"),&ia_CSR,&ja_CSR,&a_CSR);
+        else
+          getCSRArrays(exprOperands.csr("A"),&ia_CSR,&ja_CSR,&a_CSR);
+
+        double alpha=1.0;
+        double beta=0.0;
+        vector<double> x, z;
+        tacoToVector(exprOperands.at("x"),x);
+        if (hasAlphaBeta(Expr)) {
+          alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          tacoToVector(exprOperands.at("z"),z);
+        }
+
+        benchSELL(rows,ia_CSR,ja_CSR,a_CSR,x,alpha,beta,z,exprOperands.at("yRef"),sigma,repeat,timevalue);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for SELL" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration sellRegistration("SELL",
+      {SpMV,MATTRANSMUL,RESIDUAL,SparsitySpMV,SparsityTTV},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToSELL(run.expr,run.operands,run.repeat,timevalue,
+                   stoi(run.parameters.at("sigma")));
+      });
@@ -0,0 +1,121 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Rows of a triangular matrix grouped by level: a row only depends on rows of
+// previous levels, so all the rows of one level can be solved in parallel
+struct LevelSets {
+  vector<int> levelPtr;
+  vector<int> levelRows;
+
+  int numLevels() const { return (int)levelPtr.size()-1; }
+  double averageWidth() const {
+    return numLevels() ? (double)levelRows.size()/numLevels() : 0.0;
+  }
+};
+
+  // Split a square CSR matrix into its lower and upper triangular parts.
+  // The diagonal is replaced to make both factors diagonally dominant, which
+  // keeps the solves stable without changing the sparsity pattern.
+  void tacoToTriangular(const Tensor<double>& src, Tensor<double>& L, Tensor<double>& U) {
+    taco_uassert(src.getFormat()==CSR)<<"Tensor have to be in CSR format to be split in triangular parts";
+    int rows=src.getDimension(0);
+    double *a_CSR;
+    int* ia_CSR;
+    int* ja_CSR;
+    getCSRArrays(src,&ia_CSR,&ja_CSR,&a_CSR);
+    for (int i=0; i<rows; i++) {
+      double lowerSum=1.0;
+      double upperSum=1.0;
+      for (int p=ia_CSR[i]; p<ia_CSR[i+1]; p++) {
+        int j=ja_CSR[p];
+        if (j<i) {
+          L.insert({i,j},a_CSR[p]);
+          lowerSum+=fabs(a_CSR[p]);
+        }
+        else if (j>i) {
+          U.insert({i,j},a_CSR[p]);
+          upperSum+=fabs(a_CSR[p]);
+        }
+      }
+      L.insert({i,i},lowerSum);
+      U.insert({i,i},upperSum);
+    }
+    L.pack();
+    U.pack();
+  }
+
+  // Compute the level of each row (longest dependency chain) and bucket rows
+  // by level. Lower matrices depend on previous rows, upper ones on next rows.
+  void levelSetAnalysis(int rows, const int* pos, const int* crd, bool lower, LevelSets& levels) {
+    vector<int> level(rows,0);
+    int numLevels=0;
+    for (int k=0; k<rows; k++) {
+      int i = lower ? k : rows-1-k;
+      int l=0;
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        if (crd[p]!=i)
+          l=max(l,level[crd[p]]+1);
+      }
+      level[i]=l;
+      numLevels=max(numLevels,l+1);
+    }
+
+    levels.levelPtr.assign(numLevels+1,0);
+    for (int i=0; i<rows; i++)
+      levels.levelPtr[level[i]+1]++;
+    for (int l=0; l<numLevels; l++)
+      levels.levelPtr[l+1]+=levels.levelPtr[l];
+    vector<int> next(levels.levelPtr.begin(),levels.levelPtr.end()-1);
+    levels.levelRows.resize(rows);
+    for (int k=0; k<rows; k++) {
+      int i = lower ? k : rows-1-k;
+      levels.levelRows[next[level[i]]++]=i;
+    }
+  }
+
+  inline void sptrsvRow(int i, const int* pos, const int* crd, const double* vals,
+                        const double* b, double* x) {
+    double sum=b[i];
+    double diag=1.0;
+    for (int p=pos[i]; p<pos[i+1]; p++) {
+      if (crd[p]==i)
+        diag=vals[p];
+      else
+        sum-=vals[p]*x[crd[p]];
+    }
+    x[i]=sum/diag;
+  }
+
+  // Forward (lower) or backward (upper) substitution, one row after the other
+  void sptrsvSerial(int rows, const int* pos, const int* crd, const double* vals,
+                    const double* b, double* x, bool lower) {
+    if (lower) {
+      for (int i=0; i<rows; i++)
+        sptrsvRow(i,pos,crd,vals,b,x);
+    }
+    else {
+      for (int i=rows-1; i>=0; i--)
+        sptrsvRow(i,pos,crd,vals,b,x);
+    }
+  }
+
+  // Level-scheduled substitution: the rows of a level are distributed among
+  // threads, with a barrier between consecutive levels
+  void sptrsvLevelSet(const LevelSets& levels, const int* pos, const int* crd,
+                      const double* vals, const double* b, double* x) {
+    const int numLevels=levels.numLevels();
+    const int* levelPtr=levels.levelPtr.data();
+    const int* levelRows=levels.levelRows.data();
+    #pragma omp parallel
+    for (int l=0; l<numLevels; l++) {
+      #pragma omp for schedule(static)
+      for (int k=levelPtr[l]; k<levelPtr[l+1]; k++)
+        sptrsvRow(levelRows[k],pos,crd,vals,b,x);
+    }
+  }
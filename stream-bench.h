@@ -0,0 +1,441 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+// Out-of-core SpMV: the matrix is stored in a binary file as row panels of
+// about <panel> bytes, each one a CSR block with its own row pointers, and
+// streamed from disk so that it never has to fit in memory. A panel is laid
+// out as vals (double), pos (int, rows+1, starting at 0) then crd (int), at a
+// page-aligned offset so that it can also be mapped.
+
+const char panelFileMagic[8]={'T','A','C','O','P','N','L','1'};
+const int64_t panelAlignment=4096;
+
+struct PanelFileHeader {
+  char magic[8];
+  int64_t rows;
+  int64_t cols;
+  int64_t nnz;
+  int64_t panels;
+};
+
+struct PanelInfo {
+  int64_t offset;
+  int64_t bytes;
+  int64_t rowStart;
+  int64_t rows;
+  int64_t nnz;
+};
+
+struct PanelFile {
+  int fd;
+  PanelFileHeader header;
+  vector<PanelInfo> panels;
+  int64_t dataBytes;
+  int64_t maxPanelBytes;
+};
+
+  int64_t panelBytes(int64_t rows, int64_t nnz) {
+    return nnz*(sizeof(double)+sizeof(int)) + (rows+1)*sizeof(int);
+  }
+
+  // Call f(i,j,value) on each entry of a .mtx file, zero-based, mirroring the
+  // off-diagonal entries of symmetric matrices unless mirror is false. Only
+  // one line is in memory. Files that are not real, integer or pattern
+  // coordinate matrices, general or symmetric, and entries out of bounds
+  // are rejected.
+  template<typename F>
+  bool forEachMtxEntry(string filename, int64_t& rows, int64_t& cols, F f, bool mirror=true) {
+    FILE* file=fopen(filename.c_str(),"r");
+    if (!file)
+      return false;
+    char line[1024];
+    char object[64], format[64], field[64], symmetry[64];
+    if (!fgets(line,sizeof(line),file) ||
+        sscanf(line,"%%%%MatrixMarket %63s %63s %63s %63s",object,format,field,symmetry)!=4) {
+      cerr << "Error: " << filename << " has no Matrix Market banner" << endl;
+      fclose(file);
+      return false;
+    }
+    for (char* word : {object,format,field,symmetry})
+      for (char* c=word; *c; c++)
+        *c=tolower((unsigned char)*c);
+    bool pattern=strcmp(field,"pattern")==0;
+    bool symmetric=strcmp(symmetry,"symmetric")==0;
+    if (strcmp(object,"matrix")!=0 || strcmp(format,"coordinate")!=0 ||
+        (!pattern && strcmp(field,"real")!=0 && strcmp(field,"integer")!=0) ||
+        (!symmetric && strcmp(symmetry,"general")!=0)) {
+      cerr << "Error: " << filename << " is a " << format << " " << field << " " << symmetry
+           << " " << object << ", only real, integer or pattern coordinate matrices, general "
+           << "or symmetric, are supported" << endl;
+      fclose(file);
+      return false;
+    }
+    bool sized=false;
+    bool ok=true;
+    while (ok && fgets(line,sizeof(line),file)) {
+      if (line[0]=='%')
+        continue;
+      if (!sized) {
+        long long entries;
+        long long r, c;
+        if (sscanf(line,"%lld %lld %lld",&r,&c,&entries)!=3)
+          break;
+        rows=r;
+        cols=c;
+        sized=true;
+        continue;
+      }
+      char* end;
+      long i=strtol(line,&end,10)-1;
+      if (end==line)
+        continue;
+      long j=strtol(end,&end,10)-1;
+      double value=pattern ? 1.0 : strtod(end,&end);
+      if (i < 0 || i >= rows || j < 0 || j >= cols) {
+        cerr << "Error: entry (" << i+1 << "," << j+1 << ") of " << filename
+             << " is out of its " << rows << "x" << cols << " bounds" << endl;
+        ok=false;
+        break;
+      }
+      f(i,j,value);
+      if (mirror && symmetric && i!=j)
+        f(j,i,value);
+    }
+    fclose(file);
+    return sized && ok;
+  }
+
+  bool readFully(int fd, char* dst, int64_t bytes, int64_t offset) {
+    while (bytes > 0) {
+      ssize_t got=pread(fd,dst,bytes,offset);
+      if (got <= 0)
+        return false;
+      dst+=got;
+      bytes-=got;
+      offset+=got;
+    }
+    return true;
+  }
+
+  bool writeFully(int fd, const char* src, int64_t bytes, int64_t offset) {
+    while (bytes > 0) {
+      ssize_t put=pwrite(fd,src,bytes,offset);
+      if (put <= 0)
+        return false;
+      src+=put;
+      bytes-=put;
+      offset+=put;
+    }
+    return true;
+  }
+
+  // Convert a .mtx file to a panel file without loading it: a first pass
+  // counts the nonzeros of each row to cut the panels, then each group of
+  // panels fitting in <memory> bytes is filled by another pass over the file.
+  bool writePanelFile(string mtxFilename, string panelFilename, int64_t targetBytes, int64_t memory) {
+    int64_t rows=0, cols=0;
+    vector<int64_t> rowCounts;
+    bool sized=forEachMtxEntry(mtxFilename,rows,cols,[&](long i, long j, double value) {
+      if (rowCounts.empty())
+        rowCounts.resize(rows,0);
+      rowCounts[i]++;
+    });
+    if (!sized)
+      return false;
+    rowCounts.resize(rows,0);
+
+    vector<PanelInfo> panels;
+    PanelInfo panel={0,0,0,0,0};
+    for (int64_t i=0; i<rows; i++) {
+      if (panel.rows > 0 && panelBytes(panel.rows+1,panel.nnz+rowCounts[i]) > targetBytes) {
+        panels.push_back(panel);
+        panel={0,0,i,0,0};
+      }
+      panel.rows++;
+      panel.nnz+=rowCounts[i];
+    }
+    if (panel.rows > 0)
+      panels.push_back(panel);
+
+    PanelFileHeader header;
+    memcpy(header.magic,panelFileMagic,sizeof(panelFileMagic));
+    header.rows=rows;
+    header.cols=cols;
+    header.nnz=0;
+    header.panels=panels.size();
+    int64_t offset=sizeof(header)+panels.size()*sizeof(PanelInfo);
+    for (auto& p : panels) {
+      offset=(offset+panelAlignment-1)/panelAlignment*panelAlignment;
+      p.offset=offset;
+      p.bytes=panelBytes(p.rows,p.nnz);
+      offset+=p.bytes;
+      header.nnz+=p.nnz;
+    }
+
+    int fd=open(panelFilename.c_str(),O_CREAT|O_TRUNC|O_WRONLY,0644);
+    if (fd < 0)
+      return false;
+    bool ok=writeFully(fd,(const char*)&header,sizeof(header),0) &&
+            writeFully(fd,(const char*)panels.data(),panels.size()*sizeof(PanelInfo),sizeof(header));
+
+    size_t first=0;
+    while (ok && first < panels.size()) {
+      size_t last=first+1;
+      int64_t groupBytes=panels[first].bytes;
+      while (last < panels.size() && groupBytes+panels[last].bytes <= memory)
+        groupBytes+=panels[last++].bytes;
+      int64_t rowStart=panels[first].rowStart;
+      int64_t rowEnd=panels[last-1].rowStart+panels[last-1].rows;
+
+      // Row pointers of every panel, then a cursor per row to scatter entries
+      vector<vector<char>> buffers(last-first);
+      vector<int64_t> cursor(rowEnd-rowStart);
+      vector<size_t> owner(rowEnd-rowStart);
+      for (size_t p=first; p<last; p++) {
+        buffers[p-first].resize(panels[p].bytes);
+        int* pos=(int*)(buffers[p-first].data()+panels[p].nnz*sizeof(double));
+        pos[0]=0;
+        for (int64_t r=0; r<panels[p].rows; r++) {
+          int64_t i=panels[p].rowStart+r;
+          cursor[i-rowStart]=pos[r];
+          owner[i-rowStart]=p-first;
+          pos[r+1]=pos[r]+rowCounts[i];
+        }
+      }
+      forEachMtxEntry(mtxFilename,rows,cols,[&](long i, long j, double value) {
+        if (i < rowStart || i >= rowEnd)
+          return;
+        size_t p=owner[i-rowStart];
+        char* buffer=buffers[p].data();
+        int64_t nnz=panels[first+p].nnz;
+        int64_t k=cursor[i-rowStart]++;
+        ((double*)buffer)[k]=value;
+        ((int*)(buffer+nnz*sizeof(double)))[panels[first+p].rows+1+k]=j;
+      });
+      for (size_t p=first; ok && p<last; p++)
+        ok=writeFully(fd,buffers[p-first].data(),panels[p].bytes,panels[p].offset);
+      first=last;
+    }
+    // Written pages have to be clean for the page cache to drop them
+    ok=ok && fdatasync(fd)==0;
+    close(fd);
+    return ok;
+  }
+
+  bool openPanelFile(string filename, PanelFile& file) {
+    file.fd=open(filename.c_str(),O_RDONLY);
+    if (file.fd < 0)
+      return false;
+    if (!readFully(file.fd,(char*)&file.header,sizeof(file.header),0) ||
+        memcmp(file.header.magic,panelFileMagic,sizeof(panelFileMagic))!=0) {
+      close(file.fd);
+      return false;
+    }
+    file.panels.resize(file.header.panels);
+    readFully(file.fd,(char*)file.panels.data(),file.panels.size()*sizeof(PanelInfo),sizeof(file.header));
+    file.dataBytes=0;
+    file.maxPanelBytes=0;
+    for (auto& panel : file.panels) {
+      file.dataBytes+=panel.bytes;
+      file.maxPanelBytes=max(file.maxPanelBytes,panel.bytes);
+    }
+    return true;
+  }
+
+  // Evict the file from the page cache, so that every run reads from disk
+  void dropPageCache(const PanelFile& file) {
+    posix_fadvise(file.fd,0,0,POSIX_FADV_DONTNEED);
+  }
+
+  // y = alpha*A*x + beta*z on the rows of one panel
+  void panelSpMV(const PanelInfo& panel, const char* buffer, const double* x,
+                 double alpha, double beta, const double* z, double* y) {
+    const double* vals=(const double*)buffer;
+    const int* pos=(const int*)(buffer+panel.nnz*sizeof(double));
+    const int* crd=pos+panel.rows+1;
+    csrSpMV<double,double>(panel.rows,pos,crd,vals,x,alpha,beta,
+                           z ? z+panel.rowStart : NULL,y+panel.rowStart);
+  }
+
+  // Read the whole file panel by panel without computing: the disk bandwidth
+  void readPanels(const PanelFile& file, vector<char>& buffer) {
+    for (auto& panel : file.panels)
+      readFully(file.fd,buffer.data(),panel.bytes,panel.offset);
+  }
+
+// Reader thread kept for a whole benchmark: read() hands it a panel to
+// read into a buffer and wait() returns once it is read
+struct PanelReader {
+  const PanelFile& file;
+  const PanelInfo* panel;
+  char* buffer;
+  bool stop;
+  mutex lock;
+  condition_variable changed;
+  std::thread worker;
+
+  PanelReader(const PanelFile& file) : file(file), panel(NULL), buffer(NULL), stop(false) {
+    worker=std::thread([this]() {
+      unique_lock<mutex> guard(lock);
+      while (true) {
+        changed.wait(guard,[this]() { return panel || stop; });
+        if (stop)
+          return;
+        guard.unlock();
+        readFully(this->file.fd,buffer,panel->bytes,panel->offset);
+        guard.lock();
+        panel=NULL;
+        changed.notify_all();
+      }
+    });
+  }
+
+  ~PanelReader() {
+    {
+      lock_guard<mutex> guard(lock);
+      stop=true;
+    }
+    changed.notify_all();
+    worker.join();
+  }
+
+  void read(const PanelInfo& next, char* dst) {
+    lock_guard<mutex> guard(lock);
+    panel=&next;
+    buffer=dst;
+    changed.notify_all();
+  }
+
+  void wait() {
+    unique_lock<mutex> guard(lock);
+    changed.wait(guard,[this]() { return !panel; });
+  }
+};
+
+  // Double-buffered pread: the reader reads panel p+1 while panel p is
+  // computed
+  void streamSpMVPread(const PanelFile& file, PanelReader& reader, vector<char> (&buffers)[2],
+                       const double* x, double alpha, double beta, const double* z, double* y) {
+    const vector<PanelInfo>& panels=file.panels;
+    if (panels.empty())
+      return;
+    readFully(file.fd,buffers[0].data(),panels[0].bytes,panels[0].offset);
+    for (size_t p=0; p<panels.size(); p++) {
+      if (p+1 < panels.size())
+        reader.read(panels[p+1],buffers[(p+1)%2].data());
+      panelSpMV(panels[p],buffers[p%2].data(),x,alpha,beta,z,y);
+      reader.wait();
+    }
+  }
+
+  // mmap of the whole file: the next panel is prefetched with MADV_WILLNEED
+  // while the current one is computed, then released with MADV_DONTNEED
+  void streamSpMVMmap(const PanelFile& file, const char* mapped, const double* x,
+                      double alpha, double beta, const double* z, double* y) {
+    const vector<PanelInfo>& panels=file.panels;
+    for (size_t p=0; p<panels.size(); p++) {
+      if (p+1 < panels.size())
+        madvise((void*)(mapped+panels[p+1].offset),panels[p+1].bytes,MADV_WILLNEED);
+      panelSpMV(panels[p],mapped+panels[p].offset,x,alpha,beta,z,y);
+      madvise((void*)(mapped+panels[p].offset),panels[p].bytes,MADV_DONTNEED);
+    }
+  }
+
+  // y = alpha*A*x + beta*z accumulated in one pass over a .mtx file, as a
+  // reference that does not need the matrix in memory
+  bool mtxSpMV(string mtxFilename, const double* x, double alpha, double beta,
+               const double* z, vector<double>& y) {
+    int64_t rows=0, cols=0;
+    vector<double> sum;
+    bool sized=forEachMtxEntry(mtxFilename,rows,cols,[&](long i, long j, double value) {
+      if (sum.empty())
+        sum.resize(rows,0.0);
+      sum[i]+=value*x[j];
+    });
+    if (!sized)
+      return false;
+    sum.resize(rows,0.0);
+    y.resize(rows);
+    for (int64_t i=0; i<rows; i++)
+      y[i] = (beta == 0.0) ? alpha*sum[i] : alpha*sum[i]+beta*z[i];
+    return true;
+  }
+
+  void reportBandwidth(string name, int64_t bytes, const taco::util::TimeResults& time,
+                       const taco::util::TimeResults& raw) {
+    cout << name << " GB/s" << endl << bytes/(time.mean*1e6) << endl;
+    cout << name << " fraction of raw disk bandwidth" << endl << raw.mean/time.mean << endl;
+  }
+
+  // SpMV (or RESIDUAL, y = z - A*x) streamed from a panel file, timed from a
+  // cold page cache against reading the file alone. The result is checked
+  // against one pass over mtxFilename, the .mtx the panels were built from,
+  // when given.
+  void benchStreamSpMV(const PanelFile& file, bool residual, const Tensor<double>& xTensor,
+                       const Tensor<double>& zTensor, string mtxFilename, int repeat,
+                       taco::util::TimeResults timevalue) {
+    int64_t rows=file.header.rows;
+    cout << "Panel file: " << rows << "x" << file.header.cols << ", " << file.header.nnz
+         << " nonzeros, " << file.panels.size() << " panels, "
+         << file.dataBytes/(1024.0*1024.0) << " MB" << endl;
+    const double* x=(double*)(xTensor.getStorage().getValues().getData());
+    const double* z=residual ? (double*)(zTensor.getStorage().getValues().getData()) : NULL;
+    double alpha=residual ? -1.0 : 1.0;
+    double beta=residual ? 1.0 : 0.0;
+
+    vector<char> buffers[2];
+    buffers[0].resize(file.maxPanelBytes);
+    buffers[1].resize(file.maxPanelBytes);
+    taco::util::TimeResults raw;
+    TACO_BENCH_SETUP(dropPageCache(file);,readPanels(file,buffers[0]);,
+                     "\nRaw disk read",repeat,raw,false);
+    cout << "Raw disk read GB/s" << endl << file.dataBytes/(raw.mean*1e6) << endl;
+
+    vector<double> y_pread(rows);
+    PanelReader reader(file);
+    TACO_BENCH_SETUP(dropPageCache(file);,
+                     streamSpMVPread(file,reader,buffers,x,alpha,beta,z,y_pread.data());,
+                     "Streaming pread",repeat,timevalue,true);
+    reportBandwidth("Streaming pread",file.dataBytes,timevalue,raw);
+    Tensor<double> y1({(int)rows},Dense);
+    VectorTotaco(y_pread,y1);
+    vector<double> y_mtx;
+    if (!mtxFilename.empty() && mtxSpMV(mtxFilename,x,alpha,beta,z,y_mtx) &&
+        (int64_t)y_mtx.size()==rows) {
+      Tensor<double> yRef({(int)rows},Dense);
+      VectorTotaco(y_mtx,yRef);
+      validate("Streaming pread",y1,yRef,reassociationTolerance);
+    }
+
+    int64_t fileBytes=file.panels.empty() ? 0 : file.panels.back().offset+file.panels.back().bytes;
+    const char* mapped=(const char*)mmap(NULL,fileBytes,PROT_READ,MAP_SHARED,file.fd,0);
+    if (mapped==MAP_FAILED) {
+      cout << " !! Cannot map the panel file" << endl;
+      return;
+    }
+    vector<double> y_mmap(rows);
+    TACO_BENCH_SETUP(dropPageCache(file);,
+                     streamSpMVMmap(file,mapped,x,alpha,beta,z,y_mmap.data());,
+                     "Streaming mmap",repeat,timevalue,true);
+    reportBandwidth("Streaming mmap",file.dataBytes,timevalue,raw);
+    munmap((void*)mapped,fileBytes);
+
+    // The matrix may not fit in memory for a taco reference: mmap is checked
+    // against pread
+    Tensor<double> y2({(int)rows},Dense);
+    VectorTotaco(y_mmap,y2);
+    validate("Streaming mmap",y2,y1);
+  }
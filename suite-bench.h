@@ -0,0 +1,207 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <cmath>
+#include <fstream>
+
+// Suite of matrices and expressions benchmarked in a single process. A
+// manifest has one entry per line: the expression Id of -E followed by the
+// input tensors as in -i, e.g. "1 A:consph.mtx". Empty lines and lines
+// starting with '#' are skipped.
+
+struct SuiteEntry {
+  int expression;
+  map<string,string> inputFilenames;
+};
+
+// Structural features of a matrix, to correlate with the fastest format and
+// product on it
+struct MatrixFeatures {
+  int rows;
+  int cols;
+  long nnz;
+  double rowMean;
+  double rowVariance;
+  int rowMax;
+  int bandwidth;
+  // Fraction of the rows whose diagonal is at least the sum of the others
+  double diagonalDominance;
+  // Stored entries over nonzeros with b x b register blocks, for b=2..8
+  vector<double> blockFill;
+};
+
+const int minBlockSize=2;
+const int maxBlockSize=8;
+
+// Context of the precompiled CSR baseline of SpMV. Its compute phase is not
+// a taco format, so it is not a candidate for the best one.
+const string precompiledCSRContext="precompiled CSR";
+
+  bool readManifest(string filename, vector<SuiteEntry>& entries) {
+    ifstream file(filename);
+    if (!file)
+      return false;
+    string line;
+    while (getline(file,line)) {
+      std::istringstream words(line);
+      string word;
+      if (!(words >> word) || word[0]=='#')
+        continue;
+      SuiteEntry entry;
+      try {
+        entry.expression=stoi(word);
+      }
+      catch (...) {
+        return false;
+      }
+      while (words >> word) {
+        size_t colon=word.find(':');
+        if (colon==string::npos)
+          return false;
+        entry.inputFilenames[word.substr(0,colon)]=word.substr(colon+1);
+      }
+      entries.push_back(entry);
+    }
+    return true;
+  }
+
+  // Features of a CSR matrix, in a single pass per register block size
+  MatrixFeatures computeFeatures(const Tensor<double>& A) {
+    MatrixFeatures features;
+    features.rows=A.getDimension(0);
+    features.cols=A.getDimension(1);
+    double *vals;
+    int* pos;
+    int* crd;
+    getCSRArrays(A,&pos,&crd,&vals);
+    int rows=features.rows;
+    features.nnz=pos[rows];
+    features.rowMean=rows ? (double)features.nnz/rows : 0.0;
+    features.rowVariance=0.0;
+    features.rowMax=0;
+    features.bandwidth=0;
+    int dominant=0;
+    for (int i=0; i<rows; i++) {
+      int length=pos[i+1]-pos[i];
+      features.rowVariance+=(length-features.rowMean)*(length-features.rowMean);
+      features.rowMax=max(features.rowMax,length);
+      double diagonal=0.0;
+      double others=0.0;
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        features.bandwidth=max(features.bandwidth,std::abs(crd[p]-i));
+        if (crd[p]==i)
+          diagonal+=std::abs(vals[p]);
+        else
+          others+=std::abs(vals[p]);
+      }
+      if (diagonal >= others)
+        dominant++;
+    }
+    if (rows)
+      features.rowVariance/=rows;
+    features.diagonalDominance=rows ? (double)dominant/rows : 0.0;
+
+    for (int b=minBlockSize; b<=maxBlockSize; b++) {
+      // Distinct block columns of each block row, marked with the block row
+      vector<int> marker((features.cols+b-1)/b,-1);
+      long blocks=0;
+      for (int blockRow=0; blockRow*b<rows; blockRow++) {
+        for (int i=blockRow*b; i<min(rows,(blockRow+1)*b); i++) {
+          for (int p=pos[i]; p<pos[i+1]; p++) {
+            if (marker[crd[p]/b]!=blockRow) {
+              marker[crd[p]/b]=blockRow;
+              blocks++;
+            }
+          }
+        }
+      }
+      features.blockFill.push_back(features.nnz ? (double)blocks*b*b/features.nnz : 0.0);
+    }
+    return features;
+  }
+
+  // One row per suite entry: the features of its matrix, and the fastest
+  // taco format and product among the compute phases it ran
+  struct SuiteTable {
+    vector<string> matrices;
+    vector<string> expressions;
+    vector<bool> hasFeatures;
+    vector<MatrixFeatures> features;
+    vector<string> bestFormats;
+    vector<double> bestFormatTimes;
+    vector<string> bestProducts;
+    vector<double> bestProductTimes;
+
+    // Add an entry from the phases benchmarked since benchResults[first]
+    void add(string matrix, string expression, const MatrixFeatures* matrixFeatures, size_t first) {
+      matrices.push_back(matrix);
+      expressions.push_back(expression);
+      hasFeatures.push_back(matrixFeatures!=NULL);
+      features.push_back(matrixFeatures ? *matrixFeatures : MatrixFeatures());
+      string bestFormat="-";
+      string bestProduct="-";
+      double formatTime=0.0;
+      double productTime=0.0;
+      for (size_t r=first; r<benchResults.size(); r++) {
+        const BenchResult& result=benchResults[r];
+        if (!result.cold)
+          continue;
+        if (result.context.format=="products") {
+          if (bestProduct=="-" || result.time.mean < productTime) {
+            bestProduct=result.name;
+            productTime=result.time.mean;
+          }
+        }
+        else if (result.name=="Compute" && result.context.format!=precompiledCSRContext) {
+          if (bestFormat=="-" || result.time.mean < formatTime) {
+            bestFormat=result.context.format;
+            formatTime=result.time.mean;
+          }
+        }
+      }
+      bestFormats.push_back(bestFormat);
+      bestFormatTimes.push_back(formatTime);
+      bestProducts.push_back(bestProduct);
+      bestProductTimes.push_back(productTime);
+    }
+
+    // Add an entry that could not be benchmarked, with the features of its
+    // matrix when they could be computed
+    void addFailed(string matrix, string expression, const MatrixFeatures* matrixFeatures) {
+      matrices.push_back(matrix);
+      expressions.push_back(expression);
+      hasFeatures.push_back(matrixFeatures!=NULL);
+      features.push_back(matrixFeatures ? *matrixFeatures : MatrixFeatures());
+      bestFormats.push_back("failed");
+      bestFormatTimes.push_back(0.0);
+      bestProducts.push_back("failed");
+      bestProductTimes.push_back(0.0);
+    }
+
+    // Tab-separated, so that it can be read back for analysis
+    void print(ostream& out) const {
+      out << "matrix\texpression\trows\tcols\tnnz\tnnz/row mean\tnnz/row variance\tnnz/row max"
+          << "\tbandwidth\tdiagonal dominance";
+      for (int b=minBlockSize; b<=maxBlockSize; b++)
+        out << "\tfill " << b << "x" << b;
+      out << "\tbest taco format\ttime (ms)\tbest product\ttime (ms)" << endl;
+      for (size_t e=0; e<matrices.size(); e++) {
+        out << matrices[e] << "\t" << expressions[e];
+        if (hasFeatures[e]) {
+          const MatrixFeatures& f=features[e];
+          out << "\t" << f.rows << "\t" << f.cols << "\t" << f.nnz << "\t" << f.rowMean << "\t"
+              << f.rowVariance << "\t" << f.rowMax << "\t" << f.bandwidth << "\t" << f.diagonalDominance;
+          for (double fill : f.blockFill)
+            out << "\t" << fill;
+        }
+        else {
+          for (int c=0; c<8+maxBlockSize-minBlockSize+1; c++)
+            out << "\t-";
+        }
+        out << "\t" << bestFormats[e] << "\t" << bestFormatTimes[e]
+            << "\t" << bestProducts[e] << "\t" << bestProductTimes[e] << endl;
+      }
+    }
+  };
@@ -0,0 +1,214 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <cstdio>
+#include <cstring>
+
+// Symmetric matrices stored as their lower triangle, diagonal included, as
+// Matrix Market files flagged symmetric store them. taco reads them to full
+// storage; the lower triangle is kept next to A as "ALower", so that products
+// with a symmetric mode can read half of the matrix. SpMV on the lower
+// triangle does the transposed update y(j) += A(i,j)*x(i) in the same pass.
+
+  // Whether the banner of a Matrix Market file flags it symmetric
+  bool isSymmetricMtx(string filename) {
+    FILE* file=fopen(filename.c_str(),"r");
+    if (!file)
+      return false;
+    char line[1024];
+    bool symmetric=fgets(line,sizeof(line),file) && strncmp(line,"%%MatrixMarket",14)==0
+                   && strstr(line,"symmetric") && !strstr(line,"skew");
+    fclose(file);
+    return symmetric;
+  }
+
+  // Read the triangle stored in a symmetric .mtx file as a lower CSR matrix
+  Tensor<double> readLowerTriangle(string filename) {
+    int64_t rows=0;
+    int64_t cols=0;
+    vector<pair<pair<int,int>,double>> entries;
+    forEachMtxEntry(filename,rows,cols,[&](long i, long j, double value) {
+      entries.push_back({{(int)max(i,j),(int)min(i,j)},value});
+    },false);
+    Tensor<double> L({(int)rows,(int)cols},CSR);
+    for (auto& entry : entries)
+      L.insert({entry.first.first,entry.first.second},entry.second);
+    L.pack();
+    return L;
+  }
+
+  // y = alpha*A*x + beta*z with A given by its lower triangle, z is not read
+  // when beta is zero
+  void symmetricSpMV(int rows, const int* pos, const int* crd, const double* vals,
+                     const double* x, double alpha, double beta, const double* z, double* y) {
+    for (int i=0; i<rows; i++)
+      y[i]=0.0;
+    for (int i=0; i<rows; i++) {
+      double sum=0.0;
+      double xi=x[i];
+      for (int p=pos[i]; p<pos[i+1]; p++) {
+        int j=crd[p];
+        sum+=vals[p]*x[j];
+        if (j!=i)
+          y[j]+=vals[p]*xi;
+      }
+      y[i]+=sum;
+    }
+    for (int i=0; i<rows; i++)
+      y[i] = (beta == 0.0) ? alpha*y[i] : alpha*y[i]+beta*z[i];
+  }
+
+  // Lower triangle split between threads by nonzeros. Each thread accumulates
+  // its rows and transposed updates in a private vector, over the rows
+  // low[t]..rowStart[t+1]-1 it can touch, stored from low[t] on, which are
+  // summed in y after.
+  struct SymmetricPartition {
+    vector<int> rowStart;
+    vector<int> low;
+    vector<vector<double>> privateY;
+
+    int threads() const { return (int)rowStart.size()-1; }
+  };
+
+  void partitionSymmetric(int rows, const int* pos, const int* crd, int threads,
+                          SymmetricPartition& partition) {
+    partition.rowStart=partitionCSR("nnz",rows,pos,threads).rowStart;
+    partition.low.assign(threads,0);
+    partition.privateY.assign(threads,vector<double>());
+    #pragma omp parallel for schedule(static,1) num_threads(threads)
+    for (int t=0; t<threads; t++) {
+      int low=partition.rowStart[t];
+      for (int i=partition.rowStart[t]; i<partition.rowStart[t+1]; i++)
+        for (int p=pos[i]; p<pos[i+1]; p++)
+          low=min(low,crd[p]);
+      partition.low[t]=low;
+      partition.privateY[t].resize(partition.rowStart[t+1]-low);
+    }
+  }
+
+  void symmetricSpMVPrivate(SymmetricPartition& partition, int rows, const int* pos,
+                            const int* crd, const double* vals, const double* x,
+                            double alpha, double beta, const double* z, double* y) {
+    int threads=partition.threads();
+    #pragma omp parallel num_threads(threads)
+    {
+      #pragma omp for schedule(static,1)
+      for (int t=0; t<threads; t++) {
+        // yt is indexed by row, from low[t] on
+        double* yt=partition.privateY[t].data()-partition.low[t];
+        for (int i=partition.low[t]; i<partition.rowStart[t+1]; i++)
+          yt[i]=0.0;
+        for (int i=partition.rowStart[t]; i<partition.rowStart[t+1]; i++) {
+          double sum=0.0;
+          double xi=x[i];
+          for (int p=pos[i]; p<pos[i+1]; p++) {
+            int j=crd[p];
+            sum+=vals[p]*x[j];
+            if (j!=i)
+              yt[j]+=vals[p]*xi;
+          }
+          yt[i]+=sum;
+        }
+      }
+      #pragma omp for schedule(static)
+      for (int i=0; i<rows; i++) {
+        double sum=0.0;
+        for (int t=0; t<threads; t++)
+          if (partition.low[t] <= i && i < partition.rowStart[t+1])
+            sum+=partition.privateY[t][i-partition.low[t]];
+        y[i] = (beta == 0.0) ? alpha*sum : alpha*sum+beta*z[i];
+      }
+    }
+  }
+
+  // Full-storage CSR SpMV next to SpMV on the lower triangle, serial and on
+  // the same threads, with the bytes of matrix each of them reads
+  void benchSymmetric(const Tensor<double>& ACSR, const Tensor<double>& ALower,
+                      const vector<double>& x, double alpha, double beta, const vector<double>& z,
+                      const Tensor<double>& yRef, int repeat, taco::util::TimeResults timevalue) {
+    int rows=ACSR.getDimension(0);
+    double *a_CSR, *l_CSR;
+    int *ia_CSR, *il_CSR;
+    int *ja_CSR, *jl_CSR;
+    getCSRArrays(ACSR,&ia_CSR,&ja_CSR,&a_CSR);
+    getCSRArrays(ALower,&il_CSR,&jl_CSR,&l_CSR);
+    cout << "Symmetric storage: " << il_CSR[rows] << " of " << ia_CSR[rows] << " nonzeros, "
+         << panelBytes(rows,il_CSR[rows])/1e6 << " of " << panelBytes(rows,ia_CSR[rows])/1e6
+         << " MB of matrix" << endl;
+
+    vector<double> y(rows);
+    RowPartition serial=partitionCSR("rows",rows,ia_CSR,1);
+    benchNextPhaseOn(1);
+    TACO_BENCH(partitionedSpMV(serial,ia_CSR,ja_CSR,a_CSR,x.data(),alpha,beta,z.data(),y.data());,
+               "\nSYMMETRIC full storage serial",repeat,timevalue,true);
+    reportGFLOPS("SYMMETRIC full storage serial",2.0*ia_CSR[rows],timevalue);
+    Tensor<double> y_full({rows}, Dense);
+    VectorTotaco(y,y_full);
+    validate("SYMMETRIC full storage serial", y_full, yRef, reassociationTolerance);
+
+    benchNextPhaseOn(1);
+    TACO_BENCH(symmetricSpMV(rows,il_CSR,jl_CSR,l_CSR,x.data(),alpha,beta,z.data(),y.data());,
+               "SYMMETRIC serial",repeat,timevalue,true);
+    reportGFLOPS("SYMMETRIC serial",2.0*ia_CSR[rows],timevalue);
+    Tensor<double> y_serial({rows}, Dense);
+    VectorTotaco(y,y_serial);
+    validate("SYMMETRIC serial", y_serial, yRef, reassociationTolerance);
+
+    RowPartition rowPartition=partitionCSR("nnz",rows,ia_CSR,benchThreads());
+    string fullName="SYMMETRIC full storage "+to_string(rowPartition.threads())+" threads";
+    TACO_BENCH(partitionedSpMV(rowPartition,ia_CSR,ja_CSR,a_CSR,x.data(),alpha,beta,z.data(),y.data());,
+               "\n"+fullName,repeat,timevalue,true);
+    reportGFLOPS(fullName,2.0*ia_CSR[rows],timevalue);
+    Tensor<double> y_fullThreads({rows}, Dense);
+    VectorTotaco(y,y_fullThreads);
+    validate(fullName, y_fullThreads, yRef, reassociationTolerance);
+
+    SymmetricPartition partition;
+    TACO_BENCH(partitionSymmetric(rows,il_CSR,jl_CSR,benchThreads(),partition);,
+               "SYMMETRIC partitioning",1,timevalue,false);
+    string name="SYMMETRIC "+to_string(partition.threads())+" threads";
+    TACO_BENCH(symmetricSpMVPrivate(partition,rows,il_CSR,jl_CSR,l_CSR,x.data(),alpha,beta,z.data(),y.data());,
+               name,repeat,timevalue,true);
+    reportGFLOPS(name,2.0*ia_CSR[rows],timevalue);
+    Tensor<double> y_private({rows}, Dense);
+    VectorTotaco(y,y_private);
+    validate(name, y_private, yRef, reassociationTolerance);
+  }
+
+  void exprToSymmetric(BenchExpr Expr, const OperandStore& exprOperands,int repeat,
+                       taco::util::TimeResults timevalue) {
+    switch(Expr) {
+      case SpMV:
+      case MATTRANSMUL:
+      case RESIDUAL: {
+        if (!exprOperands.count("ALower")) {
+          cout << " !! SYMMETRIC needs A from a .mtx file flagged symmetric" << endl;
+          break;
+        }
+        // A^T = A
+        double alpha=1.0;
+        double beta=0.0;
+        vector<double> x, z;
+        tacoToVector(exprOperands.at("x"),x);
+        if (hasAlphaBeta(Expr)) {
+          alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+          beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+          tacoToVector(exprOperands.at("z"),z);
+        }
+        benchSymmetric(exprOperands.csr("A"),exprOperands.csr("ALower"),x,alpha,beta,z,
+                       exprOperands.at("yRef"),repeat,timevalue);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for SYMMETRIC" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration symmetricRegistration("SYMMETRIC",
+      {SpMV,MATTRANSMUL,RESIDUAL},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToSymmetric(run.expr,run.operands,run.repeat,timevalue);
+      });
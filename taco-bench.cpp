@@ -2,6 +2,13 @@
 #include <string>
 #include <vector>
 #include <fstream>
+#include <algorithm>
+#include <glob.h>
+#include <sys/stat.h>
+#include <dlfcn.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "taco.h"
 #include "taco/util/strings.h"
@@ -10,6 +17,22 @@
 #include "taco/util/fill.h"
 
 #include "taco-bench.h"
+#include "baseline-bench.h"
+#include "suite-bench.h"
+#include "sptrsv-bench.h"
+#include "csr-bench.h"
+#include "partition-bench.h"
+#include "stream-bench.h"
+#include "symmetric-bench.h"
+#include "fused-bench.h"
+#include "matpow-bench.h"
+#include "csr16-bench.h"
+#include "sell-bench.h"
+#include "csr5-bench.h"
+#include "cacheblock-bench.h"
+#include "update-bench.h"
+#include "sddmm-bench.h"
+#include "layout-bench.h"
 // Includes for all the products
 #include "eigen-bench.h"
 #include "ublas-bench.h"
@@ -61,9 +84,13 @@ static void printUsageInfo() {
             "   3: MATTRANSMUL   y = alpha*A^Tx + beta*z \n"
             "   4: RESIDUAL      y(i) = b(i) - A(i,j)*x(j) \n"
             "   5: SDDMM         A = B o (CxD) \n"
-            "   6: SparsitySpMV  y = alpha*A^Tx + beta*z \n"
+            "   6: SparsitySpMV  y = alpha*Ax + beta*z \n"
             "   7: SparsityTTV   A(i,j) = B(i,j,k) * x(k) \n"
-            "   8: SparsitySpMDM C(i,j) = A(i, k) * B(k, j) \n");
+            "   8: SparsitySpMDM C(i,j) = A(i, k) * B(k, j) \n"
+            "   9: SpTRSV        L x = b and U x = b with L,U from A \n"
+            "  10: MULTANDTRANS  y = Ax and t = A^Tw in one pass over A \n"
+            "  11: MATPOW        y = A^k x \n"
+            "The name of an expression can be given instead of its Id.");
   cout << endl;
   printFlag("r=<repeat>",
             "Time compilation, assembly and <repeat> times computation "
@@ -75,11 +102,107 @@ static void printUsageInfo() {
   printFlag("s=<size>",
             "Size of each mode for sparsities studies.");
   cout << endl;
+  printFlag("k=<Ksize>",
+            "Inner dimension of the dense factors C and D of SDDMM "
+            "(defaults to 100), or power of MATPOW (defaults to 4).");
+  cout << endl;
+  printFlag("batch=<dir|glob|N>",
+            "Benchmark SpMV (-E=1) or SDDMM (-E=5) over a batch of "
+            "independent problems: the .mtx files of a directory or glob "
+            "pattern, or N random matrices of size <size>. Each product runs "
+            "the batch back-to-back and as one block-diagonal problem.");
+  cout << endl;
+  printFlag("suite=<manifest>",
+            "Benchmark in one process every entry of a manifest, one per "
+            "line: an expression Id followed by its <tensor>:<filename> "
+            "inputs. A table gives the structural features of each matrix "
+            "with the fastest taco format and product on it.");
+  cout << endl;
+  printFlag("table=<file>",
+            "Also write the table of -suite to a tab-separated file.");
+  cout << endl;
+  printFlag("tile=<KB>",
+            "Size of the row blocks of the communication-avoiding MATPOW "
+            "kernel of the POWERS product, which should fit in cache "
+            "(defaults to 256).");
+  cout << endl;
+  printFlag("xtile=<KB>",
+            "Bytes of x each column tile of the CACHEBLOCKED product reads, "
+            "instead of autotuning them over fractions of the L2 and "
+            "last-level caches.");
+  cout << endl;
+  printFlag("partition=<strategy>",
+            "Split the rows of threaded SpMV by rows (as schedule(static)), "
+            "nnz (nonzeros per thread), merge (merge path over rows and "
+            "nonzeros) or hybrid (nnz, splitting rows longer than a thread "
+            "share). Used by the PARTITIONED product, which runs all of them "
+            "by default. Other than rows, pOSKI gets its own nnz-balanced "
+            "partitions.");
+  cout << endl;
+  printFlag("updates=<k>",
+            "Inserts and deletes of nonzeros per batch of the UPDATE product "
+            "on SpMV (-E=1), half each (defaults to nnz/1000).");
+  cout << endl;
+  printFlag("batches=<n>",
+            "Number of update batches of the UPDATE product, each followed "
+            "by SpMV (defaults to 10).");
+  cout << endl;
+  printFlag("layouts",
+            "Also benchmark SDDMM (-E=5) and SparsitySpMDM (-E=8) on every "
+            "row-major and column-major combination of their dense operands, "
+            "in taco and in the Eigen and MKL products. The LAYOUT product "
+            "always runs their combinations with 8x8 tiles as well.");
+  cout << endl;
+  printFlag("results=<file>",
+            "Write every benchmarked phase with the time of each repetition "
+            "to a tab-separated results file.");
+  cout << endl;
+  printFlag("baseline=<file>",
+            "Compare this run to a results file: phases are matched on "
+            "expression, name, format, sparsity and threads, and a median "
+            "change above the threshold that a Mann-Whitney test finds "
+            "significant is a regression or an improvement. Phases need "
+            "-r=4 or more in both runs to be tested. Exits with 1 on "
+            "regressions, and with 7 when no phase could be tested.");
+  cout << endl;
+  printFlag("threshold=<percent>",
+            "Smallest change flagged against the baseline (defaults to 5).");
+  cout << endl;
+  printFlag("stream=<panels>",
+            "Stream SpMV (-E=1) or RESIDUAL (-E=4) from a file of row panels "
+            "instead of loading the matrix, overlapping the read of a panel "
+            "with the computation of the previous one. The panel file is "
+            "built from -i=A:<filename> when given.");
+  cout << endl;
+  printFlag("panel=<MB>",
+            "Size of the row panels of -stream (defaults to 64).");
+  cout << endl;
+  printFlag("sigma=<window>",
+            "Sorting window of the SELL-C-sigma format, rounded to a "
+            "multiple of C (defaults to 256).");
+  cout << endl;
+  printFlag("precision=<f64|f32|mixed>",
+            "Precision of the products: double (default), single, or float "
+            "values with double accumulation. taco results stay the double "
+            "reference and the CSR product runs its native kernel in both "
+            "precisions. Products without "
+            "mixed precision run in single precision.");
+  cout << endl;
+  string registered;
+  for (auto& product : productRegistry()) {
+    string name=product.name;
+    for (auto & c: name) c = tolower(c);
+    registered += (registered.empty() ? "" : ", ") + name;
+  }
   printFlag("p=<product>,<products>",
             "Specify a list of products to use from: \n "
-            "eigen, gmm, ublas, oski, poski, mkl and eventually yours. \n "
+            + registered + " and the loaded ones. \n "
             "(not specified launches all products)");
   cout << endl;
+  printFlag("load=<library>,<libraries>",
+            "Load products from shared objects exporting "
+            "registerTacoBenchProducts(ProductRegistry&).");
+  cout << endl;
 }
 
 static int reportError(string errorMessage, int errorCode) {
@@ -108,133 +231,344 @@ static void readMatrixSize(string filename, int& rows, int& cols)
   file.close();
 }
 
+// Expand a directory or a glob pattern to the .mtx files it contains
+static vector<string> listBatchFiles(string descriptor) {
+  struct stat info;
+  if (stat(descriptor.c_str(),&info)==0 && S_ISDIR(info.st_mode))
+    descriptor += "/*.mtx";
+  vector<string> filenames;
+  glob_t matches;
+  if (glob(descriptor.c_str(),0,NULL,&matches)==0) {
+    for (size_t k=0; k<matches.gl_pathc; k++)
+      filenames.push_back(matches.gl_pathv[k]);
+  }
+  globfree(&matches);
+  return filenames;
+}
 
-int main(int argc, char* argv[]) {
+// Load the matrices of a batch: N random matrices of size <size> when the
+// descriptor is a number, the .mtx files of a directory or glob otherwise
+static bool loadBatch(string descriptor, int size, Format format,
+                      vector<Tensor<double>>& batch) {
+  const double batchDensity=0.01;
+  if (!descriptor.empty() &&
+      all_of(descriptor.begin(),descriptor.end(),::isdigit)) {
+    int problems=stoi(descriptor);
+    for (int k=0; k<problems; k++) {
+      Tensor<double> A({size,size},format);
+      util::fillMatrix(A,util::FillMethod::Random,batchDensity);
+      batch.push_back(A);
+    }
+  }
+  else {
+    for (auto& filename : listBatchFiles(descriptor))
+      batch.push_back(read(filename,format,true));
+  }
+  return !batch.empty();
+}
 
-  int Expression=1;
-  BenchExpr Expr;
-  map<string,Tensor<double>> exprOperands;
-  int repeat=1;
-  int size = 100;
-  map<string,string> inputFilenames;
-  taco::util::TimeResults timevalue;
-  map<string,bool> products;
-  products.insert({"EIGEN",true});
-  products.insert({"GMM",true});
-  products.insert({"UBLAS",true});
-  products.insert({"OSKI",true});
-  products.insert({"POSKI",true});
-  products.insert({"MKL",true});
-  products.insert({"YOURS",true});
+// Place blocks one after the other, shifting rows and/or columns: shifting
+// both builds a block-diagonal matrix, shifting rows only stacks vectors
+static Tensor<double> assembleBlocks(const vector<Tensor<double>>& blocks, Format format,
+                                     bool shiftRows, bool shiftCols) {
+  const bool isMatrix=blocks[0].getOrder()==2;
+  int rows=shiftRows ? 0 : blocks[0].getDimension(0);
+  int cols=(shiftCols || !isMatrix) ? 0 : blocks[0].getDimension(1);
+  for (auto& block : blocks) {
+    if (shiftRows)
+      rows+=block.getDimension(0);
+    if (shiftCols && isMatrix)
+      cols+=block.getDimension(1);
+  }
+  Tensor<double> dst=isMatrix ? Tensor<double>({rows,cols},format)
+                              : Tensor<double>({rows},format);
+  int rowOffset=0;
+  int colOffset=0;
+  for (auto& block : blocks) {
+    for (auto& value : iterate<double>(block)) {
+      if (isMatrix)
+        dst.insert({rowOffset+value.first.at(0),colOffset+value.first.at(1)},value.second);
+      else
+        dst.insert({rowOffset+value.first.at(0)},value.second);
+    }
+    if (shiftRows)
+      rowOffset+=block.getDimension(0);
+    if (shiftCols && isMatrix)
+      colOffset+=block.getDimension(1);
+  }
+  dst.pack();
+  return dst;
+}
 
-  if (argc < 2)
-    return reportError("no arguments", 3);
 
-  // Read Parameters
-  for (int i = 1; i < argc; i++) {
-    string arg = argv[i];
-    vector<string> argparts = util::split(arg, "=");
-    if (argparts.size() > 2) {
-      return reportError("Too many '\"' signs in argument", 5);
-    }
-    string argName = argparts[0];
-    string argValue;
-    if (argparts.size() == 2)
-      argValue = argparts[1];
+// Matricize B(i,j,k) into the CSR matrix B(i*dim2+j,k), so that B(i,j,k)*x(k)
+// is the SpMV of this matrix with x
+static Tensor<double> matricize(const Tensor<double>& B) {
+  int dim2=B.getDimension(1);
+  Tensor<double> dst({B.getDimension(0)*dim2,B.getDimension(2)},CSR);
+  for (auto& value : iterate<double>(B))
+    dst.insert({value.first.at(0)*dim2+value.first.at(1),value.first.at(2)},value.second);
+  dst.pack();
+  return dst;
+}
 
-    if ("-E" == argName) {
-      try {
-        Expression=stoi(argValue);
-        if (Expression==1)
-          Expr=SpMV;
-        else if(Expression==2)
-          Expr=PLUS3;
-        else if(Expression==3)
-          Expr=MATTRANSMUL;
-        else if(Expression==4)
-          Expr=RESIDUAL;
-        else if(Expression==5)
-          Expr=SDDMM;
-        else if(Expression==6)
-          Expr=SparsitySpMV;
-        else if(Expression==7)
-          Expr=SparsityTTV;
-        else if(Expression==8)
-          Expr=SparsitySpMDM;
-        else
-          return reportError("Incorrect Expression descriptor", 3);
-      }
-      catch (...) {
-        return reportError("Incorrect Expression descriptor", 3);
-      }
-    }
-    else if ("-i" == argName) {
-      vector<string> descriptor = util::split(argValue, ":");
-      if (descriptor.size() != 2) {
-        return reportError("Incorrect -i usage", 3);
-      }
-      string tensorName = descriptor[0];
-      string fileName  = descriptor[1];
-      inputFilenames.insert({tensorName,fileName});
-    }
-    else if ("-p" == argName) {
-      vector<string> descriptor = util::split(argValue, ",");
-      if (descriptor.size() > products.size()) {
-        return reportError("Incorrect -p usage", 3);
-      }
-      for (auto &product : products ) {
-        product.second=false;
-      }
-      for(int i=0; i<descriptor.size();i++) {
-        for (auto & c: descriptor[i]) c = toupper(c);
-        products.at(descriptor[i])=true;
-      }
-    }
-    else if ("-r" == argName) {
-      try {
-        repeat=stoi(argValue);
-      }
-      catch (...) {
-        return reportError("Incorrect repeat descriptor", 3);
-      }
+// Flatten a matrix A(i,j) into the dense vector A(i*cols+j)
+static Tensor<double> flatten(const Tensor<double>& A) {
+  int cols=A.getDimension(1);
+  Tensor<double> dst({A.getDimension(0)*cols},Dense);
+  for (auto& value : iterate<double>(A))
+    dst.insert({value.first.at(0)*cols+value.first.at(1)},value.second);
+  dst.pack();
+  return dst;
+}
+
+// Name of the operand holding the taco result of an expression
+static string referenceOperand(BenchExpr Expr) {
+  switch(Expr) {
+    case PLUS3:
+    case SDDMM:
+    case BatchSDDMM:
+      return "ARef";
+    case SparsitySpMDM:
+      return "CRef";
+    default:
+      return "yRef";
+  }
+}
+
+// Benchmark a product on the operands of an expression, through its own bench
+// or by timing its conversion, setup and computation phases
+static void runProduct(const Product& product, BenchExpr Expr,
+                       const OperandStore& exprOperands, Precision precision,
+                       int repeat, taco::util::TimeResults timevalue,
+                       const map<string,string>& parameters) {
+  if (!product.supports(Expr)) {
+    cout << " !! Expression not implemented for " << product.name << endl;
+    return;
+  }
+  if (precision!=F64 && !product.singlePrecision) {
+    cout << " !! " << product.name << " only supports double precision" << endl;
+    return;
+  }
+  int threads=1;
+#ifdef _OPENMP
+  if (product.multithreaded)
+    threads=omp_get_max_threads();
+#endif
+  ProductRun run(Expr,exprOperands,precision,repeat,threads,parameters);
+  benchPhaseThreads=product.multithreaded ? allBenchThreads : 1;
+  if (product.bench) {
+    product.bench(run,timevalue);
+    benchPhaseThreads=allBenchThreads;
+    return;
+  }
+  if (product.convert)
+    TACO_BENCH(product.convert(run);,"\n"+product.name+" conversion",1,timevalue,false)
+  if (product.setup)
+    TACO_BENCH(product.setup(run);,product.name+" setup",1,timevalue,false)
+  if (product.run)
+    TACO_BENCH(product.run(run);,product.name,repeat,timevalue,true)
+  if (product.teardown)
+    product.teardown(run);
+  benchPhaseThreads=allBenchThreads;
+
+  string reference=referenceOperand(Expr);
+  if (run.hasResult && exprOperands.count(reference))
+    validate(product.name,run.result,exprOperands.at(reference),tolerance(precision));
+}
+
+// Benchmark all the selected products on the operands of an expression
+static void runProducts(BenchExpr Expr, const map<string,Tensor<double>>& exprOperands,
+                        const vector<string>& products, Precision precision,
+                        int repeat, taco::util::TimeResults timevalue,
+                        const map<string,string>& parameters) {
+  // Conversions of the operands are shared by all the products of this run
+  OperandStore operands(exprOperands);
+  benchPhaseThreads=allBenchThreads;
+  for (auto& product : productRegistry()) {
+    if (std::find(products.begin(),products.end(),product.name)!=products.end())
+      runProduct(product,Expr,operands,precision,repeat,timevalue,parameters);
+  }
+}
+
+// Register the products of a shared object exporting registerTacoBenchProducts
+static bool loadProducts(string filename) {
+  void* library=dlopen(filename.c_str(),RTLD_NOW|RTLD_LOCAL);
+  if (!library) {
+    cerr << "Error: cannot load " << filename << ": " << dlerror() << endl;
+    return false;
+  }
+  RegisterProductsFunction registerProducts=
+      (RegisterProductsFunction)dlsym(library,TACO_BENCH_REGISTER_SYMBOL);
+  if (!registerProducts) {
+    cerr << "Error: " << filename << " does not export " << TACO_BENCH_REGISTER_SYMBOL << endl;
+    dlclose(library);
+    return false;
+  }
+  // The library stays loaded as the registry holds its hooks
+  registerProducts(productRegistry());
+  return true;
+}
+
+// Expression of an Id of -E
+static bool expressionFromId(int Expression, BenchExpr& Expr) {
+  const BenchExpr expressions[]={SpMV, PLUS3, MATTRANSMUL, RESIDUAL, SDDMM,
+                                 SparsitySpMV, SparsityTTV, SparsitySpMDM, SpTRSV, MULTANDTRANS,
+                                 MATPOW};
+  if (Expression < 1 || Expression > 11)
+    return false;
+  Expr=expressions[Expression-1];
+  return true;
+}
+
+// Id of -E for the name of an expression, 0 if unknown
+static int expressionId(string name) {
+  for (int Expression=1; ; Expression++) {
+    BenchExpr Expr;
+    if (!expressionFromId(Expression,Expr))
+      return 0;
+    if (name==benchExprNames[Expr])
+      return Expression;
+  }
+}
+
+// Tensors read from files. A suite keeps them between entries on the same
+// matrices, so that each file is only parsed once per format.
+struct CachedTensor {
+  string filename;
+  Format format;
+  Tensor<double> tensor;
+};
+static bool cacheTensors=false;
+static vector<CachedTensor> tensorCache;
+
+static Tensor<double> readTensor(string filename, Format format) {
+  for (auto& cached : tensorCache)
+    if (cached.filename==filename && cached.format==format)
+      return cached.tensor;
+  Tensor<double> tensor=read(filename,format,true);
+  if (cacheTensors)
+    tensorCache.push_back({filename,format,tensor});
+  return tensor;
+}
+
+// Products with a symmetric mode get the stored triangle of a symmetric A
+static void insertLowerTriangle(string filename, map<string,Tensor<double>>& exprOperands) {
+  if (!isSymmetricMtx(filename))
+    return;
+  exprOperands.insert({"ALower",readLowerTriangle(filename)});
+  cout << endl << "A is symmetric: products with a symmetric mode read its lower triangle" << endl;
+}
+
+// SDDMM in taco with the row-major and column-major combinations of C and D
+// other than the default row-major C and column-major D
+static void benchTacoSDDMMLayouts(Tensor<double> B, const Tensor<double>& C,
+                                  const Tensor<double>& D, const Tensor<double>& ARef,
+                                  int repeat, taco::util::TimeResults timevalue) {
+  for (DenseLayout lc : {RowMajorLayout,ColMajorLayout}) {
+    for (DenseLayout ld : {RowMajorLayout,ColMajorLayout}) {
+      if (lc==RowMajorLayout && ld==ColMajorLayout)
+        continue;
+      string layouts="CSC, C "+denseLayoutNames[lc]+", D "+denseLayoutNames[ld];
+      cout << endl << "A=B o (CxD) -- " << layouts << endl;
+      setBenchContext(layouts,"");
+      Tensor<double> CLayout=convertTensor(C,layoutFormat(lc));
+      Tensor<double> DLayout=convertTensor(D,layoutFormat(ld));
+      Tensor<double> A({B.getDimension(0),B.getDimension(1)},CSC);
+
+      IndexVar i, j, k;
+      A(i,k) = CLayout(i,j)*DLayout(j,k)*B(i,k);
+      TACO_BENCH(A.compile();, "Compile",1,timevalue,false)
+      TACO_BENCH(A.assemble();,"Assemble",1,timevalue,false)
+      TACO_BENCH(A.compute();, "Compute",repeat, timevalue, true)
+      validate("taco", A, ARef, reassociationTolerance);
     }
-    if ("-s" == argName) {
-      try {
-        size=stoi(argValue);
-      }
-      catch (...) {
-        return reportError("Incorrect repeat descriptor", 3);
-      }
+  }
+}
+
+// SparsitySpMDM in taco on a CSR A with the row-major and column-major
+// combinations of B and C other than the default row-major ones
+static void benchTacoSpMDMLayouts(Tensor<double> A, const Tensor<double>& B,
+                                  const Tensor<double>& CRef, string level, CrossoverTable& crossover,
+                                  int repeat, taco::util::TimeResults timevalue) {
+  int rows=A.getDimension(0);
+  int cols=B.getDimension(1);
+  for (DenseLayout lb : {RowMajorLayout,ColMajorLayout}) {
+    Tensor<double> BLayout=convertTensor(B,layoutFormat(lb));
+    for (DenseLayout lc : {RowMajorLayout,ColMajorLayout}) {
+      if (lb==RowMajorLayout && lc==RowMajorLayout)
+        continue;
+      string layouts="CSR, B "+denseLayoutNames[lb]+", C "+denseLayoutNames[lc];
+      cout << endl << "C(i, j) = A(i, k) * B(k, j) -- " << layouts << " -- " << level << endl;
+      setBenchContext(layouts,level);
+      Tensor<double> C({rows,cols},layoutFormat(lc));
+
+      IndexVar i, j, k;
+      C(i, j) = A(i, k) * BLayout(k, j);
+      TACO_BENCH(C.compile();, "Compile",1,timevalue,false)
+      TACO_BENCH(C.assemble();,"Assemble",1,timevalue,false)
+      TACO_BENCH(C.compute();, "Compute",repeat, timevalue, true)
+      crossover.add("taco "+layouts,level,timevalue.mean);
+      validate("taco", C, CRef, reassociationTolerance);
     }
   }
+}
 
-  // Check products
-#ifndef EIGEN
-  CHECK_PRODUCT("EIGEN");
-#endif
-#ifndef UBLAS
-  CHECK_PRODUCT("UBLAS");
-#endif
-#ifndef GMM
-  CHECK_PRODUCT("GMM");
-#endif
-#ifndef MKL
-  CHECK_PRODUCT("MKL");
-#endif
-#ifndef POSKI
-  CHECK_PRODUCT("POSKI");
-#endif
-#ifndef OSKI
-  CHECK_PRODUCT("OSKI");
-#endif
-#ifndef YOURS
-  CHECK_PRODUCT("YOURS");
-#endif
+// Options of a run, shared by all the expressions it benchmarks
+struct BenchOptions {
+  int repeat;
+  int size;
+  int Ksize;
+  string batchDescriptor;
+  Precision precision;
+  vector<string> products;
+  map<string,string> parameters;
+};
+
+// Store the results of this run and compare them to a baseline, giving the
+// exit code of taco-bench
+static int finishBench(string resultsFilename, string baselineFilename, double threshold) {
+  const double significance=0.05;
+  if (!resultsFilename.empty() && !writeResults(resultsFilename,benchResults))
+    cerr << "Error: cannot write the results file " << resultsFilename << endl;
+  if (baselineFilename.empty())
+    return 0;
+  int regressions=compareToBaseline(baselineFilename,benchResults,threshold,significance);
+  if (regressions == -1) {
+    cerr << "Error: cannot read the baseline " << baselineFilename << endl;
+    return 6;
+  }
+  if (regressions == -2) {
+    cerr << "Error: no phase could be tested against the baseline " << baselineFilename
+         << ": both runs need matching phases with -r=" << minBaselineSamples << " or more" << endl;
+    return 7;
+  }
+  return regressions > 0 ? 1 : 0;
+}
+
+// Benchmark taco then the products on one expression
+static int benchExpression(BenchExpr Expr, const map<string,string>& inputFilenames,
+                           const BenchOptions& options) {
+  int repeat=options.repeat;
+  int size=options.size;
+  int Ksize=options.Ksize;
+  const string& batchDescriptor=options.batchDescriptor;
+  Precision precision=options.precision;
+  const vector<string>& products=options.products;
+  const map<string,string>& parameters=options.parameters;
+  map<string,Tensor<double>> exprOperands;
+  taco::util::TimeResults timevalue;
+  // taco compiles serial kernels
+  benchPhaseThreads=1;
 
   // taco Formats and sparsities
   map<string,Format> TacoFormats;
   std::vector<double> Sparsities {0.95,0.9,0.85,0.8,0.75,0.7,0.65,0.6,0.55,0.5,
                                   0.4,0.3,0.2,0.1,0.05,0.01,0.001};
+  // Sparsity sweeps run the products at each level and tabulate them here.
+  // Products get the sparse operand in CSR, plus its dense storage
+  // (ADense) on the dense level only.
+  CrossoverTable crossover;
 
   switch(Expr) {
     case SpMV: {
@@ -243,40 +577,62 @@ int main(int argc, char* argv[]) {
       Tensor<double> x({cols}, Dense);
       util::fillTensor(x,util::FillMethod::Dense);
       Tensor<double> yRef({rows}, Dense);
-      Tensor<double> A=read(inputFilenames.at("A"),CSR,true);
+      Tensor<double> A=readTensor(inputFilenames.at("A"),CSR);
       IndexVar i, j;
       yRef(i) = A(i,j) * x(j);
       yRef.compile();
       yRef.assemble();
       yRef.compute();
 
+      // A precompiled CSR kernel is the baseline taco compilation has to pay
+      // back against. taco compiles a serial kernel, so the baseline runs on
+      // one thread whatever the thread count and -partition are.
+      taco::util::TimeResults precompiledTime;
+      {
+        cout << endl << "y(i) = A(i,j)*x(j) -- precompiled CSR" << endl;
+        setBenchContext(precompiledCSRContext,"");
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        getCSRArrays(A,&ia_CSR,&ja_CSR,&a_CSR);
+        vector<double> xvals, yvals(rows);
+        tacoToVector(x,xvals);
+        RowPartition serial=partitionCSR("rows",rows,ia_CSR,1);
+        TACO_BENCH(partitionedSpMV(serial,ia_CSR,ja_CSR,a_CSR,xvals.data(),1.0,0.0,xvals.data(),yvals.data());,
+                   "Compute",repeat,precompiledTime,true)
+      }
+
       TacoFormats.insert({"CSR",CSR});
       TacoFormats.insert({"CSC",CSC});
       TacoFormats.insert({"Sparse,Sparse",Format({Sparse,Sparse})});
       for (auto& formats:TacoFormats) {
         cout << endl << "y(i) = A(i,j)*x(j) -- " << formats.first <<endl;
-        Tensor<double> A=read(inputFilenames.at("A"),formats.second,true);
+        setBenchContext(formats.first,"");
+        Tensor<double> A=readTensor(inputFilenames.at("A"),formats.second);
         Tensor<double> y({rows}, Dense);
 
         y(i) = A(i,j) * x(j);
 
-        TACO_BENCH(y.compile();, "Compile",1,timevalue,false)
-        TACO_BENCH(y.assemble();,"Assemble",1,timevalue,false)
+        taco::util::TimeResults compileTime, assembleTime;
+        TACO_BENCH(y.compile();, "Compile",1,compileTime,false)
+        TACO_BENCH(y.assemble();,"Assemble",1,assembleTime,false)
         TACO_BENCH(y.compute();, "Compute",repeat, timevalue, true)
+        reportBreakEven("taco "+formats.first, compileTime.mean+assembleTime.mean, precompiledTime, timevalue);
 
         validate("taco", y, yRef);
       }
       exprOperands.insert({"yRef",yRef});
       exprOperands.insert({"A",A});
       exprOperands.insert({"x",x});
+      insertLowerTriangle(inputFilenames.at("A"),exprOperands);
       break;
     }
     case PLUS3: {
       int rows,cols;
       readMatrixSize(inputFilenames.at("B"),rows,cols);
-      Tensor<double> B=read(inputFilenames.at("B"),CSC,true);
-      Tensor<double> C=read(inputFilenames.at("C"),CSC,true);
-      Tensor<double> D=read(inputFilenames.at("D"),CSC,true);
+      Tensor<double> B=readTensor(inputFilenames.at("B"),CSC);
+      Tensor<double> C=readTensor(inputFilenames.at("C"),CSC);
+      Tensor<double> D=readTensor(inputFilenames.at("D"),CSC);
       Tensor<double> ARef("ARef",{rows,cols},CSC);
       B.setName("B");
       C.setName("C");
@@ -291,9 +647,10 @@ int main(int argc, char* argv[]) {
       TacoFormats.insert({"CSC",CSC});
       for (auto& formats:TacoFormats) {
         cout << endl << "A(i,j) = B(i,j) + C(i,j) + D(i,j) -- " << formats.first <<endl;
-        B=read(inputFilenames.at("B"),formats.second,true);
-        C=read(inputFilenames.at("C"),formats.second,true);
-        D=read(inputFilenames.at("D"),formats.second,true);
+        setBenchContext(formats.first,"");
+        B=readTensor(inputFilenames.at("B"),formats.second);
+        C=readTensor(inputFilenames.at("C"),formats.second);
+        D=readTensor(inputFilenames.at("D"),formats.second);
         B.setName("B");
         C.setName("C");
         D.setName("D");
@@ -308,9 +665,9 @@ int main(int argc, char* argv[]) {
         validate("taco", A, ARef);
       }
       // get CSC arrays for other products
-      B=read(inputFilenames.at("B"),CSC,true);
-      C=read(inputFilenames.at("C"),CSC,true);
-      D=read(inputFilenames.at("D"),CSC,true);
+      B=readTensor(inputFilenames.at("B"),CSC);
+      C=readTensor(inputFilenames.at("C"),CSC);
+      D=readTensor(inputFilenames.at("D"),CSC);
 
       exprOperands.insert({"ARef",ARef});
       exprOperands.insert({"B",B});
@@ -329,7 +686,7 @@ int main(int argc, char* argv[]) {
       Tensor<double> Talpha("alpha");
       Tensor<double> Tbeta("beta");
       Tensor<double> yRef({rows}, Dense);
-      Tensor<double> A=read(inputFilenames.at("A"),CSC,true);
+      Tensor<double> A=readTensor(inputFilenames.at("A"),CSC);
       IndexVar i, j;
       Talpha.insert({}, 42.0);
       Tbeta.insert({}, 24.0);
@@ -338,7 +695,7 @@ int main(int argc, char* argv[]) {
       if (Expr==RESIDUAL) {
         ((double*)(Talpha.getStorage().getValues().getData()))[0] = -1.0;
         ((double*)(Tbeta.getStorage().getValues().getData()))[0] = 1.0;
-        A=read(inputFilenames.at("A"),CSR,true);
+        A=readTensor(inputFilenames.at("A"),CSR);
         yRef(i) = z(i) -(A(i,j) * x(j)) ;
         cout << endl << "y= b - Ax -- " << endl;
       }
@@ -346,6 +703,7 @@ int main(int argc, char* argv[]) {
         yRef(i) = Talpha() * (A(j,i) * x(j)) + Tbeta() * z(i);
         cout << "y=alpha*A^Tx + beta*z -- " << endl;
       }
+      setBenchContext(Expr==RESIDUAL ? "CSR" : "CSC","");
       TACO_BENCH(yRef.compile();, "Compile",1,timevalue,false)
       TACO_BENCH(yRef.assemble();, "Assemble",1,timevalue,false)
       TACO_BENCH(yRef.compute();, "Compute",repeat,timevalue,true)
@@ -356,15 +714,77 @@ int main(int argc, char* argv[]) {
       exprOperands.insert({"z",z});
       exprOperands.insert({"alpha",Talpha});
       exprOperands.insert({"beta",Tbeta});
+      insertLowerTriangle(inputFilenames.at("A"),exprOperands);
+      break;
+    }
+    case MULTANDTRANS: {
+      int rows,cols;
+      readMatrixSize(inputFilenames.at("A"),rows,cols);
+      Tensor<double> x({cols}, Dense);
+      util::fillTensor(x,util::FillMethod::Dense);
+      Tensor<double> w({rows}, Dense);
+      util::fillTensor(w,util::FillMethod::Dense);
+      Tensor<double> yRef({rows}, Dense);
+      Tensor<double> tRef({cols}, Dense);
+      Tensor<double> A=readTensor(inputFilenames.at("A"),CSR);
+      Tensor<double> AT=readTensor(inputFilenames.at("A"),CSC);
+      IndexVar i, j;
+      // taco computes one tensor per expression: A is streamed once in CSR
+      // for y and once in CSC for t
+      yRef(i) = A(i,j) * x(j);
+      tRef(j) = AT(i,j) * w(i);
+      cout << endl << "y(i) = A(i,j)*x(j) and t(j) = A(i,j)*w(i) -- " << endl;
+      setBenchContext("CSR+CSC","");
+      TACO_BENCH(yRef.compile(); tRef.compile();, "Compile",1,timevalue,false)
+      TACO_BENCH(yRef.assemble(); tRef.assemble();,"Assemble",1,timevalue,false)
+      TACO_BENCH(yRef.compute(); tRef.compute();, "Compute",repeat,timevalue,true)
+
+      exprOperands.insert({"yRef",yRef});
+      exprOperands.insert({"tRef",tRef});
+      exprOperands.insert({"A",A});
+      exprOperands.insert({"x",x});
+      exprOperands.insert({"w",w});
+      break;
+    }
+    case MATPOW: {
+      int rows,cols;
+      readMatrixSize(inputFilenames.at("A"),rows,cols);
+      if (rows!=cols)
+        return reportError("MATPOW requires a square matrix", 3);
+      int power=matrixPower(parameters);
+      Tensor<double> x({cols}, Dense);
+      util::fillTensor(x,util::FillMethod::Dense);
+      Tensor<double> A=readTensor(inputFilenames.at("A"),CSR);
+      // One SpMV per power, chaining k compiled expressions so that each
+      // reads the vector the previous one wrote
+      vector<Tensor<double>> powers;
+      IndexVar i, j;
+      for (int l=1; l<=power; l++) {
+        powers.push_back(Tensor<double>({rows}, Dense));
+        if (l==1)
+          powers[0](i) = A(i,j) * x(j);
+        else
+          powers[l-1](i) = A(i,j) * powers[l-2](j);
+      }
+      cout << endl << "y(i) = A^" << power << "(i,j)*x(j) -- CSR" << endl;
+      setBenchContext("CSR","");
+      TACO_BENCH(for (auto& p : powers) p.compile();, "Compile",1,timevalue,false)
+      TACO_BENCH(for (auto& p : powers) p.assemble();,"Assemble",1,timevalue,false)
+      TACO_BENCH(for (auto& p : powers) p.compute();, "Compute",repeat,timevalue,true)
+      cout << "taco time per power (ms)" << endl << timevalue.mean/power << endl;
+      Tensor<double> yRef=powers.back();
+
+      exprOperands.insert({"yRef",yRef});
+      exprOperands.insert({"A",A});
+      exprOperands.insert({"x",x});
       break;
     }
     case SDDMM: {
       int rows,cols;
       readMatrixSize(inputFilenames.at("B"),rows,cols);
-      Tensor<double> B=read(inputFilenames.at("B"),CSC,true);
+      Tensor<double> B=readTensor(inputFilenames.at("B"),CSC);
       Tensor<double> ARef("ARef",{rows,cols},CSC);
 
-      int Ksize=100;
       Tensor<double> C("C",{rows,Ksize},Dense);
       util::fillTensor(C,util::FillMethod::Dense);
       Format densedenseColMajorMatrixFormat({Dense, Dense},{1,0});
@@ -374,10 +794,13 @@ int main(int argc, char* argv[]) {
       IndexVar i, j, k;
       ARef(i,k) = C(i,j)*D(j,k)*B(i,k);
       cout << endl << "A=B o (CxD) -- " << endl;
+      setBenchContext("CSC","");
 
       TACO_BENCH(ARef.compile();, "Compile",1,timevalue,false)
       TACO_BENCH(ARef.assemble();,"Assemble",1,timevalue,false)
       TACO_BENCH(ARef.compute();, "Compute",repeat, timevalue, true)
+      if (sweepLayouts(parameters))
+        benchTacoSDDMMLayouts(B,C,D,ARef,repeat,timevalue);
 
       exprOperands.insert({"ARef",ARef});
       exprOperands.insert({"B",B});
@@ -407,13 +830,16 @@ int main(int argc, char* argv[]) {
       yRef.compile();
       yRef.assemble();
       cout << endl << "y(i) = alpha*A(i,j)*x(j) + beta*z(i) -- Dense,Dense -- DENSE" << endl;
+      setBenchContext("Dense,Dense","DENSE");
       TACO_BENCH(yRef.compute();, "Compute",repeat, timevalue, true)
+      crossover.add("taco Dense,Dense","DENSE",timevalue.mean);
 
       // TacoFormats.insert({"CSR",CSR});
       // TacoFormats.insert({"Sparse,Dense",Format({Sparse,Dense})});
       TacoFormats.insert({"Sparse,Sparse",Format({Sparse,Sparse})});
       for (auto& formats:TacoFormats) {
         cout << endl << "y(i) = alpha*A(i,j)*x(j) + beta*z(i) -- " << formats.first << " -- DENSE" << endl;
+        setBenchContext(formats.first,"DENSE");
         Tensor<double> B({rows,cols},formats.second);
         for (auto& value : iterate<double>(A)) {
           B.insert({value.first.at(0),value.first.at(1)},value.second);
@@ -426,15 +852,34 @@ int main(int argc, char* argv[]) {
         TACO_BENCH(y.compile();, "Compile",1,timevalue,false)
         TACO_BENCH(y.assemble();,"Assemble",1,timevalue,false)
         TACO_BENCH(y.compute();, "Compute",repeat, timevalue, true)
+        crossover.add("taco "+formats.first,"DENSE",timevalue.mean);
 
         validate("taco", y, yRef);
       }
 
+      map<string,Tensor<double>> sweepOperands;
+      sweepOperands["x"]=x;
+      sweepOperands["z"]=z;
+      sweepOperands["alpha"]=Talpha;
+      sweepOperands["beta"]=Tbeta;
+      sweepOperands["A"]=convertTensor(A,CSR);
+      sweepOperands["ADense"]=A;
+      sweepOperands["yRef"]=yRef;
+      cout << endl << "y(i) = alpha*A(i,j)*x(j) + beta*z(i) -- products -- DENSE" << endl;
+      setBenchContext("products","DENSE");
+      size_t firstResult=benchResults.size();
+      runProducts(Expr,sweepOperands,products,precision,repeat,timevalue,parameters);
+      crossover.addResults(firstResult,"DENSE");
+      sweepOperands.erase("ADense");
+
       for (auto sparsity:Sparsities) {
+        string level=CrossoverTable::level(sparsity);
         Tensor<double> B({rows,cols},DCSR);
         util::fillMatrix(B,util::FillMethod::Random,sparsity);
+        Tensor<double> ySparsityRef;
         for (auto& formats:TacoFormats) {
           cout << endl << "y(i) = alpha*A(i,j)*x(j) + beta*z(i) -- " << formats.first << " -- " << sparsity << endl;
+          setBenchContext(formats.first,CrossoverTable::level(sparsity));
           Tensor<double> Btmp({rows,cols},formats.second);
           if (formats.second==B.getFormat()) {
             Btmp = B;
@@ -452,11 +897,19 @@ int main(int argc, char* argv[]) {
           TACO_BENCH(y.compile();, "Compile",1,timevalue,false)
           TACO_BENCH(y.assemble();,"Assemble",1,timevalue,false)
           TACO_BENCH(y.compute();, "Compute",repeat, timevalue, true)
+          reportGFLOPS("taco "+formats.first,2.0*B.getStorage().getValues().getSize(),timevalue);
+          crossover.add("taco "+formats.first,level,timevalue.mean);
+          ySparsityRef=y;
         }
+
+        sweepOperands["A"]=convertTensor(B,CSR);
+        sweepOperands["yRef"]=ySparsityRef;
+        cout << endl << "y(i) = alpha*A(i,j)*x(j) + beta*z(i) -- products -- " << sparsity << endl;
+        setBenchContext("products",CrossoverTable::level(sparsity));
+        firstResult=benchResults.size();
+        runProducts(Expr,sweepOperands,products,precision,repeat,timevalue,parameters);
+        crossover.addResults(firstResult,level);
       }
-      exprOperands.insert({"yRef",yRef});
-      exprOperands.insert({"A",A});
-      exprOperands.insert({"x",x});
       break;
     }
     case SparsityTTV: {
@@ -474,7 +927,9 @@ int main(int argc, char* argv[]) {
       ARef.compile();
       ARef.assemble();
       cout << endl << "A(i,j) = B(i,j,k)*x(k) -- Dense,Dense,Dense -- DENSE" << endl;
+      setBenchContext("Dense,Dense,Dense","DENSE");
       TACO_BENCH(ARef.compute();, "Compute",repeat, timevalue, true)
+      crossover.add("taco Dense,Dense,Dense","DENSE",timevalue.mean);
 
       TacoFormats.insert({"Sparse,Sparse,Sparse",Format({Sparse,Sparse,Sparse})});
       // TacoFormats.insert({"Sparse,Sparse,Dense",Format({Sparse,Sparse,Dense})});
@@ -486,6 +941,7 @@ int main(int argc, char* argv[]) {
 
       for (auto& formats:TacoFormats) {
         cout << endl << "A(i,j) = B(i,j,k)*x(k) -- " << formats.first << " -- DENSE" << endl;
+        setBenchContext(formats.first,"DENSE");
         Tensor<double> Btmp({dim1,dim2,dim3},formats.second);
         for (auto& value : iterate<double>(B)) {
           Btmp.insert({value.first.at(0),value.first.at(1),value.first.at(2)},value.second);
@@ -498,15 +954,34 @@ int main(int argc, char* argv[]) {
         TACO_BENCH(A.compile();, "Compile",1,timevalue,false)
         TACO_BENCH(A.assemble();,"Assemble",1,timevalue,false)
         TACO_BENCH(A.compute();, "Compute",repeat, timevalue, true)
+        crossover.add("taco "+formats.first,"DENSE",timevalue.mean);
 
         validate("taco", A, ARef);
       }
 
+      // Products compute the SpMV of the matricized B(i*dim2+j,k) with x,
+      // whose result is A flattened. B(i,j,k) is row-major so the dense
+      // storage of B is also the one of its matricization.
+      map<string,Tensor<double>> sweepOperands;
+      sweepOperands["x"]=x;
+      sweepOperands["A"]=matricize(B);
+      sweepOperands["ADense"]=B;
+      sweepOperands["yRef"]=flatten(ARef);
+      cout << endl << "A(i,j) = B(i,j,k)*x(k) -- products -- DENSE" << endl;
+      setBenchContext("products","DENSE");
+      size_t firstResult=benchResults.size();
+      runProducts(Expr,sweepOperands,products,precision,repeat,timevalue,parameters);
+      crossover.addResults(firstResult,"DENSE");
+      sweepOperands.erase("ADense");
+
       for (auto sparsity:Sparsities) {
+        string level=CrossoverTable::level(sparsity);
         Tensor<double> Bgen({dim1,dim2,dim3},Format({Sparse,Sparse,Sparse}));
         util::fillTensor(Bgen,util::FillMethod::Random,sparsity);
+        Tensor<double> ASparsityRef;
         for (auto& formats:TacoFormats) {
           cout << endl << "A(i,j) = B(i,j,k)*x(k) -- " << formats.first << " -- " << sparsity << endl;
+          setBenchContext(formats.first,CrossoverTable::level(sparsity));
           Tensor<double> A({dim1,dim2}, Format({Dense,Dense}));
           Tensor<double> Btmp({dim1,dim2,dim3},formats.second);
           if (formats.second == Bgen.getFormat()) {
@@ -524,11 +999,18 @@ int main(int argc, char* argv[]) {
           TACO_BENCH(A.compile();, "Compile",1,timevalue,false)
           TACO_BENCH(A.assemble();,"Assemble",1,timevalue,false)
           TACO_BENCH(A.compute();, "Compute",repeat, timevalue, true)
+          crossover.add("taco "+formats.first,level,timevalue.mean);
+          ASparsityRef=A;
         }
+
+        sweepOperands["A"]=matricize(Bgen);
+        sweepOperands["yRef"]=flatten(ASparsityRef);
+        cout << endl << "A(i,j) = B(i,j,k)*x(k) -- products -- " << sparsity << endl;
+        setBenchContext("products",CrossoverTable::level(sparsity));
+        firstResult=benchResults.size();
+        runProducts(Expr,sweepOperands,products,precision,repeat,timevalue,parameters);
+        crossover.addResults(firstResult,level);
       }
-      exprOperands.insert({"ARef",ARef});
-      exprOperands.insert({"B",B});
-      exprOperands.insert({"x",x});
       break;
     }
     case SparsitySpMDM: {
@@ -545,13 +1027,16 @@ int main(int argc, char* argv[]) {
       CRef(i, j) = A(i, k) * B(k, j);
       CRef.compile();
       CRef.assemble();
+      setBenchContext("Dense,Dense","DENSE");
       TACO_BENCH(CRef.compute();, "Compute",repeat, timevalue, true)
+      crossover.add("taco Dense,Dense","DENSE",timevalue.mean);
 
       TacoFormats.insert({"CSR",CSR});
       TacoFormats.insert({"Sparse,Sparse",Format({Sparse,Sparse})});
       TacoFormats.insert({"Sparse,Dense",Format({Sparse,Dense})});
       for (auto& formats:TacoFormats) {
         cout << endl << "C(i, j) = A(i, k) * B(k, j) -- " << formats.first << " -- DENSE" << endl;
+        setBenchContext(formats.first,"DENSE");
         Tensor<double> A2({rows,cols},formats.second);
         for (auto& value : iterate<double>(A)) {
           A2.insert({value.first.at(0),value.first.at(1)},value.second);
@@ -564,15 +1049,33 @@ int main(int argc, char* argv[]) {
         TACO_BENCH(C.compile();, "Compile",1,timevalue,false)
         TACO_BENCH(C.assemble();,"Assemble",1,timevalue,false)
         TACO_BENCH(C.compute();, "Compute",repeat, timevalue, true)
+        crossover.add("taco "+formats.first,"DENSE",timevalue.mean);
 
         validate("taco", C, CRef);
       }
 
+      map<string,Tensor<double>> sweepOperands;
+      sweepOperands["B"]=B;
+      sweepOperands["A"]=convertTensor(A,CSR);
+      sweepOperands["ADense"]=A;
+      sweepOperands["CRef"]=CRef;
+      if (sweepLayouts(parameters))
+        benchTacoSpMDMLayouts(sweepOperands["A"],B,CRef,"DENSE",crossover,repeat,timevalue);
+      cout << endl << "C(i, j) = A(i, k) * B(k, j) -- products -- DENSE" << endl;
+      setBenchContext("products","DENSE");
+      size_t firstResult=benchResults.size();
+      runProducts(Expr,sweepOperands,products,precision,repeat,timevalue,parameters);
+      crossover.addResults(firstResult,"DENSE");
+      sweepOperands.erase("ADense");
+
       for (auto sparsity:Sparsities) {
+        string level=CrossoverTable::level(sparsity);
         Tensor<double> A2({rows,cols},CSR);
         util::fillMatrix(A2,util::FillMethod::Random,sparsity);
+        Tensor<double> CSparsityRef({rows,cols}, Format({Dense,Dense}));
         for (auto& formats:TacoFormats) {
           cout << endl << "C(i, j) = A(i, k) * B(k, j) -- " << formats.first << " -- " << sparsity << endl;
+          setBenchContext(formats.first,CrossoverTable::level(sparsity));
           Tensor<double> A2tmp({rows,cols},formats.second);
           if (formats.second==CSR) {
             A2tmp = A2;
@@ -590,52 +1093,468 @@ int main(int argc, char* argv[]) {
           TACO_BENCH(C.compile();, "Compile",1,timevalue,false)
           TACO_BENCH(C.assemble();,"Assemble",1,timevalue,false)
           TACO_BENCH(C.compute();, "Compute",repeat, timevalue, true)
+          crossover.add("taco "+formats.first,level,timevalue.mean);
+          if (formats.second==CSR)
+            CSparsityRef=C;
         }
+        if (sweepLayouts(parameters))
+          benchTacoSpMDMLayouts(A2,B,CSparsityRef,level,crossover,repeat,timevalue);
+
+        sweepOperands["A"]=A2;
+        sweepOperands["CRef"]=CSparsityRef;
+        cout << endl << "C(i, j) = A(i, k) * B(k, j) -- products -- " << sparsity << endl;
+        setBenchContext("products",CrossoverTable::level(sparsity));
+        firstResult=benchResults.size();
+        runProducts(Expr,sweepOperands,products,precision,repeat,timevalue,parameters);
+        crossover.addResults(firstResult,level);
+      }
+      break;
+
+    }
+    case SpTRSV: {
+      int rows,cols;
+      readMatrixSize(inputFilenames.at("A"),rows,cols);
+      if (rows!=cols)
+        return reportError("SpTRSV requires a square matrix", 3);
+      Tensor<double> A=readTensor(inputFilenames.at("A"),CSR);
+      Tensor<double> L({rows,cols},CSR);
+      Tensor<double> U({rows,cols},CSR);
+      tacoToTriangular(A,L,U);
+      Tensor<double> b({rows}, Dense);
+      util::fillTensor(b,util::FillMethod::Dense);
+      double* bvals=(double*)(b.getStorage().getValues().getData());
+
+      vector<pair<string,bool>> triangles {{"L",true},{"U",false}};
+      for (auto& triangle:triangles) {
+        const Tensor<double>& T = triangle.second ? L : U;
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        getCSRArrays(T,&ia_CSR,&ja_CSR,&a_CSR);
+        cout << endl << triangle.first << " x = b -- CSR" << endl;
+        setBenchContext(triangle.first+" CSR","");
+
+        Tensor<double> xRef({rows}, Dense);
+        xRef.pack();
+        double* xRefvals=(double*)(xRef.getStorage().getValues().getData());
+        TACO_BENCH(sptrsvSerial(rows,ia_CSR,ja_CSR,a_CSR,bvals,xRefvals,triangle.second);,
+                   "Serial",repeat,timevalue,true)
+
+        LevelSets levels;
+        TACO_BENCH(levelSetAnalysis(rows,ia_CSR,ja_CSR,triangle.second,levels);,
+                   "Level-set analysis",1,timevalue,false)
+        cout << "levels: " << levels.numLevels()
+             << ", average level width: " << levels.averageWidth() << endl;
+
+        Tensor<double> x({rows}, Dense);
+        x.pack();
+        double* xvals=(double*)(x.getStorage().getValues().getData());
+        benchNextPhaseOn(allBenchThreads);
+        TACO_BENCH(sptrsvLevelSet(levels,ia_CSR,ja_CSR,a_CSR,bvals,xvals);,
+                   "Level-set",repeat,timevalue,true)
+
+        validate("Level-set", x, xRef);
+
+        exprOperands.insert({triangle.first,T});
+        exprOperands.insert({"x"+triangle.first+"Ref",xRef});
       }
-      exprOperands.insert({"CRef",CRef});
+      exprOperands.insert({"b",b});
+      break;
+    }
+    case BatchSpMV: {
+      vector<Tensor<double>> batch;
+      if (!loadBatch(batchDescriptor,size,CSR,batch))
+        return reportError("Incorrect -batch usage", 3);
+      int problems=batch.size();
+
+      IndexVar i, j;
+      vector<Tensor<double>> xs, ys;
+      for (auto& A : batch) {
+        Tensor<double> x({A.getDimension(1)}, Dense);
+        util::fillTensor(x,util::FillMethod::Dense);
+        Tensor<double> y({A.getDimension(0)}, Dense);
+        y(i) = A(i,j) * x(j);
+        xs.push_back(x);
+        ys.push_back(y);
+      }
+      Tensor<double> A=assembleBlocks(batch,CSR,true,true);
+      Tensor<double> x=assembleBlocks(xs,Format({Dense}),true,false);
+      Tensor<double> yRef({A.getDimension(0)}, Dense);
+      yRef(i) = A(i,j) * x(j);
+
+      cout << endl << "y(i) = A(i,j)*x(j) -- CSR -- batch of " << problems << endl;
+      setBenchContext("CSR","batch");
+      TACO_BENCH(for (auto& y : ys) y.compile();, "Compile",1,timevalue,false)
+      TACO_BENCH(for (auto& y : ys) y.assemble();,"Assemble",1,timevalue,false)
+      taco::util::TimeResults backToBack, blockDiagonal;
+      TACO_BENCH(for (auto& y : ys) y.compute();, "Back-to-back",repeat,backToBack,true)
+
+      yRef.compile();
+      yRef.assemble();
+      TACO_BENCH(yRef.compute();, "Block-diagonal",repeat,blockDiagonal,true)
+      reportBatch("taco",problems,backToBack,blockDiagonal);
+
+      validate("taco", assembleBlocks(ys,Format({Dense}),true,false), yRef);
+
+      for (int k=0; k<problems; k++) {
+        exprOperands.insert({"A"+to_string(k),batch[k]});
+        exprOperands.insert({"x"+to_string(k),xs[k]});
+        exprOperands.insert({"yRef"+to_string(k),ys[k]});
+      }
+      exprOperands.insert({"yRef",yRef});
       exprOperands.insert({"A",A});
-      exprOperands.insert({"B",B});
+      exprOperands.insert({"x",x});
       break;
+    }
+    case BatchSDDMM: {
+      vector<Tensor<double>> batch;
+      if (!loadBatch(batchDescriptor,size,CSC,batch))
+        return reportError("Incorrect -batch usage", 3);
+      int problems=batch.size();
 
+      Format densedenseColMajorMatrixFormat({Dense, Dense},{1,0});
+      IndexVar i, j, k;
+      vector<Tensor<double>> Cs, Ds, As;
+      for (auto& B : batch) {
+        int rows=B.getDimension(0);
+        int cols=B.getDimension(1);
+        Tensor<double> C({rows,Ksize},Dense);
+        util::fillTensor(C,util::FillMethod::Dense);
+        Tensor<double> D({Ksize,cols},densedenseColMajorMatrixFormat);
+        util::fillTensor(D,util::FillMethod::Dense);
+        Tensor<double> A({rows,cols},CSC);
+        A(i,k) = C(i,j)*D(j,k)*B(i,k);
+        Cs.push_back(C);
+        Ds.push_back(D);
+        As.push_back(A);
+      }
+      // B o (CxD) with a block-diagonal B only needs the diagonal blocks of
+      // CxD, so stacking the rows of C and the columns of D is enough
+      Tensor<double> B=assembleBlocks(batch,CSC,true,true);
+      Tensor<double> C=assembleBlocks(Cs,Format({Dense,Dense}),true,false);
+      Tensor<double> D=assembleBlocks(Ds,densedenseColMajorMatrixFormat,false,true);
+      Tensor<double> ARef({B.getDimension(0),B.getDimension(1)},CSC);
+      ARef(i,k) = C(i,j)*D(j,k)*B(i,k);
+
+      cout << endl << "A=B o (CxD) -- batch of " << problems << endl;
+      setBenchContext("CSC","batch");
+      TACO_BENCH(for (auto& A : As) A.compile();, "Compile",1,timevalue,false)
+      TACO_BENCH(for (auto& A : As) A.assemble();,"Assemble",1,timevalue,false)
+      taco::util::TimeResults backToBack, blockDiagonal;
+      TACO_BENCH(for (auto& A : As) A.compute();, "Back-to-back",repeat,backToBack,true)
+
+      ARef.compile();
+      ARef.assemble();
+      TACO_BENCH(ARef.compute();, "Block-diagonal",repeat,blockDiagonal,true)
+      reportBatch("taco",problems,backToBack,blockDiagonal);
+
+      validate("taco", assembleBlocks(As,CSC,true,true), ARef);
+
+      for (int p=0; p<problems; p++) {
+        exprOperands.insert({"B"+to_string(p),batch[p]});
+        exprOperands.insert({"C"+to_string(p),Cs[p]});
+        exprOperands.insert({"D"+to_string(p),Ds[p]});
+      }
+      exprOperands.insert({"ARef",ARef});
+      exprOperands.insert({"B",B});
+      exprOperands.insert({"C",C});
+      exprOperands.insert({"D",D});
+      break;
     }
     default: {
       return reportError("Unknown Expression", 3);
     }
   }
-#ifdef EIGEN
-  if (products.at("EIGEN")) {
-    exprToEIGEN(Expr,exprOperands,repeat,timevalue);
+  if (crossover.rows.empty()) {
+    setBenchContext("products","");
+    runProducts(Expr,exprOperands,products,precision,repeat,timevalue,parameters);
   }
-#endif
-#ifdef UBLAS
-  if (products.at("UBLAS")) {
-    exprToUBLAS(Expr,exprOperands,repeat,timevalue);
+  else
+    crossover.print("DENSE");
+  return 0;
+}
+
+// Benchmark every entry of a suite manifest, then tabulate the features of
+// each matrix with the fastest taco format and product on it
+static int benchSuite(string manifest, string tableFilename, const BenchOptions& options) {
+  vector<SuiteEntry> entries;
+  if (!readManifest(manifest,entries))
+    return reportError("Cannot read the suite manifest "+manifest, 3);
+  cacheTensors=true;
+  SuiteTable table;
+  for (auto& entry : entries) {
+    BenchExpr Expr;
+    if (!expressionFromId(entry.expression,Expr))
+      return reportError("Incorrect Expression descriptor in "+manifest, 3);
+    // Keep the tensors read for the previous entry only if this one uses them
+    bool sameInputs=true;
+    for (auto& cached : tensorCache) {
+      bool used=false;
+      for (auto& input : entry.inputFilenames)
+        used=used || input.second==cached.filename;
+      sameInputs=sameInputs && used;
+    }
+    if (!sameInputs)
+      tensorCache.clear();
+
+    // An entry that fails, on a file that cannot be read or a matrix the
+    // expression does not take, is recorded as failed and the suite goes on
+    string matrix="-";
+    MatrixFeatures features;
+    bool hasMatrix=false;
+    int error=0;
+    try {
+      for (string name : {"A","B"}) {
+        if (!hasMatrix && entry.inputFilenames.count(name)) {
+          matrix=entry.inputFilenames.at(name);
+          features=computeFeatures(readTensor(matrix,CSR));
+          hasMatrix=true;
+        }
+      }
+      cout << endl << "Suite entry " << benchExprNames[Expr] << " on " << matrix << endl;
+      benchContext.expr=benchExprNames[Expr];
+      size_t first=benchResults.size();
+      error=benchExpression(Expr,entry.inputFilenames,options);
+      if (!error)
+        table.add(matrix,benchExprNames[Expr],hasMatrix ? &features : NULL,first);
+    }
+    catch (std::exception& e) {
+      cerr << "Error: " << e.what() << endl;
+      error=3;
+    }
+    if (error) {
+      cerr << "Suite entry " << benchExprNames[Expr] << " on " << matrix << " failed" << endl;
+      tensorCache.clear();
+      table.addFailed(matrix,benchExprNames[Expr],hasMatrix ? &features : NULL);
+    }
   }
-#endif
-#ifdef GMM
-  if (products.at("GMM")) {
-    exprToGMM(Expr,exprOperands,repeat,timevalue);
+  tensorCache.clear();
+
+  cout << endl << "Suite table" << endl;
+  table.print(cout);
+  if (!tableFilename.empty()) {
+    ofstream file(tableFilename);
+    table.print(file);
   }
-#endif
-#ifdef MKL
-  if (products.at("MKL")) {
-    exprToMKL(Expr,exprOperands,repeat,timevalue);
+  return 0;
+}
+
+int main(int argc, char* argv[]) {
+  if (!checkMemoryPhase())
+    cerr << "Warning: the heap high-water of a phase depends on its repetitions, "
+         << "memory reports are unreliable" << endl;
+
+  int Expression=1;
+  BenchExpr Expr=SpMV;
+  int repeat=1;
+  int size = 100;
+  string batchDescriptor;
+  string suiteFilename;
+  string tableFilename;
+  string streamFilename;
+  string resultsFilename;
+  string baselineFilename;
+  double threshold=5.0;
+  int panelMB=64;
+  Precision precision=F64;
+  int sigma=256;
+  int Ksize=100;
+  map<string,string> inputFilenames;
+  taco::util::TimeResults timevalue;
+  vector<string> productNames;
+  vector<string> libraries;
+  // Every -name=value flag, handed to the products as their parameters
+  map<string,string> parameters;
+
+  if (argc < 2)
+    return reportError("no arguments", 3);
+
+  // Read Parameters
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+    vector<string> argparts = util::split(arg, "=");
+    if (argparts.size() > 2) {
+      return reportError("Too many '\"' signs in argument", 5);
+    }
+    string argName = argparts[0];
+    string argValue;
+    if (argparts.size() == 2)
+      argValue = argparts[1];
+    if (argName.size() > 1 && argName[0]=='-')
+      parameters[argName.substr(1)]=argValue;
+
+    if ("-E" == argName) {
+      try {
+        Expression=stoi(argValue);
+      }
+      catch (...) {
+        Expression=expressionId(argValue);
+      }
+      if (!expressionFromId(Expression,Expr))
+        return reportError("Incorrect Expression descriptor", 3);
+    }
+    else if ("-i" == argName) {
+      vector<string> descriptor = util::split(argValue, ":");
+      if (descriptor.size() != 2) {
+        return reportError("Incorrect -i usage", 3);
+      }
+      string tensorName = descriptor[0];
+      string fileName  = descriptor[1];
+      inputFilenames.insert({tensorName,fileName});
+    }
+    else if ("-p" == argName) {
+      productNames = util::split(argValue, ",");
+      if (productNames.empty()) {
+        return reportError("Incorrect -p usage", 3);
+      }
+    }
+    else if ("-load" == argName) {
+      for (auto& library : util::split(argValue, ","))
+        libraries.push_back(library);
+    }
+    else if ("-r" == argName) {
+      try {
+        repeat=stoi(argValue);
+      }
+      catch (...) {
+        return reportError("Incorrect repeat descriptor", 3);
+      }
+    }
+    if ("-s" == argName) {
+      try {
+        size=stoi(argValue);
+      }
+      catch (...) {
+        return reportError("Incorrect repeat descriptor", 3);
+      }
+    }
+    else if ("-k" == argName) {
+      try {
+        Ksize=stoi(argValue);
+      }
+      catch (...) {
+        return reportError("Incorrect Ksize descriptor", 3);
+      }
+      if (Ksize < 1)
+        return reportError("Incorrect Ksize descriptor", 3);
+    }
+    else if ("-batch" == argName) {
+      batchDescriptor=argValue;
+    }
+    else if ("-suite" == argName) {
+      suiteFilename=argValue;
+    }
+    else if ("-table" == argName) {
+      tableFilename=argValue;
+    }
+    else if ("-partition" == argName) {
+      if (argValue!="all" && !isPartitionStrategy(argValue))
+        return reportError("Incorrect partition descriptor", 3);
+    }
+    else if ("-results" == argName) {
+      resultsFilename=argValue;
+    }
+    else if ("-baseline" == argName) {
+      baselineFilename=argValue;
+    }
+    else if ("-threshold" == argName) {
+      try {
+        threshold=stod(argValue);
+      }
+      catch (...) {
+        return reportError("Incorrect threshold descriptor", 3);
+      }
+    }
+    else if ("-stream" == argName) {
+      streamFilename=argValue;
+    }
+    else if ("-panel" == argName) {
+      try {
+        panelMB=stoi(argValue);
+      }
+      catch (...) {
+        return reportError("Incorrect panel descriptor", 3);
+      }
+    }
+    else if ("-sigma" == argName) {
+      try {
+        sigma=stoi(argValue);
+      }
+      catch (...) {
+        return reportError("Incorrect sigma descriptor", 3);
+      }
+    }
+    else if ("-precision" == argName) {
+      if (argValue == "f64")
+        precision=F64;
+      else if (argValue == "f32")
+        precision=F32;
+      else if (argValue == "mixed")
+        precision=Mixed;
+      else
+        return reportError("Incorrect precision descriptor", 3);
+    }
   }
-#endif
-#ifdef POSKI
-  if (products.at("POSKI")) {
-    exprToPOSKI(Expr,exprOperands,repeat,timevalue);
+
+  if (!batchDescriptor.empty()) {
+    if (Expr==SpMV)
+      Expr=BatchSpMV;
+    else if (Expr==SDDMM)
+      Expr=BatchSDDMM;
+    else
+      return reportError("Batches are only supported for SpMV and SDDMM", 3);
   }
-#endif
-#ifdef OSKI
-  if (products.at("OSKI")) {
-    exprToOSKI(Expr,exprOperands,repeat,timevalue);
+
+  benchContext.expr=benchExprNames[Expr];
+
+  // Out-of-core SpMV, the matrix is never loaded in memory
+  if (!streamFilename.empty()) {
+    benchContext.expr=string("Stream")+benchExprNames[Expr];
+    if (Expr!=SpMV && Expr!=RESIDUAL)
+      return reportError("Streaming is only supported for SpMV and RESIDUAL", 3);
+    if (inputFilenames.count("A")) {
+      const int64_t MB=1024*1024;
+      bool converted;
+      TACO_BENCH(converted=writePanelFile(inputFilenames.at("A"),streamFilename,panelMB*MB,16*panelMB*MB);,
+                 "\nPanel conversion",1,timevalue,false);
+      if (!converted)
+        return reportError("Cannot convert "+inputFilenames.at("A")+" to panels", 3);
+    }
+    PanelFile panels;
+    if (!openPanelFile(streamFilename,panels))
+      return reportError("Cannot open the panel file "+streamFilename, 3);
+    Tensor<double> x({(int)panels.header.cols}, Dense);
+    util::fillTensor(x,util::FillMethod::Dense);
+    Tensor<double> z({(int)panels.header.rows}, Dense);
+    util::fillTensor(z,util::FillMethod::Dense);
+    benchStreamSpMV(panels,Expr==RESIDUAL,x,z,
+                    inputFilenames.count("A") ? inputFilenames.at("A") : "",repeat,timevalue);
+    close(panels.fd);
+    return finishBench(resultsFilename,baselineFilename,threshold);
   }
-#endif
-#ifdef YOURS
-  if (products.at("YOURS")) {
-    exprToYOURS(Expr,exprOperands,repeat,timevalue);
+
+  // Check products: all the registered ones when none is given
+  for (auto& library : libraries) {
+    if (!loadProducts(library))
+      return 4;
   }
-#endif
-}
+  vector<string> products;
+  if (productNames.empty()) {
+    for (auto& product : productRegistry())
+      products.push_back(product.name);
+  }
+  for (auto& name : productNames) {
+    if (Product* product=findProduct(name))
+      products.push_back(product->name);
+    else
+      cout << "taco-bench was not compiled with "<< name << " and will not use it" << endl;
+  }
+  parameters["sigma"]=to_string(sigma);
 
+  BenchOptions options={repeat,size,Ksize,batchDescriptor,precision,products,parameters};
+  int error=suiteFilename.empty() ? benchExpression(Expr,inputFilenames,options)
+                                  : benchSuite(suiteFilename,tableFilename,options);
+  if (error)
+    return error;
+  return finishBench(resultsFilename,baselineFilename,threshold);
+}
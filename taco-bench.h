@@ -1,25 +1,101 @@
 
 #include "taco.h"
+#include "memory-bench.h"
+#include "product-registry.h"
+
+#include <iomanip>
+#include <sstream>
 
 using namespace taco;
 using namespace std;
 
-// MACRO to benchmark some CODE with REPEAT times and COLD/WARM cache
-#define TACO_BENCH(CODE, NAME, REPEAT, TIMER, COLD) {               \
-    TACO_TIME_REPEAT(CODE, REPEAT, TIMER, COLD);                    \
-    cout << NAME << " time (ms)" << endl << TIMER << endl;  \
+// Format and sparsity level of the phases being benchmarked, recorded with
+// them so that runs can be matched against a baseline
+struct BenchContext {
+  string expr;
+  string format;
+  string sparsity;
+};
+BenchContext benchContext;
+
+void setBenchContext(string format, string sparsity) {
+  benchContext.format=format;
+  benchContext.sparsity=sparsity;
 }
 
-#define CHECK_PRODUCT(NAME) {                                   \
-    if (products.at(NAME)) {                                    \
-      cout << "taco-bench was not compiled with "<< NAME << " and will not use it" << endl; \
-      products.at(NAME)=false;                                  \
-    }                                                           \
+// Threads the benchmarked phases run on, allBenchThreads for all the threads
+// of the run: those of the code being benchmarked (taco, a product), unless
+// the next phase is given its own count with benchNextPhaseOn
+const int allBenchThreads=0;
+int benchPhaseThreads=allBenchThreads;
+int benchNextPhaseThreads=-1;
+
+void benchNextPhaseOn(int threads) {
+  benchNextPhaseThreads=threads;
 }
 
+// Every benchmarked phase in the order it ran, with the time of each
+// repetition, so that results can be tabulated once several runs are done
+struct BenchResult {
+  string name;
+  bool cold;
+  taco::util::TimeResults time;
+  BenchContext context;
+  vector<double> samples;
+  int threads;
+};
+vector<BenchResult> benchResults;
+
+void recordBenchResult(string name, bool cold, const taco::util::TimeResults& time,
+                       const vector<double>& samples) {
+  if (!name.empty() && name[0]=='\n')
+    name=name.substr(1);
+  int threads=(benchNextPhaseThreads>=0) ? benchNextPhaseThreads : benchPhaseThreads;
+  benchNextPhaseThreads=-1;
+  benchResults.push_back({name,cold,time,benchContext,samples,threads});
+}
 
-// Enum of possible expressions to Benchmark
-enum BenchExpr {SpMV, PLUS3, MATTRANSMUL, RESIDUAL, SDDMM, SparsitySpMV, SparsityTTV, SparsitySpMDM};
+// taco's Timer, giving access to the time of each repetition
+struct SampleTimer : public taco::util::Timer {
+  const vector<double>& samples() const {
+    return times;
+  }
+};
+
+// MACRO to benchmark some CODE with some untimed SETUP run before each of
+// the REPEAT repetitions and COLD/WARM cache, reporting the memory it
+// allocates next to its time. SETUP is used by products that update their
+// output in place (e.g. y = alpha*A*x + beta*y). Allocation tracking slows
+// down malloc and free, so the memory is measured on one more run of SETUP
+// and CODE after the timed ones, which is not timed.
+#define TACO_BENCH_SETUP(SETUP, CODE, NAME, REPEAT, TIMER, COLD) {  \
+    SampleTimer timer;                                              \
+    for (int i=0; i<REPEAT; i++) {                                  \
+      SETUP;                                                        \
+      if (COLD)                                                     \
+        timer.clear_cache();                                        \
+      timer.start();                                                \
+      CODE;                                                         \
+      timer.stop();                                                 \
+    }                                                               \
+    TIMER = timer.getResult();                                      \
+    cout << NAME << " time (ms)" << endl << TIMER << endl;  \
+    SETUP;                                                          \
+    startMemoryPhase();                                             \
+    resumeMemoryPhase(); CODE; pauseMemoryPhase();                  \
+    reportMemoryPhase();                                            \
+    recordBenchResult(NAME, COLD, TIMER, timer.samples());          \
+}
+
+// MACRO to benchmark some CODE with REPEAT times and COLD/WARM cache
+#define TACO_BENCH(CODE, NAME, REPEAT, TIMER, COLD)                 \
+    TACO_BENCH_SETUP(;, CODE, NAME, REPEAT, TIMER, COLD)
+
+// Expressions the SpMV products compute as y = alpha*A*x + beta*z, with alpha,
+// beta and z in the operands, instead of y = A*x
+bool hasAlphaBeta(BenchExpr Expr) {
+  return Expr==MATTRANSMUL || Expr==RESIDUAL || Expr==SparsitySpMV;
+}
 
 // Compare two tensors of different formats
 bool compare(const Tensor<double>&Dst, const Tensor<double>&Ref) {
@@ -52,6 +128,39 @@ bool compare(const Tensor<double>&Dst, const Tensor<double>&Ref) {
   return valsDst == valsRef;
 }
 
+// Compare two tensors up to a tolerance relative to the largest value of Ref
+bool compare(const Tensor<double>&Dst, const Tensor<double>&Ref, double tolerance) {
+  if (Dst.getDimensions() != Ref.getDimensions()) {
+    return false;
+  }
+
+  std::map<std::vector<int>,double> valsDst;
+  for (const auto& val : Dst) {
+    valsDst[val.first] += val.second;
+  }
+
+  double maxRef=0.0;
+  std::map<std::vector<int>,double> valsRef;
+  for (const auto& val : Ref) {
+    valsRef[val.first] += val.second;
+    maxRef = std::max(maxRef, std::abs(val.second));
+  }
+
+  for (const auto& val : valsDst) {
+    auto ref = valsRef.find(val.first);
+    double refValue = (ref == valsRef.end()) ? 0.0 : ref->second;
+    if (std::abs(val.second - refValue) > tolerance*maxRef) {
+      return false;
+    }
+  }
+  for (const auto& val : valsRef) {
+    if (!valsDst.count(val.first) && std::abs(val.second) > tolerance*maxRef) {
+      return false;
+    }
+  }
+  return true;
+}
+
 void validate (string name, const Tensor<double>& Dst, const Tensor<double>& Ref) {
   if (Dst.getFormat()==Ref.getFormat()) {
     if (!equals (Dst, Ref))
@@ -62,3 +171,129 @@ void validate (string name, const Tensor<double>& Dst, const Tensor<double>& Ref
       cout << "\033[1;31m  Validation Error with " << name << " \033[0m" << endl;
   }
 }
+
+// Validate a result computed in lower precision than the double reference.
+// A zero tolerance keeps the exact validation used for double results.
+void validate (string name, const Tensor<double>& Dst, const Tensor<double>& Ref, double tolerance) {
+  if (tolerance == 0.0) {
+    validate(name, Dst, Ref);
+  }
+  else if (!compare(Dst,Ref,tolerance)) {
+    cout << "\033[1;31m  Validation Error with " << name << " \033[0m" << endl;
+  }
+}
+
+// Validation tolerance matching the precision a product computes with
+template<typename T> double precisionTolerance();
+template<> double precisionTolerance<double>() { return 0.0; }
+template<> double precisionTolerance<float>() { return 1e-3; }
+
+// Tolerance for double kernels that sum in a different order than taco
+const double reassociationTolerance=1e-9;
+
+// Validation tolerance of a product run with -precision
+double tolerance(Precision precision) {
+  return precision==F64 ? reassociationTolerance : precisionTolerance<float>();
+}
+
+// Number of independent problems stored as <prefix>0, <prefix>1, ... in a batch
+int batchSize(const OperandStore& exprOperands, string prefix) {
+  int problems=0;
+  while (exprOperands.count(prefix+to_string(problems)))
+    problems++;
+  return problems;
+}
+
+// Report throughput of a batch run back-to-back and as a single block-diagonal
+// problem; the difference between both is the overhead paid on each call
+void reportBatch(string name, int problems, const taco::util::TimeResults& backToBack,
+                 const taco::util::TimeResults& blockDiagonal) {
+  cout << name << " back-to-back throughput (problems/s)" << endl
+       << problems*1000.0/backToBack.mean << endl;
+  cout << name << " block-diagonal throughput (problems/s)" << endl
+       << problems*1000.0/blockDiagonal.mean << endl;
+  cout << name << " per-call overhead (us)" << endl
+       << (backToBack.mean-blockDiagonal.mean)*1000.0/problems << endl;
+}
+
+// Report the rate of a kernel doing <flops> floating-point operations per call
+void reportGFLOPS(string name, double flops, const taco::util::TimeResults& time) {
+  cout << name << " GFLOP/s" << endl << flops/(time.mean*1e6) << endl;
+}
+
+// Report after how many calls a one-time <setup> cost (ms), such as tuning or
+// compilation, is paid back by running at <faster> instead of <baseline>
+void reportBreakEven(string name, double setup, const taco::util::TimeResults& baseline,
+                     const taco::util::TimeResults& faster) {
+  double saving=baseline.mean-faster.mean;
+  cout << name << " break-even iterations" << endl;
+  if (saving > 0)
+    cout << (long)ceil(setup/saving) << endl;
+  else
+    cout << "never" << endl;
+}
+
+// Mean time of every kernel (phases timed with a cold cache) at each level of
+// a sparsity sweep. The crossover of a kernel is the level from which it stays
+// faster than the fastest kernel that only ran on the dense operands.
+struct CrossoverTable {
+  vector<string> levels;
+  vector<string> rows;
+  map<string,map<string,double>> times;
+
+  static string level(double sparsity) {
+    std::ostringstream label;
+    label << sparsity;
+    return label.str();
+  }
+
+  void add(string row, string level, double time) {
+    if (std::find(levels.begin(),levels.end(),level)==levels.end())
+      levels.push_back(level);
+    if (!times.count(row))
+      rows.push_back(row);
+    times[row][level]=time;
+  }
+
+  // Add the kernels benchmarked since benchResults[first]
+  void addResults(size_t first, string level) {
+    for (size_t r=first; r<benchResults.size(); r++)
+      if (benchResults[r].cold)
+        add(benchResults[r].name,level,benchResults[r].time.mean);
+  }
+
+  void print(string dense) const {
+    string reference;
+    for (auto& row : rows) {
+      const map<string,double>& rowTimes=times.at(row);
+      if (rowTimes.size()==1 && rowTimes.count(dense) &&
+          (reference.empty() || rowTimes.at(dense) < times.at(reference).at(dense)))
+        reference=row;
+    }
+    cout << endl << "Crossover table (ms), dense reference: " << reference << endl;
+    cout << left << setw(28) << "kernel";
+    for (auto& level : levels)
+      cout << setw(12) << level;
+    cout << "crossover" << endl;
+    for (auto& row : rows) {
+      const map<string,double>& rowTimes=times.at(row);
+      cout << setw(28) << row;
+      string crossover="-";
+      for (auto& level : levels) {
+        if (rowTimes.count(level)) {
+          cout << setw(12) << rowTimes.at(level);
+          if (level!=dense && !reference.empty()) {
+            if (rowTimes.at(level) >= times.at(reference).at(dense))
+              crossover="-";
+            else if (crossover=="-")
+              crossover=level;
+          }
+        }
+        else
+          cout << setw(12) << "-";
+      }
+      cout << crossover << endl;
+    }
+    cout << right;
+  }
+};
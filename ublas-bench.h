@@ -8,151 +8,240 @@ using namespace std;
 #include <boost/numeric/ublas/matrix_sparse.hpp>
 #include <boost/numeric/ublas/operation.hpp>
 #include <boost/numeric/ublas/matrix.hpp>
-typedef boost::numeric::ublas::compressed_matrix<double,boost::numeric::ublas::column_major> UBlasCSC;
-typedef boost::numeric::ublas::compressed_matrix<double,boost::numeric::ublas::row_major> UBlasCSR;
-typedef boost::numeric::ublas::matrix<double,boost::numeric::ublas::column_major> UBlasColMajor;
-typedef boost::numeric::ublas::matrix<double,boost::numeric::ublas::row_major> UBlasRowMajor;
-typedef boost::numeric::ublas::vector<double> UBlasDenseVector;
+template<typename T> using UBlasCSC = boost::numeric::ublas::compressed_matrix<T,boost::numeric::ublas::column_major>;
+template<typename T> using UBlasCSR = boost::numeric::ublas::compressed_matrix<T,boost::numeric::ublas::row_major>;
+template<typename T> using UBlasColMajor = boost::numeric::ublas::matrix<T,boost::numeric::ublas::column_major>;
+template<typename T> using UBlasRowMajor = boost::numeric::ublas::matrix<T,boost::numeric::ublas::row_major>;
+template<typename T> using UBlasDenseVector = boost::numeric::ublas::vector<T>;
 
-  void UBLASTotaco(const UBlasCSC& src, Tensor<double>& dst){
+  template<typename T>
+  void UBLASTotaco(const UBlasCSC<T>& src, Tensor<double>& dst){
     for (auto it1 = src.begin2(); it1 != src.end2(); it1++ )
       for (auto it2 = it1.begin(); it2 != it1.end(); ++it2 )
         dst.insert({(int)(it2.index1()),(int)(it2.index2())},*it2);
     dst.pack();
   }
 
-  void tacoToUBLAS(const Tensor<double>& src, UBlasCSC& dst) {
+  template<typename T>
+  void tacoToUBLAS(const Tensor<double>& src, UBlasCSC<T>& dst) {
     for (auto& value : iterate<double>(src))
       dst(value.first.at(0),value.first.at(1)) = value.second;
   }
 
-  void tacoToUBLAS(const Tensor<double>& src, UBlasCSR& dst) {
+  template<typename T>
+  void tacoToUBLAS(const Tensor<double>& src, UBlasCSR<T>& dst) {
     for (auto& value : iterate<double>(src))
       dst(value.first.at(0),value.first.at(1)) = value.second;
   }
 
-  void tacoToUBLAS(const Tensor<double>& src, UBlasColMajor& dst) {
+  template<typename T>
+  void tacoToUBLAS(const Tensor<double>& src, UBlasColMajor<T>& dst) {
     dst.resize(src.getDimension(0), src.getDimension(1), false);
     for (auto& value : iterate<double>(src))
       dst(value.first.at(0),value.first.at(1)) = value.second;
   }
 
-  void tacoToUBLAS(const Tensor<double>& src, UBlasRowMajor& dst) {
+  template<typename T>
+  void tacoToUBLAS(const Tensor<double>& src, UBlasRowMajor<T>& dst) {
     dst.resize(src.getDimension(0), src.getDimension(1), false);
     for (auto& value : iterate<double>(src))
       dst(value.first.at(0),value.first.at(1)) = value.second;
   }
 
-  void UBLASTotaco(const UBlasDenseVector& src, Tensor<double>& dst){
+  template<typename T>
+  void UBLASTotaco(const UBlasDenseVector<T>& src, Tensor<double>& dst){
     for (int i=0; i<dst.getDimension(0); ++i)
       dst.insert({i}, src[i]);
     dst.pack();
   }
 
-  void tacoToUBLAS(const Tensor<double>& src, UBlasDenseVector& dst)  {
+  template<typename T>
+  void tacoToUBLAS(const Tensor<double>& src, UBlasDenseVector<T>& dst)  {
     for (auto& value : iterate<double>(src))
       dst(value.first[0]) = value.second;
   }
 
-  void exprToUBLAS(BenchExpr Expr, map<string,Tensor<double>> exprOperands,int repeat, taco::util::TimeResults timevalue) {
+  template<typename T>
+  void exprToUBLAS(BenchExpr Expr, const OperandStore& exprOperands,int repeat, taco::util::TimeResults timevalue,
+                   int power) {
     switch(Expr) {
-      case SpMV: {
+      case SpMV:
+      case SparsityTTV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        UBlasCSR Aublas(rows,cols);
-        tacoToUBLAS(exprOperands.at("A"),Aublas);
+        UBlasCSR<T> Aublas(rows,cols);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("A"),Aublas);,"\nUBLAS conversion",1,timevalue,false);
 
-        UBlasDenseVector xublas(cols), yublas(rows);
+        UBlasDenseVector<T> xublas(cols), yublas(rows);
         tacoToUBLAS(exprOperands.at("x"),xublas);
 
-        TACO_BENCH(boost::numeric::ublas::axpy_prod(Aublas, xublas, yublas, true);,"\nUBLAS",repeat,timevalue,true);
+        TACO_BENCH(boost::numeric::ublas::axpy_prod(Aublas, xublas, yublas, true);,"UBLAS",repeat,timevalue,true);
 
         Tensor<double> y_ublas({rows}, Dense);
         UBLASTotaco(yublas,y_ublas);
 
-        validate("UBLAS", y_ublas, exprOperands.at("yRef"));
+        validate("UBLAS", y_ublas, exprOperands.at("yRef"), precisionTolerance<T>());
         break;
       }
       case PLUS3: {
         int rows=exprOperands.at("ARef").getDimension(0);
         int cols=exprOperands.at("ARef").getDimension(1);
-        UBlasCSC Aublas(rows,cols);
-        UBlasCSC Bublas(rows,cols);
-        UBlasCSC Cublas(rows,cols);
-        UBlasCSC Dublas(rows,cols);
+        UBlasCSC<T> Aublas(rows,cols);
+        UBlasCSC<T> Bublas(rows,cols);
+        UBlasCSC<T> Cublas(rows,cols);
+        UBlasCSC<T> Dublas(rows,cols);
 
-        tacoToUBLAS(exprOperands.at("B"),Bublas);
-        tacoToUBLAS(exprOperands.at("C"),Cublas);
-        tacoToUBLAS(exprOperands.at("D"),Dublas);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("B"),Bublas);
+                   tacoToUBLAS(exprOperands.at("C"),Cublas);
+                   tacoToUBLAS(exprOperands.at("D"),Dublas);,"\nUBLAS conversion",1,timevalue,false);
 
-        TACO_BENCH(noalias(Aublas) = Bublas + Cublas + Dublas;,"\nUBLAS",repeat,timevalue,true);
+        TACO_BENCH(noalias(Aublas) = Bublas + Cublas + Dublas;,"UBLAS",repeat,timevalue,true);
 
         Tensor<double> A_ublas({rows,cols}, CSC);
         UBLASTotaco(Aublas,A_ublas);
 
         // commented for now as uBLAS and taco treat physical zeros differently
-        // validate("UBLAS", A_ublas, exprOperands.at("ARef"));
+        // validate("UBLAS", A_ublas, exprOperands.at("ARef"), precisionTolerance<T>());
         break;
       }
       case MATTRANSMUL: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        UBlasCSC Aublas(rows,cols);
-        tacoToUBLAS(exprOperands.at("A"),Aublas);
+        UBlasCSC<T> Aublas(rows,cols);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("A"),Aublas);,"\nUBLAS conversion",1,timevalue,false);
 
-        UBlasDenseVector xublas(cols), zublas(rows), yublas(rows), tmpublas(rows);
+        UBlasDenseVector<T> xublas(cols), zublas(rows), yublas(rows), tmpublas(rows);
         tacoToUBLAS(exprOperands.at("x"),xublas);
         tacoToUBLAS(exprOperands.at("z"),zublas);
-        double alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
-        double beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+        T alpha = (T)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+        T beta = (T)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
 
-        TACO_BENCH(boost::numeric::ublas::axpy_prod(xublas, Aublas, tmpublas, true); yublas = alpha * tmpublas + beta * zublas;,"\nUBLAS",repeat,timevalue,true);
+        TACO_BENCH(boost::numeric::ublas::axpy_prod(xublas, Aublas, tmpublas, true); yublas = alpha * tmpublas + beta * zublas;,"UBLAS",repeat,timevalue,true);
 
         Tensor<double> y_ublas({rows}, Dense);
         UBLASTotaco(yublas,y_ublas);
 
-        validate("UBLAS", y_ublas, exprOperands.at("yRef"));
+        validate("UBLAS", y_ublas, exprOperands.at("yRef"), precisionTolerance<T>());
         break;
       }
-      case RESIDUAL: {
+      case RESIDUAL:
+      case SparsitySpMV: {
         int rows=exprOperands.at("A").getDimension(0);
         int cols=exprOperands.at("A").getDimension(1);
-        UBlasCSR Aublas(rows,cols);
-        tacoToUBLAS(exprOperands.at("A"),Aublas);
+        UBlasCSR<T> Aublas(rows,cols);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("A"),Aublas);,"\nUBLAS conversion",1,timevalue,false);
 
-        UBlasDenseVector xublas(cols), zublas(rows), yublas(rows), tmpublas(rows);
+        UBlasDenseVector<T> xublas(cols), zublas(rows), yublas(rows), tmpublas(rows);
         tacoToUBLAS(exprOperands.at("x"),xublas);
         tacoToUBLAS(exprOperands.at("z"),zublas);
-        double alpha = ((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
-        double beta = ((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
+        T alpha = (T)((double*)(exprOperands.at("alpha").getStorage().getValues().getData()))[0];
+        T beta = (T)((double*)(exprOperands.at("beta").getStorage().getValues().getData()))[0];
 
-        TACO_BENCH(boost::numeric::ublas::axpy_prod(Aublas, xublas, tmpublas, true); yublas = zublas - tmpublas ;,"\nUBLAS",repeat,timevalue,true);
+        // RESIDUAL is given as alpha=-1 and beta=1
+        TACO_BENCH(boost::numeric::ublas::axpy_prod(Aublas, xublas, tmpublas, true); yublas = alpha * tmpublas + beta * zublas;,"UBLAS",repeat,timevalue,true);
 
         Tensor<double> y_ublas({rows}, Dense);
         UBLASTotaco(yublas,y_ublas);
 
-        validate("UBLAS", y_ublas, exprOperands.at("yRef"));
+        validate("UBLAS", y_ublas, exprOperands.at("yRef"), precisionTolerance<T>());
         break;
       }
       case SDDMM: {
         int rows=exprOperands.at("ARef").getDimension(0);
         int cols=exprOperands.at("ARef").getDimension(1);
-        UBlasCSC Aublas(rows,cols);
-        UBlasCSC Bublas(rows,cols);
-        UBlasRowMajor Cublas;
-        UBlasColMajor Dublas;
+        UBlasCSC<T> Aublas(rows,cols);
+        UBlasCSC<T> Bublas(rows,cols);
+        UBlasRowMajor<T> Cublas;
+        UBlasColMajor<T> Dublas;
 
-        tacoToUBLAS(exprOperands.at("B"),Bublas);
-        tacoToUBLAS(exprOperands.at("C"),Cublas);
-        tacoToUBLAS(exprOperands.at("D"),Dublas);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("B"),Bublas);
+                   tacoToUBLAS(exprOperands.at("C"),Cublas);
+                   tacoToUBLAS(exprOperands.at("D"),Dublas);,"\nUBLAS conversion",1,timevalue,false);
 
-        TACO_BENCH(noalias(Aublas) = element_prod(Bublas, prod(Cublas, Dublas)) ;,"\nUBLAS",repeat,timevalue,true);
+        TACO_BENCH(noalias(Aublas) = element_prod(Bublas, prod(Cublas, Dublas)) ;,"UBLAS",repeat,timevalue,true);
 
         Tensor<double> A_ublas({rows,cols}, CSC);
         UBLASTotaco(Aublas,A_ublas);
 
         // commented for now as uBLAS and taco treat physical zeros differently
-        // validate("UBLAS", A_ublas, exprOperands.at("ARef"));
+        // validate("UBLAS", A_ublas, exprOperands.at("ARef"), precisionTolerance<T>());
+        break;
+      }
+      case SparsitySpMDM: {
+        int rows=exprOperands.at("CRef").getDimension(0);
+        int cols=exprOperands.at("CRef").getDimension(1);
+        int Ksize=exprOperands.at("A").getDimension(1);
+        UBlasCSR<T> Aublas(rows,Ksize);
+        UBlasRowMajor<T> Bublas, Cublas(rows,cols);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("A"),Aublas);
+                   tacoToUBLAS(exprOperands.at("B"),Bublas);,"\nUBLAS conversion",1,timevalue,false);
+
+        TACO_BENCH(boost::numeric::ublas::axpy_prod(Aublas, Bublas, Cublas, true);,"UBLAS",repeat,timevalue,true);
+
+        Tensor<double> C_ublas({rows,cols}, Format({Dense,Dense}));
+        for (int i=0; i<rows; i++)
+          for (int j=0; j<cols; j++)
+            C_ublas.insert({i,j}, (double)Cublas(i,j));
+        C_ublas.pack();
+        validate("UBLAS", C_ublas, exprOperands.at("CRef"), max(precisionTolerance<T>(),reassociationTolerance));
+        break;
+      }
+      case BatchSpMV: {
+        int problems=batchSize(exprOperands,"A");
+        vector<UBlasCSR<T>> Aublas;
+        vector<UBlasDenseVector<T>> xublas, yublas;
+        for (int k=0; k<problems; k++) {
+          const Tensor<double>& A=exprOperands.at("A"+to_string(k));
+          Aublas.push_back(UBlasCSR<T>(A.getDimension(0),A.getDimension(1)));
+          xublas.push_back(UBlasDenseVector<T>(A.getDimension(1)));
+          yublas.push_back(UBlasDenseVector<T>(A.getDimension(0)));
+          tacoToUBLAS(A,Aublas[k]);
+          tacoToUBLAS(exprOperands.at("x"+to_string(k)),xublas[k]);
+        }
+        int rows=exprOperands.at("A").getDimension(0);
+        int cols=exprOperands.at("A").getDimension(1);
+        UBlasCSR<T> ABlockublas(rows,cols);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("A"),ABlockublas);,"\nUBLAS conversion",1,timevalue,false);
+        UBlasDenseVector<T> xBlockublas(cols), yBlockublas(rows);
+        tacoToUBLAS(exprOperands.at("x"),xBlockublas);
+
+        taco::util::TimeResults backToBack, blockDiagonal;
+        TACO_BENCH(for (int k=0; k<problems; k++) boost::numeric::ublas::axpy_prod(Aublas[k], xublas[k], yublas[k], true);,
+                   "UBLAS back-to-back",repeat,backToBack,true);
+        TACO_BENCH(boost::numeric::ublas::axpy_prod(ABlockublas, xBlockublas, yBlockublas, true);,
+                   "UBLAS block-diagonal",repeat,blockDiagonal,true);
+        reportBatch("UBLAS",problems,backToBack,blockDiagonal);
+
+        double tolerance=max(precisionTolerance<T>(),reassociationTolerance);
+        for (int k=0; k<problems; k++) {
+          Tensor<double> y_ublas({(int)yublas[k].size()}, Dense);
+          UBLASTotaco(yublas[k],y_ublas);
+          validate("UBLAS back-to-back "+to_string(k), y_ublas, exprOperands.at("yRef"+to_string(k)), tolerance);
+        }
+        Tensor<double> y_ublas({rows}, Dense);
+        UBLASTotaco(yBlockublas,y_ublas);
+
+        validate("UBLAS block-diagonal", y_ublas, exprOperands.at("yRef"), tolerance);
+        break;
+      }
+      case MATPOW: {
+        // k SpMVs, swapping the source and destination vectors
+        int rows=exprOperands.at("A").getDimension(0);
+        UBlasCSR<T> Aublas(rows,rows);
+        TACO_BENCH(tacoToUBLAS(exprOperands.at("A"),Aublas);,"\nUBLAS conversion",1,timevalue,false);
+        UBlasDenseVector<T> xublas(rows), yublas(rows), work(rows);
+        tacoToUBLAS(exprOperands.at("x"),xublas);
+
+        TACO_BENCH(boost::numeric::ublas::axpy_prod(Aublas, xublas, yublas, true);
+                   for (int l=2; l<=power; l++) {
+                     work.swap(yublas);
+                     boost::numeric::ublas::axpy_prod(Aublas, work, yublas, true);
+                   },"UBLAS",repeat,timevalue,true);
+        cout << "UBLAS time per power (ms)" << endl << timevalue.mean/power << endl;
+
+        Tensor<double> y_ublas({rows}, Dense);
+        UBLASTotaco(yublas,y_ublas);
+        validate("UBLAS", y_ublas, exprOperands.at("yRef"), max(precisionTolerance<T>(),reassociationTolerance));
         break;
       }
       default:
@@ -160,5 +249,15 @@ typedef boost::numeric::ublas::vector<double> UBlasDenseVector;
         break;
     }
 }
-#endif
 
+  static ProductRegistration ublasRegistration("UBLAS",
+      {SpMV,PLUS3,MATTRANSMUL,RESIDUAL,SDDMM,SparsitySpMV,SparsityTTV,SparsitySpMDM,BatchSpMV,
+       MATPOW},
+      false, true, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        if (run.precision==F64)
+          exprToUBLAS<double>(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters));
+        else
+          exprToUBLAS<float>(run.expr,run.operands,run.repeat,timevalue,matrixPower(run.parameters));
+      });
+
+#endif
@@ -0,0 +1,258 @@
+#include "taco/tensor.h"
+
+using namespace taco;
+using namespace std;
+
+#include <random>
+
+// Matrices updated by batches of random inserts and deletes of nonzeros, with
+// SpMV after each batch. taco has no update in place: a batch rebuilds A with
+// insert and pack. The native structure is CSR with slack after each row,
+// updated in place with the columns of a row kept sorted. A row out of slack
+// compacts the whole matrix, giving every row fresh slack.
+//   -updates=<k>  updates per batch, half inserts, half deletes (default nnz/1000)
+//   -batches=<n>  number of batches (default 10)
+
+const int defaultUpdateBatches=10;
+const int updateMinSlack=4;
+const double updateSlackFraction=0.125;
+const unsigned updateSeed=42;
+
+// Insert sets the value of A(row,col), delete removes it when present
+struct MatrixUpdate {
+  int row;
+  int col;
+  double value;
+  bool insert;
+};
+
+struct SlackCSR {
+  int rows;
+  int cols;
+  vector<int> rowStart;   // rows+1, the slack of row i ends at rowStart[i+1]
+  vector<int> rowLength;
+  vector<int> crd;
+  vector<double> vals;
+  int compactions;
+
+  long nnz() const {
+    long nnz=0;
+    for (int length : rowLength)
+      nnz+=length;
+    return nnz;
+  }
+};
+
+  int rowSlack(int length) {
+    return max(updateMinSlack,(int)(length*updateSlackFraction));
+  }
+
+  // Copy rows of the given lengths to fresh arrays with slack after each
+  void packSlackCSR(int rows, const vector<int>& start, const vector<int>& length,
+                    const int* crd, const double* vals, SlackCSR& dst) {
+    vector<int> rowStart(rows+1,0);
+    for (int i=0; i<rows; i++)
+      rowStart[i+1]=rowStart[i]+length[i]+rowSlack(length[i]);
+    vector<int> newCrd(rowStart[rows]);
+    vector<double> newVals(rowStart[rows]);
+    #pragma omp parallel for schedule(static)
+    for (int i=0; i<rows; i++) {
+      std::copy(crd+start[i],crd+start[i]+length[i],newCrd.begin()+rowStart[i]);
+      std::copy(vals+start[i],vals+start[i]+length[i],newVals.begin()+rowStart[i]);
+    }
+    dst.rowStart.swap(rowStart);
+    dst.rowLength=length;
+    dst.crd.swap(newCrd);
+    dst.vals.swap(newVals);
+  }
+
+  void CSRToSlack(int rows, int cols, const int* pos, const int* crd, const double* vals,
+                  SlackCSR& dst) {
+    dst.rows=rows;
+    dst.cols=cols;
+    dst.compactions=0;
+    vector<int> start(pos,pos+rows);
+    vector<int> length(rows);
+    for (int i=0; i<rows; i++)
+      length[i]=pos[i+1]-pos[i];
+    packSlackCSR(rows,start,length,crd,vals,dst);
+  }
+
+  void compactSlackCSR(SlackCSR& A) {
+    vector<int> start(A.rowStart.begin(),A.rowStart.end()-1);
+    vector<int> length=A.rowLength;
+    vector<int> crd;
+    vector<double> vals;
+    crd.swap(A.crd);
+    vals.swap(A.vals);
+    packSlackCSR(A.rows,start,length,crd.data(),vals.data(),A);
+    A.compactions++;
+  }
+
+  void updateSlackCSR(SlackCSR& A, const MatrixUpdate& update) {
+    int i=update.row;
+    int* first=A.crd.data()+A.rowStart[i];
+    int* last=first+A.rowLength[i];
+    int* found=std::lower_bound(first,last,update.col);
+    int p=(int)(found-A.crd.data());
+    bool present=(found!=last && *found==update.col);
+    if (!update.insert) {
+      if (present) {
+        int end=A.rowStart[i]+A.rowLength[i];
+        std::copy(A.crd.begin()+p+1,A.crd.begin()+end,A.crd.begin()+p);
+        std::copy(A.vals.begin()+p+1,A.vals.begin()+end,A.vals.begin()+p);
+        A.rowLength[i]--;
+      }
+      return;
+    }
+    if (present) {
+      A.vals[p]=update.value;
+      return;
+    }
+    if (A.rowStart[i]+A.rowLength[i]==A.rowStart[i+1]) {
+      compactSlackCSR(A);
+      updateSlackCSR(A,update);
+      return;
+    }
+    int end=A.rowStart[i]+A.rowLength[i];
+    std::copy_backward(A.crd.begin()+p,A.crd.begin()+end,A.crd.begin()+end+1);
+    std::copy_backward(A.vals.begin()+p,A.vals.begin()+end,A.vals.begin()+end+1);
+    A.crd[p]=update.col;
+    A.vals[p]=update.value;
+    A.rowLength[i]++;
+  }
+
+  void applyUpdates(SlackCSR& A, const vector<MatrixUpdate>& updates) {
+    for (auto& update : updates)
+      updateSlackCSR(A,update);
+  }
+
+  void slackSpMV(const SlackCSR& A, const double* x, double* y) {
+    #pragma omp parallel for schedule(static)
+    for (int i=0; i<A.rows; i++) {
+      double sum=0.0;
+      for (int p=A.rowStart[i]; p<A.rowStart[i]+A.rowLength[i]; p++)
+        sum+=A.vals[p]*x[A.crd[p]];
+      y[i]=sum;
+    }
+  }
+
+  // A rebuilt by taco with a batch applied, as a full insert and pack. The
+  // last update of a coordinate wins.
+  Tensor<double> rebuildTaco(const Tensor<double>& A, const vector<MatrixUpdate>& updates) {
+    map<pair<int,int>,const MatrixUpdate*> batch;
+    for (auto& update : updates)
+      batch[{update.row,update.col}]=&update;
+    Tensor<double> dst(A.getDimensions(),CSR);
+    for (auto& value : iterate<double>(A)) {
+      if (!batch.count({value.first.at(0),value.first.at(1)}))
+        dst.insert(value.first,value.second);
+    }
+    for (auto& update : batch) {
+      if (update.second->insert)
+        dst.insert({update.first.first,update.first.second},update.second->value);
+    }
+    dst.pack();
+    return dst;
+  }
+
+  // k/2 inserts at random coordinates and k/2 deletes of random nonzeros,
+  // interleaved
+  vector<MatrixUpdate> randomUpdates(const SlackCSR& A, int k, std::mt19937& gen) {
+    std::uniform_int_distribution<int> row(0,A.rows-1);
+    std::uniform_int_distribution<int> col(0,A.cols-1);
+    std::uniform_int_distribution<int> slot(0,A.rowStart[A.rows]-1);
+    std::uniform_real_distribution<double> value(0.0,1.0);
+    vector<MatrixUpdate> updates;
+    for (int u=0; u<k; u++) {
+      if (u%2==0) {
+        updates.push_back({row(gen),col(gen),value(gen),true});
+        continue;
+      }
+      // a random slot of the arrays, until it holds a nonzero
+      for (int tries=0; tries<100; tries++) {
+        int p=slot(gen);
+        int i=(int)(std::upper_bound(A.rowStart.begin(),A.rowStart.end(),p)-A.rowStart.begin())-1;
+        if (p < A.rowStart[i]+A.rowLength[i]) {
+          updates.push_back({i,A.crd[p],0.0,false});
+          break;
+        }
+      }
+    }
+    return updates;
+  }
+
+  void reportUpdates(string name, int updates, const taco::util::TimeResults& time) {
+    cout << name << " updates/s" << endl << updates/(time.mean/1000) << endl;
+  }
+
+  void reportSlowdown(string name, const taco::util::TimeResults& time,
+                      const taco::util::TimeResults& baseline) {
+    cout << name << " slowdown over the loaded matrix" << endl << time.mean/baseline.mean << endl;
+  }
+
+  void exprToUpdate(BenchExpr Expr, const OperandStore& exprOperands,int repeat,
+                    taco::util::TimeResults timevalue, const map<string,string>& parameters) {
+    switch(Expr) {
+      case SpMV: {
+        Tensor<double> A=exprOperands.csr("A");
+        int rows=A.getDimension(0);
+        int cols=A.getDimension(1);
+        double *a_CSR;
+        int* ia_CSR;
+        int* ja_CSR;
+        getCSRArrays(A,&ia_CSR,&ja_CSR,&a_CSR);
+        vector<double> x, y(rows), ySlack(rows);
+        tacoToVector(exprOperands.at("x"),x);
+        int k=parameters.count("updates") ? stoi(parameters.at("updates")) : max(2,ia_CSR[rows]/1000);
+        int batches=parameters.count("batches") ? stoi(parameters.at("batches")) : defaultUpdateBatches;
+        cout << "UPDATE: " << batches << " batches of " << k << " updates on "
+             << ia_CSR[rows] << " nonzeros" << endl;
+
+        taco::util::TimeResults loadedTime, tacoTime, slackTime;
+        TACO_BENCH(csrSpMV(rows,ia_CSR,ja_CSR,a_CSR,x.data(),1.0,0.0,x.data(),y.data());,
+                   "\nUPDATE loaded CSR SpMV",repeat,loadedTime,true);
+        SlackCSR ASlack;
+        TACO_BENCH(CSRToSlack(rows,cols,ia_CSR,ja_CSR,a_CSR,ASlack);,
+                   "UPDATE slack CSR build",1,timevalue,false);
+
+        std::mt19937 gen(updateSeed);
+        for (int b=1; b<=batches; b++) {
+          vector<MatrixUpdate> updates=randomUpdates(ASlack,k,gen);
+          string batch=" batch "+to_string(b);
+
+          TACO_BENCH(A=rebuildTaco(A,updates);,"\nUPDATE taco rebuild"+batch,1,timevalue,false);
+          reportUpdates("UPDATE taco rebuild"+batch,(int)updates.size(),timevalue);
+          getCSRArrays(A,&ia_CSR,&ja_CSR,&a_CSR);
+          TACO_BENCH(csrSpMV(rows,ia_CSR,ja_CSR,a_CSR,x.data(),1.0,0.0,x.data(),y.data());,
+                     "UPDATE taco SpMV"+batch,repeat,tacoTime,true);
+          reportSlowdown("UPDATE taco SpMV"+batch,tacoTime,loadedTime);
+
+          TACO_BENCH(applyUpdates(ASlack,updates);,"UPDATE slack CSR"+batch,1,timevalue,false);
+          reportUpdates("UPDATE slack CSR"+batch,(int)updates.size(),timevalue);
+          TACO_BENCH(slackSpMV(ASlack,x.data(),ySlack.data());,"UPDATE slack CSR SpMV"+batch,
+                     repeat,slackTime,true);
+          reportSlowdown("UPDATE slack CSR SpMV"+batch,slackTime,loadedTime);
+        }
+        cout << "UPDATE slack CSR: " << ASlack.compactions << " compactions, "
+             << ASlack.nnz() << " nonzeros in " << ASlack.rowStart[rows] << " slots" << endl;
+
+        // both structures hold the same matrix after the batches
+        Tensor<double> y_taco({rows}, Dense);
+        Tensor<double> y_slack({rows}, Dense);
+        VectorTotaco(y,y_taco);
+        VectorTotaco(ySlack,y_slack);
+        validate("UPDATE slack CSR SpMV", y_slack, y_taco, reassociationTolerance);
+        break;
+      }
+      default:
+        cout << " !! Expression not implemented for UPDATE" << endl;
+        break;
+    }
+  }
+
+  static ProductRegistration updateRegistration("UPDATE",
+      {SpMV},
+      true, false, [](ProductRun& run, taco::util::TimeResults timevalue) {
+        exprToUpdate(run.expr,run.operands,run.repeat,timevalue,run.parameters);
+      });
@@ -7,23 +7,50 @@ using namespace std;
 // Add your include here
 // ...
 
-  void exprToYour(BenchExpr Expr, map<string,Tensor<double>> exprOperands,int repeat, taco::util::TimeResults timevalue) {
-    switch(Expr) {
+  // Convert the operands of run.operands to your format and keep them in
+  // run.state. taco-bench times this phase once as "YOURS conversion".
+  // run.operands.csr("A"), csc("A"), oneBasedCSR("A"), rowMajor("A"),
+  // colMajor("A") and transposed("A") are shared with the other products.
+  void convertYours(ProductRun& run) {
+    switch(run.expr) {
       case SpMV:
-        // Add code for your implementation of SpMV
+        // Convert run.operands.at("A") and run.operands.at("x")
         // ..
-        // Use TACO_BENCH macro to benchmark your implementation
-        // ..
-        // Use validate method to compare against expected results
+        break;
+      default:
+        break;
+    }
+  }
+
+  // Compute the expression, timed <repeat> times with a cold cache as "YOURS"
+  void runYours(ProductRun& run) {
+    switch(run.expr) {
+      case SpMV:
+        // Add code for your implementation of SpMV on run.state
         // ..
-      case PLUS3:
-      case MATTRANSMUL:
-      case RESIDUAL:
-      case SDDMM:
+        break;
       default:
-        cout << " !! Expression not implemented for your" << endl;
         break;
     }
   }
 
+  // Copy your result to run.result and set run.hasResult to have it
+  // validated against taco, then free run.state
+  void teardownYours(ProductRun& run) {
+    // ..
+  }
+
+  Product yoursProduct() {
+    // Declare the expressions you support, then whether you run multithreaded
+    // and in single precision
+    Product product("YOURS",{SpMV},false,false);
+    product.convert=convertYours;
+    // product.setup=... for analysis, tuning or output allocation
+    product.run=runYours;
+    product.teardown=teardownYours;
+    return product;
+  }
+
+  static ProductRegistration yoursRegistration(yoursProduct());
+
 #endif